@@ -0,0 +1,377 @@
+#pragma once
+
+struct ResourceUsageInfo
+{
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+	VkImageLayout layout;
+};
+
+static const struct ResourceUsageInfo kResourceUsages[eResourceUsage_EnumMax] = {
+	[eResourceUsage_TransferSrc] = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
+	[eResourceUsage_TransferDst] = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+	[eResourceUsage_VertexBuffer] = { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED },
+	[eResourceUsage_IndexBuffer] = { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED },
+	[eResourceUsage_IndirectBuffer] = { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED },
+	[eResourceUsage_UniformBuffer] = { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED },
+	[eResourceUsage_VertexShaderRead] = { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+	[eResourceUsage_FragmentShaderRead] = { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+	[eResourceUsage_ComputeShaderRead] = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+	[eResourceUsage_ComputeShaderWrite] = { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL },
+	[eResourceUsage_ColorTarget] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+	[eResourceUsage_DepthStencilTarget] = { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL }
+};
+
+static const VkAccessFlags kWriteAccess = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+	| VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+static VkPipelineStageFlags getQueueStages(const struct DeviceQueueContext* queueContext, VkPipelineStageFlags stages)
+{
+	if (!(queueContext->requiredFlags & VK_QUEUE_GRAPHICS_BIT))
+	{
+		stages &= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	return stages;
+}
+
+// moves state to the new use, returns true with the source scope filled in when that needs a barrier
+static bool updateResourceState(struct ResourceState* state, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout, bool acquire,
+	VkPipelineStageFlags* srcStages, VkAccessFlags* srcAccess)
+{
+	const VkAccessFlags writeAccess = access & kWriteAccess;
+	bool retval = acquire || layout != state->layout;
+	*srcStages = state->writeStages;
+	*srcAccess = state->writeAccess;
+	if (retval || writeAccess)
+	{
+		// writes and layout transitions wait for every use since the last write, reads included
+		*srcStages |= state->readStages;
+		retval |= (*srcStages != 0);
+		state->writeStages = stages;
+		state->writeAccess = writeAccess;
+		state->readStages = (writeAccess) ? 0 : stages;
+		state->visibleStages = (writeAccess) ? 0 : stages;
+		state->visibleAccess = (writeAccess) ? 0 : access;
+	}
+	else
+	{
+		// reads only wait for the last write, and only where no earlier barrier made it visible
+		retval = state->writeStages && ((stages & ~state->visibleStages) || (access & ~state->visibleAccess));
+		state->readStages |= stages;
+		if (retval)
+		{
+			state->visibleStages |= stages;
+			state->visibleAccess |= access;
+		}
+	}
+	state->layout = layout;
+
+	// the releasing queue made the writes available, the semaphore orders everything before them
+	if (acquire)
+	{
+		*srcStages = 0;
+		*srcAccess = 0;
+	}
+	return retval;
+}
+
+static bool hasPendingCopy(const struct DeviceQueueContext* queueContext, VkBuffer buffer, VkImage image)
+{
+	for (uint32_t i = 0; i < queueContext->numPendingCopies; i++)
+	{
+		const struct PendingCopy* copy = &queueContext->pendingCopies[i];
+		if ((buffer && copy->dstBuffer == buffer) || (image && copy->dstImage == image))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static void flushResourceBarriers(struct DeviceQueueContext* queueContext)
+{
+	const uint32_t numBuffers = queueContext->numTrackedBufferBarriers;
+	const uint32_t numImages = queueContext->numTrackedImageBarriers;
+	if (!numBuffers && !numImages)
+	{
+		return;
+	}
+
+	if (Synchronization2)
+	{
+		const VkDependencyInfoKHR dependency = {
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+			.bufferMemoryBarrierCount = numBuffers,
+			.pBufferMemoryBarriers = queueContext->trackedBufferBarriers,
+			.imageMemoryBarrierCount = numImages,
+			.pImageMemoryBarriers = queueContext->trackedImageBarriers
+		};
+		vkCmdPipelineBarrier2KHR(queueContext->cmdBuffer, &dependency);
+	}
+	else
+	{
+		// one call still, but every barrier waits on the stages of all of them
+		VkBufferMemoryBarrier buffers[MAX_RESOURCE_BARRIERS];
+		VkImageMemoryBarrier images[MAX_RESOURCE_BARRIERS];
+		VkPipelineStageFlags srcStages = 0, dstStages = 0;
+		for (uint32_t i = 0; i < numBuffers; i++)
+		{
+			const VkBufferMemoryBarrier2KHR* barrier = &queueContext->trackedBufferBarriers[i];
+			srcStages |= (VkPipelineStageFlags)barrier->srcStageMask;
+			dstStages |= (VkPipelineStageFlags)barrier->dstStageMask;
+			buffers[i] = (VkBufferMemoryBarrier) {
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+				.srcAccessMask = (VkAccessFlags)barrier->srcAccessMask,
+				.dstAccessMask = (VkAccessFlags)barrier->dstAccessMask,
+				.srcQueueFamilyIndex = barrier->srcQueueFamilyIndex,
+				.dstQueueFamilyIndex = barrier->dstQueueFamilyIndex,
+				.buffer = barrier->buffer,
+				.offset = barrier->offset,
+				.size = barrier->size
+			};
+		}
+		for (uint32_t i = 0; i < numImages; i++)
+		{
+			const VkImageMemoryBarrier2KHR* barrier = &queueContext->trackedImageBarriers[i];
+			srcStages |= (VkPipelineStageFlags)barrier->srcStageMask;
+			dstStages |= (VkPipelineStageFlags)barrier->dstStageMask;
+			images[i] = (VkImageMemoryBarrier) {
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.srcAccessMask = (VkAccessFlags)barrier->srcAccessMask,
+				.dstAccessMask = (VkAccessFlags)barrier->dstAccessMask,
+				.oldLayout = barrier->oldLayout,
+				.newLayout = barrier->newLayout,
+				.srcQueueFamilyIndex = barrier->srcQueueFamilyIndex,
+				.dstQueueFamilyIndex = barrier->dstQueueFamilyIndex,
+				.image = barrier->image,
+				.subresourceRange = barrier->subresourceRange
+			};
+		}
+		srcStages = (srcStages) ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		vkCmdPipelineBarrier(queueContext->cmdBuffer, srcStages, dstStages, 0, 0, NULL, numBuffers, buffers, numImages, images);
+	}
+	queueContext->numTrackedBufferBarriers = 0;
+	queueContext->numTrackedImageBarriers = 0;
+}
+
+// a barrier still pending for the same range had nothing recorded after it, so it is extended to the new use
+static void queueBufferBarrier(struct DeviceQueueContext* queueContext, const VkBufferMemoryBarrier2KHR* barrier)
+{
+	if (hasPendingCopy(queueContext, barrier->buffer, VK_NULL_HANDLE))
+	{
+		flushPendingCopies(queueContext);
+	}
+	for (uint32_t i = 0; i < queueContext->numTrackedBufferBarriers; i++)
+	{
+		VkBufferMemoryBarrier2KHR* pending = &queueContext->trackedBufferBarriers[i];
+		if (pending->buffer == barrier->buffer)
+		{
+			pending->dstStageMask |= barrier->dstStageMask;
+			pending->dstAccessMask |= barrier->dstAccessMask;
+			return;
+		}
+	}
+	if (queueContext->numTrackedBufferBarriers == MAX_RESOURCE_BARRIERS)
+	{
+		flushResourceBarriers(queueContext);
+	}
+	queueContext->trackedBufferBarriers[queueContext->numTrackedBufferBarriers++] = *barrier;
+}
+
+static void queueImageBarrier(struct DeviceQueueContext* queueContext, const VkImageMemoryBarrier2KHR* barrier)
+{
+	if (hasPendingCopy(queueContext, VK_NULL_HANDLE, barrier->image))
+	{
+		flushPendingCopies(queueContext);
+	}
+	const VkImageSubresourceRange* range = &barrier->subresourceRange;
+	for (uint32_t i = 0; i < queueContext->numTrackedImageBarriers; i++)
+	{
+		VkImageMemoryBarrier2KHR* pending = &queueContext->trackedImageBarriers[i];
+		const VkImageSubresourceRange* other = &pending->subresourceRange;
+		if (pending->image != barrier->image || range->baseMipLevel >= other->baseMipLevel + other->levelCount
+			|| other->baseMipLevel >= range->baseMipLevel + range->levelCount)
+		{
+			continue;
+		}
+		if (range->baseMipLevel == other->baseMipLevel && range->levelCount == other->levelCount)
+		{
+			pending->dstStageMask |= barrier->dstStageMask;
+			pending->dstAccessMask |= barrier->dstAccessMask;
+			pending->newLayout = barrier->newLayout;
+			return;
+		}
+		// barriers in one call are unordered, partly overlapping transitions need two
+		flushResourceBarriers(queueContext);
+		break;
+	}
+	if (queueContext->numTrackedImageBarriers == MAX_RESOURCE_BARRIERS)
+	{
+		flushResourceBarriers(queueContext);
+	}
+	queueContext->trackedImageBarriers[queueContext->numTrackedImageBarriers++] = *barrier;
+}
+
+static void trackImageUse(struct DeviceQueueContext* queueContext, Image image, uint32_t fromMip, uint32_t toMip, VkPipelineStageFlags stages, VkAccessFlags access, VkImageLayout layout)
+{
+	VkImageMemoryBarrier2KHR barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
+		.dstStageMask = stages,
+		.dstAccessMask = access,
+		.newLayout = layout,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image->handle,
+		.subresourceRange = {
+			.aspectMask = image->aspect,
+			.layerCount = VK_REMAINING_ARRAY_LAYERS
+		}
+	};
+
+	// contents only move to another queue family when some mip still holds them
+	bool discard = true;
+	for (uint32_t i = 0; i < image->mips; i++)
+	{
+		discard &= (image->state[i].layout == VK_IMAGE_LAYOUT_UNDEFINED);
+	}
+	const DeviceQueue owner = image->owner;
+	const bool acquire = transferOwnership(&image->owner, discard, &barrier.srcQueueFamilyIndex, &barrier.dstQueueFamilyIndex);
+
+	// neighbouring mips coming from the same state share one barrier
+	for (uint32_t i = fromMip; i < toMip;)
+	{
+		const struct ResourceState from = image->state[i];
+		uint32_t end = i + 1;
+		while (end < toMip && memcmp(&image->state[end], &from, sizeof(struct ResourceState)) == 0)
+		{
+			end++;
+		}
+
+		VkPipelineStageFlags srcStages = 0;
+		VkAccessFlags srcAccess = 0;
+		const bool needed = updateResourceState(&image->state[i], stages, access, layout, acquire, &srcStages, &srcAccess);
+		for (uint32_t j = i + 1; j < end; j++)
+		{
+			image->state[j] = image->state[i];
+		}
+		if (needed)
+		{
+			barrier.srcStageMask = srcStages;
+			barrier.srcAccessMask = srcAccess;
+			barrier.oldLayout = from.layout;
+			barrier.subresourceRange.baseMipLevel = i;
+			barrier.subresourceRange.levelCount = end - i;
+			if (acquire)
+			{
+				struct OwnershipRelease* release = &queueContext->releases[owner];
+				breakIfNot(release->numImageBarriers < MAX_RESOURCE_BARRIERS);
+				release->imageBarriers[release->numImageBarriers++] = (VkImageMemoryBarrier) {
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+					.srcAccessMask = getReleaseAccess(owner, from.writeAccess),
+					.oldLayout = from.layout,
+					// within one family the acquiring queue does the transition, the release only makes writes available
+					.newLayout = (barrier.srcQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED) ? from.layout : layout,
+					.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+					.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+					.image = image->handle,
+					.subresourceRange = barrier.subresourceRange
+				};
+			}
+			queueImageBarrier(queueContext, &barrier);
+		}
+		i = end;
+	}
+}
+
+void useBuffer(Buffer buffer, ResourceUsage usage)
+{
+	traceCall(eTraceOp_UseBuffer, traceObject(buffer), usage);
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	const struct ResourceUsageInfo* info = &kResourceUsages[usage];
+	VkBufferMemoryBarrier2KHR barrier = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR,
+		.dstStageMask = getQueueStages(queueContext, info->stages),
+		.dstAccessMask = info->access,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.buffer = getBufferHandle(buffer),
+		.size = buffer->size
+	};
+
+	const DeviceQueue owner = buffer->owner;
+	const VkAccessFlags released = buffer->state.writeAccess;
+	const bool acquire = buffer->queue == eDeviceQueue_Invalid && transferOwnership(&buffer->owner, false, &barrier.srcQueueFamilyIndex, &barrier.dstQueueFamilyIndex);
+	VkPipelineStageFlags srcStages = 0;
+	VkAccessFlags srcAccess = 0;
+	if (updateResourceState(&buffer->state, (VkPipelineStageFlags)barrier.dstStageMask, info->access, VK_IMAGE_LAYOUT_UNDEFINED, acquire, &srcStages, &srcAccess))
+	{
+		barrier.srcStageMask = srcStages;
+		barrier.srcAccessMask = srcAccess;
+		if (acquire)
+		{
+			struct OwnershipRelease* release = &queueContext->releases[owner];
+			breakIfNot(release->numBufferBarriers < MAX_RESOURCE_BARRIERS);
+			release->bufferBarriers[release->numBufferBarriers++] = (VkBufferMemoryBarrier) {
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+				.srcAccessMask = getReleaseAccess(owner, released),
+				.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+				.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+				.buffer = barrier.buffer,
+				.size = barrier.size
+			};
+		}
+		queueBufferBarrier(queueContext, &barrier);
+	}
+}
+
+// layers share the state of their mip, the barriers cover all of them
+void useImage(Image image, ResourceUsage usage, ImageSubset subset)
+{
+	traceCall(eTraceOp_UseImage, traceObject(image), usage, subset);
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	const struct ResourceUsageInfo* info = &kResourceUsages[usage];
+	const uint32_t fromMip = imageSubsetFromMip(subset);
+	const uint32_t toMip = fromMip + imageSubsetNumMips(subset);
+	returnIfNot(fromMip < toMip && toMip <= image->mips);
+	trackImageUse(queueContext, image, fromMip, toMip, getQueueStages(queueContext, info->stages), info->access, info->layout);
+}
+
+// the pass orders itself after earlier attachment writes through its external dependency, anything else gets a barrier here
+static void beginTrackedRenderPass(struct DeviceQueueContext* queueContext, RenderPass renderPass, Framebuffer framebuffer)
+{
+	queueContext->passRenderPass = renderPass;
+	queueContext->passFramebuffer = framebuffer;
+	for (uint32_t i = 0; i < framebuffer->numImages; i++)
+	{
+		Image image = framebuffer->images[i];
+		const struct ResourceUsageInfo* info = &kResourceUsages[(i < renderPass->numColor) ? eResourceUsage_ColorTarget : eResourceUsage_DepthStencilTarget];
+		const struct ResourceState* state = &image->state[0];
+		const VkImageLayout initialLayout = renderPass->attachment[i].initialLayout;
+		if (((state->writeStages | state->readStages) & ~info->stages) || (initialLayout != VK_IMAGE_LAYOUT_UNDEFINED && initialLayout != state->layout))
+		{
+			// contents that are thrown away, aliased memory included, still can't transition to undefined
+			const VkImageLayout layout = (initialLayout != VK_IMAGE_LAYOUT_UNDEFINED) ? initialLayout
+				: (state->layout != VK_IMAGE_LAYOUT_UNDEFINED) ? state->layout : info->layout;
+			trackImageUse(queueContext, image, 0, 1, info->stages, info->access, layout);
+		}
+	}
+}
+
+static void endTrackedRenderPass(struct DeviceQueueContext* queueContext)
+{
+	RenderPass renderPass = queueContext->passRenderPass;
+	Framebuffer framebuffer = queueContext->passFramebuffer;
+	returnIfNot(renderPass && framebuffer);
+	for (uint32_t i = 0; i < framebuffer->numImages; i++)
+	{
+		const struct ResourceUsageInfo* info = &kResourceUsages[(i < renderPass->numColor) ? eResourceUsage_ColorTarget : eResourceUsage_DepthStencilTarget];
+		struct ResourceState* state = &framebuffer->images[i]->state[0];
+		memset(state, 0, sizeof(struct ResourceState));
+		state->writeStages = info->stages;
+		state->writeAccess = info->access & kWriteAccess;
+		state->layout = renderPass->attachment[i].finalLayout;
+	}
+	queueContext->passRenderPass = NULL;
+	queueContext->passFramebuffer = NULL;
+}
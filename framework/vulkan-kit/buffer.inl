@@ -3,7 +3,7 @@
 struct BufferContext
 {
 	VkBuffer handle;
-	VkDeviceMemory memory;
+	struct MemoryAllocation memory;
 	void* mapped;
 };
 
@@ -11,6 +11,8 @@ struct BufferT
 {
 	size_t size;
 	DeviceQueue queue;
+	DeviceQueue owner;
+	struct ResourceState state;
 	struct BufferContext* context;
 };
 
@@ -25,6 +27,7 @@ static Buffer createBuffer(size_t size, VkBufferUsageFlags usage, DeviceQueue qu
 
 	retval->size = size;
 	retval->queue = queue;
+	retval->owner = eDeviceQueue_Invalid;
 	size_t numObjects = (queue == eDeviceQueue_Invalid) ? 1 : QueueContext[queue].numCommandBuffers;
 	retval->context = calloc(numObjects, sizeof(struct BufferContext));
 	breakIfNot(retval->context);
@@ -40,7 +43,7 @@ static Buffer createBuffer(size_t size, VkBufferUsageFlags usage, DeviceQueue qu
 	if (queue != eDeviceQueue_Invalid || forceCpuWritable)
 	{
 		memReqired = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-		if (usage != VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+		if (!(usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT))
 		{
 			memExcluded = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 		}
@@ -59,19 +62,8 @@ static Buffer createBuffer(size_t size, VkBufferUsageFlags usage, DeviceQueue qu
 			.usage = usage
 		};
 		breakIfFailed(vkCreateBuffer(Device, &bci, Alloc, &retval->context[i].handle));
-		VkMemoryRequirements memReq;
-		vkGetBufferMemoryRequirements(Device, retval->context[i].handle, &memReq);
-		VkMemoryAllocateInfo mai = {
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = memReq.size,
-			.memoryTypeIndex = findMemoryType(&memReq, memReqired, memExcluded, memMaybe)
-		};
-		breakIfFailed(vkAllocateMemory(Device, &mai, Alloc, &retval->context[i].memory));
-		vkBindBufferMemory(Device, retval->context[i].handle, retval->context[i].memory, 0);
-		if (queue != eDeviceQueue_Invalid || forceCpuWritable)
-		{
-			breakIfFailed(vkMapMemory(Device, retval->context[i].memory, 0, VK_WHOLE_SIZE, 0, &retval->context[i].mapped));
-		}
+		allocateDeviceMemory(&retval->context[i].memory, retval->context[i].handle, VK_NULL_HANDLE, memReqired, memExcluded, memMaybe);
+		retval->context[i].mapped = retval->context[i].memory.mapped;
 	}
 
 	return retval;
@@ -79,17 +71,30 @@ static Buffer createBuffer(size_t size, VkBufferUsageFlags usage, DeviceQueue qu
 
 Buffer createVertexArray(size_t bytes, DeviceQueue queue)
 {
-	return createBuffer(bytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, queue, false);
+	Buffer retval = createBuffer(bytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, queue, false);
+	traceCreate(eTraceOp_CreateVertexArray, traceKey(retval), bytes, queue);
+	return retval;
 }
 
 Buffer createUniformBuffer(size_t bytes, DeviceQueue queue)
 {
-	return createBuffer(bytes, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, queue, false);
+	Buffer retval = createBuffer(bytes, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, queue, false);
+	traceCreate(eTraceOp_CreateUniformBuffer, traceKey(retval), bytes, queue);
+	return retval;
+}
+
+Buffer createStorageBuffer(size_t bytes, DeviceQueue queue)
+{
+	Buffer retval = createBuffer(bytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, queue, false);
+	traceCreate(eTraceOp_CreateStorageBuffer, traceKey(retval), bytes, queue);
+	return retval;
 }
 
 Buffer createUploadBuffer(size_t bytes, DeviceQueue queue)
 {
-	return createBuffer(bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue, true);
+	Buffer retval = createBuffer(bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue, true);
+	traceCreate(eTraceOp_CreateUploadBuffer, traceKey(retval), bytes, queue);
+	return retval;
 }
 
 void* getBufferMappedPtr(Buffer buffer)
@@ -97,23 +102,32 @@ void* getBufferMappedPtr(Buffer buffer)
 	if (buffer)
 	{
 		const uint32_t index = (buffer->queue == eDeviceQueue_Invalid) ? 0 : QueueContext[buffer->queue].currentIndex;
+		traceMappedBuffer(traceKey(buffer), buffer->context[index].mapped, buffer->size);
 		return buffer->context[index].mapped;
 	}
 	return NULL;
 }
 
-void destroyBuffer(Buffer buffer)
+// internal buffers nothing records or binds, so neither the trace nor bundles hear about them
+static void releaseBuffer(Buffer buffer)
 {
 	uint32_t count = (buffer->queue == eDeviceQueue_Invalid) ? 1 : QueueContext[buffer->queue].numCommandBuffers;
 	for (uint32_t i = 0; i < count; i++)
 	{
-		vkFreeMemory(Device, buffer->context[i].memory, Alloc);
 		vkDestroyBuffer(Device, buffer->context[i].handle, Alloc);
+		freeDeviceMemory(&buffer->context[i].memory);
 	}
 	freeMem(buffer->context);
 	freeMem(buffer);
 }
 
+void destroyBuffer(Buffer buffer)
+{
+	traceDestroy(eTraceOp_DestroyBuffer, traceKey(buffer));
+	releaseBuffer(buffer);
+	SDL_AtomicIncRef(&ResourceGeneration);
+}
+
 VkBuffer getBufferHandle(Buffer buffer)
 {
 	const uint32_t index = (buffer->queue == eDeviceQueue_Invalid) ? 0 : QueueContext[buffer->queue].currentIndex;
@@ -0,0 +1,161 @@
+#pragma once
+
+struct CommandBundleFrame
+{
+	VkCommandBuffer handle;
+	struct DescriptorPoolChain descriptorPools;
+	struct DescriptorCache descriptorCache;
+	uint64_t signature;
+};
+
+// one reusable secondary per frame slot, buffers with per-frame copies resolve to that slot's handle
+struct CommandBundleT
+{
+	struct RecordContext recorder;
+	struct CommandBundleFrame* frames;
+	struct RecordContext* primaryRecorder;
+	VkCommandBuffer primaryBuffer;
+	VkCommandPool cmdPool;
+	DeviceQueue queue;
+	uint32_t numFrames;
+	bool recording;
+	bool active;
+};
+
+CommandBundle createCommandBundle(DeviceQueue queue)
+{
+	const struct DeviceQueueContext* queueContext = &QueueContext[queue];
+	retvalIfNot(queueContext->numCommandBuffers && (queueContext->requiredFlags & VK_QUEUE_GRAPHICS_BIT), NULL);
+	CommandBundle retval = calloc(1, sizeof(struct CommandBundleT));
+	retvalIfNot(retval, NULL);
+	retval->frames = calloc(queueContext->numCommandBuffers, sizeof(struct CommandBundleFrame));
+	if (!retval->frames)
+	{
+		breakIfNot(0);
+		freeMem(retval);
+		return NULL;
+	}
+
+	VkCommandPoolCreateInfo cpci = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = queueContext->queueFamily
+	};
+	breakIfFailed(vkCreateCommandPool(Device, &cpci, Alloc, &retval->cmdPool));
+	VkCommandBufferAllocateInfo cbai = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = retval->cmdPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+		.commandBufferCount = 1
+	};
+	for (uint32_t i = 0; i < queueContext->numCommandBuffers; i++)
+	{
+		breakIfFailed(vkAllocateCommandBuffers(Device, &cbai, &retval->frames[i].handle));
+	}
+	retval->queue = queue;
+	retval->numFrames = queueContext->numCommandBuffers;
+	traceCreate(eTraceOp_CreateCommandBundle, traceKey(retval), queue);
+	return retval;
+}
+
+static uint64_t getCommandBundleSignature(const struct DeviceQueueContext* queueContext)
+{
+	const int generation = SDL_AtomicGet(&ResourceGeneration);
+	uint64_t retval = hashBytes(&generation, sizeof(generation), kHashSeed);
+	retval = hashBytes(&queueContext->inheritance.renderPass, sizeof(VkRenderPass), retval);
+	retval = hashBytes(&queueContext->passViewport, sizeof(VkViewport), retval);
+	retval = hashBytes(&queueContext->passScissor, sizeof(VkRect2D), retval);
+	return retval | 1;
+}
+
+bool beginCommandBundle(CommandBundle bundle)
+{
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	retvalIfNot(bundle->queue == ActiveQueue && queueContext->parallelPass && !Secondary && !bundle->active, false);
+	struct CommandBundleFrame* frame = &bundle->frames[queueContext->currentIndex];
+	const uint64_t signature = getCommandBundleSignature(queueContext);
+	bundle->active = true;
+	bundle->recording = (frame->signature != signature);
+	traceCall(eTraceOp_BeginCommandBundle, traceObject(bundle), bundle->recording);
+	if (!bundle->recording)
+	{
+		return false;
+	}
+
+	// the previous use of this slot retired with its frame fence
+	if (frame->descriptorPools.numPools)
+	{
+		resetDescriptorPools(&frame->descriptorPools);
+		resetDescriptorCache(&frame->descriptorCache);
+	}
+	breakIfFailed(vkResetCommandBuffer(frame->handle, 0));
+	VkCommandBufferInheritanceInfo inheritance = queueContext->inheritance;
+	inheritance.framebuffer = VK_NULL_HANDLE;
+	VkCommandBufferBeginInfo cbbi = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritance
+	};
+	breakIfFailed(vkBeginCommandBuffer(frame->handle, &cbbi));
+	vkCmdSetViewport(frame->handle, 0, 1, &queueContext->passViewport);
+	vkCmdSetScissor(frame->handle, 0, 1, &queueContext->passScissor);
+	frame->signature = signature;
+
+	resetRecordContext(&bundle->recorder, &frame->descriptorPools, &frame->descriptorCache);
+	bundle->recorder.persistent = true;
+	bundle->primaryBuffer = CommandBuffer;
+	bundle->primaryRecorder = Recorder;
+	CommandBuffer = frame->handle;
+	Recorder = &bundle->recorder;
+	SkipDrawCalls = false;
+	return true;
+}
+
+void endCommandBundle(CommandBundle bundle)
+{
+	returnIfNot(bundle->active);
+	traceCall(eTraceOp_EndCommandBundle, traceObject(bundle));
+	struct CommandBundleFrame* frame = &bundle->frames[QueueContext[ActiveQueue].currentIndex];
+	if (bundle->recording)
+	{
+		breakIfFailed(vkEndCommandBuffer(CommandBuffer));
+		if (bundle->recorder.incomplete)
+		{
+			// drawn with a fallback or skipped, record again once the pipeline is ready
+			frame->signature = 0;
+		}
+		flushCommandStats(Recorder);
+		CommandBuffer = bundle->primaryBuffer;
+		Recorder = bundle->primaryRecorder;
+		SkipDrawCalls = false;
+	}
+	vkCmdExecuteCommands(CommandBuffer, 1, &frame->handle);
+	invalidateBoundState(Recorder);
+	bundle->recording = false;
+	bundle->active = false;
+}
+
+void invalidateCommandBundle(CommandBundle bundle)
+{
+	traceCall(eTraceOp_InvalidateCommandBundle, traceObject(bundle));
+	for (uint32_t i = 0; i < bundle->numFrames; i++)
+	{
+		bundle->frames[i].signature = 0;
+	}
+}
+
+void destroyCommandBundle(CommandBundle bundle)
+{
+	if (bundle)
+	{
+		traceDestroy(eTraceOp_DestroyCommandBundle, traceKey(bundle));
+		for (uint32_t i = 0; i < bundle->numFrames; i++)
+		{
+			releaseDescriptorPools(&bundle->frames[i].descriptorPools);
+			releaseDescriptorCache(&bundle->frames[i].descriptorCache);
+		}
+		vkDestroyCommandPool(Device, bundle->cmdPool, Alloc);
+		freeMem(bundle->frames);
+		freeMem(bundle);
+	}
+}
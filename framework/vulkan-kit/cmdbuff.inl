@@ -1,7 +1,41 @@
 #pragma once
 
+static struct CommandStats CommandStatistics;
+static SDL_SpinLock CommandStatsLock = 0;
+
+static void flushCommandStats(struct RecordContext* recorder)
+{
+	const uint64_t* src = (const uint64_t*)&recorder->stats;
+	uint64_t* dst = (uint64_t*)&CommandStatistics;
+	SDL_AtomicLock(&CommandStatsLock);
+	for (uint32_t i = 0; i < sizeof(struct CommandStats) / sizeof(uint64_t); i++)
+	{
+		dst[i] += src[i];
+	}
+	SDL_AtomicUnlock(&CommandStatsLock);
+	memset(&recorder->stats, 0, sizeof(struct CommandStats));
+}
+
+// bound state is undefined after executing secondaries, forget the shadow so the next binds are emitted
+static void invalidateBoundState(struct RecordContext* recorder)
+{
+	recorder->pipelines[VK_PIPELINE_BIND_POINT_GRAPHICS] = VK_NULL_HANDLE;
+	recorder->pipelines[VK_PIPELINE_BIND_POINT_COMPUTE] = VK_NULL_HANDLE;
+	recorder->indexBuffer = VK_NULL_HANDLE;
+	recorder->boundVertexBuffers = 0;
+	recorder->boundPoints = 0;
+}
+
+void getCommandStats(struct CommandStats* stats)
+{
+	SDL_AtomicLock(&CommandStatsLock);
+	*stats = CommandStatistics;
+	SDL_AtomicUnlock(&CommandStatsLock);
+}
+
 void beginCommandBuffer(DeviceQueue queue)
 {
+	traceCall(eTraceOp_BeginCommandBuffer, queue);
 	if (ActiveQueue != queue)
 	{
 		struct DeviceQueueContext* queueContext = &QueueContext[queue];
@@ -12,8 +46,18 @@ void beginCommandBuffer(DeviceQueue queue)
 			switch (vkGetFenceStatus(Device, fence))
 			{
 			case VK_NOT_READY:
+			{
+				profileBegin("vkWaitForFences");
+				const uint64_t start = SDL_GetPerformanceCounter();
 				breakIfFailed(vkWaitForFences(Device, 1, &fence, VK_TRUE, UINT64_MAX));
+				const uint64_t waitUs = (SDL_GetPerformanceCounter() - start) * 1000000ull / SDL_GetPerformanceFrequency();
+				profileEnd();
+				SDL_AtomicLock(&CommandStatsLock);
+				CommandStatistics.fenceWaits++;
+				CommandStatistics.fenceWaitUs += waitUs;
+				SDL_AtomicUnlock(&CommandStatsLock);
 				break;
+			}
 			case VK_SUCCESS:
 				break;
 			default:
@@ -21,37 +65,135 @@ void beginCommandBuffer(DeviceQueue queue)
 				break;
 			}
 			breakIfFailed(vkResetFences(Device, 1, &fence));
+			reclaimStagingFrame(queueContext, index);
+			if (queueContext->cbTimestamps)
+			{
+				resolveTimestampFrame(queueContext, index);
+			}
 			VkCommandBuffer handle = queueContext->cbHandle[index];
 			breakIfFailed(vkResetCommandBuffer(handle, 0));
-			breakIfFailed(vkResetDescriptorPool(Device, queueContext->cbDesc[index], 0));
+			if (queueContext->cbDesc[index].numPools)
+			{
+				resetDescriptorPools(&queueContext->cbDesc[index]);
+				resetDescriptorCache(&queueContext->cbDescCache[index]);
+			}
+			for (uint32_t i = 0; queueContext->secondaries && i < NumRecordingContexts; i++)
+			{
+				struct SecondaryFrame* frame = &queueContext->secondaries[i].frames[index];
+				if (frame->descriptorPools.numPools)
+				{
+					resetDescriptorPools(&frame->descriptorPools);
+					resetDescriptorCache(&frame->descriptorCache);
+				}
+				frame->numUsed = 0;
+			}
 			VkCommandBufferBeginInfo cbbi = {
 				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 				.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
 			};
 			breakIfFailed(vkBeginCommandBuffer(handle, &cbbi));
+			if (queueContext->cbTimestamps)
+			{
+				resetTimestampFrame(queueContext, index, handle);
+			}
 			queueContext->cmdBuffer = handle;
+			SDL_AtomicSet(&queueContext->transientHead, 0);
+			resetRecordContext(&queueContext->recorder, &queueContext->cbDesc[index], &queueContext->cbDescCache[index]);
 		}
 		CommandBuffer = queueContext->cbHandle[index];
-		DescriptorPool = queueContext->cbDesc[index];
+		Recorder = &queueContext->recorder;
 		ActiveQueue = queue;
 	}
 }
 
+// contexts sharing a VkQueue submit under its owner's lock, vkQueueSubmit needs external synchronization
+static void submitToQueue(struct DeviceQueueContext* queueContext, const VkSubmitInfo* si, VkFence fence)
+{
+	SDL_mutex* lock = QueueContext[queueContext->queueOwner].queueLock;
+	SDL_LockMutex(lock);
+	breakIfFailed(vkQueueSubmit(queueContext->queueHandle, 1, si, fence));
+	SDL_UnlockMutex(lock);
+}
+
+static void submitOwnershipReleases(struct DeviceQueueContext* queueContext, uint32_t index, VkSemaphore* waits, VkPipelineStageFlags* waitStages, uint32_t* numWaits)
+{
+	for (int i = 0; i < eDeviceQueue_EnumMax; i++)
+	{
+		struct OwnershipRelease* release = &queueContext->releases[i];
+		if (release->numBufferBarriers == 0 && release->numImageBarriers == 0)
+		{
+			continue;
+		}
+
+		// the releasing queue has to have submitted the writes it is giving up
+		struct DeviceQueueContext* owner = &QueueContext[i];
+		breakIfNot(owner->cmdBuffer == VK_NULL_HANDLE);
+		if (!release->cbHandle)
+		{
+			release->cbHandle = calloc(queueContext->numCommandBuffers, sizeof(VkCommandBuffer));
+			release->cbSemaphore = calloc(queueContext->numCommandBuffers, sizeof(VkSemaphore));
+			breakIfNot(release->cbHandle && release->cbSemaphore);
+			VkCommandBufferAllocateInfo cbai = {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+				.commandPool = owner->cmdPool,
+				.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				.commandBufferCount = queueContext->numCommandBuffers
+			};
+			breakIfFailed(vkAllocateCommandBuffers(Device, &cbai, release->cbHandle));
+			for (uint32_t j = 0; j < queueContext->numCommandBuffers; j++)
+			{
+				VkSemaphoreCreateInfo sci = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+				breakIfFailed(vkCreateSemaphore(Device, &sci, Alloc, &release->cbSemaphore[j]));
+			}
+		}
+
+		VkCommandBuffer handle = release->cbHandle[index];
+		VkCommandBufferBeginInfo cbbi = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+			.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+		};
+		breakIfFailed(vkResetCommandBuffer(handle, 0));
+		breakIfFailed(vkBeginCommandBuffer(handle, &cbbi));
+		vkCmdPipelineBarrier(handle, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, release->numBufferBarriers, release->bufferBarriers, release->numImageBarriers, release->imageBarriers);
+		breakIfFailed(vkEndCommandBuffer(handle));
+		VkSubmitInfo si = {
+			.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+			.commandBufferCount = 1,
+			.pCommandBuffers = &handle,
+			.signalSemaphoreCount = 1,
+			.pSignalSemaphores = &release->cbSemaphore[index]
+		};
+		submitToQueue(owner, &si, VK_NULL_HANDLE);
+		release->numBufferBarriers = 0;
+		release->numImageBarriers = 0;
+
+		waits[*numWaits] = release->cbSemaphore[index];
+		waitStages[*numWaits] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		++*numWaits;
+	}
+}
+
 void submitCommandBuffer(DeviceQueue queue, bool writeSwapchainImage)
 {
+	traceCall(eTraceOp_SubmitCommandBuffer, queue, writeSwapchainImage);
 	struct DeviceQueueContext* queueContext = &QueueContext[queue];
 	const uint32_t index = queueContext->currentIndex;
 	if (queueContext->cmdBuffer != VK_NULL_HANDLE)
 	{
-		VkSemaphore waits[1];
-		VkPipelineStageFlags waitStage[1] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		uint32_t numWaits = 0;
-		if (writeSwapchainImage)
+		VkSemaphore waits[1 + eDeviceQueue_EnumMax];
+		VkPipelineStageFlags waitStage[1 + eDeviceQueue_EnumMax] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		uint32_t numWaits = 0, numSignals = 0;
+		if (writeSwapchainImage && Swapchain != VK_NULL_HANDLE)
 		{
 			waits[0] = SwapchainSemaphores[SwapchainCurrentIndex];
+			++numSignals;
 			++numWaits;
 		}
+		submitOwnershipReleases(queueContext, index, waits, waitStage, &numWaits);
 		VkSemaphore semaphore = queueContext->cbSemaphore[index];
+		flushPendingCopies(queueContext);
+		endStagingFrame(queueContext, index);
+		flushCommandStats(&queueContext->recorder);
 		breakIfFailed(vkEndCommandBuffer(queueContext->cbHandle[index]));
 		
 		VkSubmitInfo si = {
@@ -61,19 +203,20 @@ void submitCommandBuffer(DeviceQueue queue, bool writeSwapchainImage)
 			.pWaitDstStageMask = waitStage,
 			.commandBufferCount = 1,
 			.pCommandBuffers = &queueContext->cbHandle[index],
-			.signalSemaphoreCount = 1,
+			.signalSemaphoreCount = numSignals,
 			.pSignalSemaphores = &semaphore
 		};
 		
-		breakIfFailed(vkQueueSubmit(queueContext->queueHandle, 1, &si, queueContext->cbFence[index]));
+		profileBegin("vkQueueSubmit");
+		submitToQueue(queueContext, &si, queueContext->cbFence[index]);
+		profileEnd();
 
 		queueContext->currentIndex = (index + 1) % queueContext->numCommandBuffers;
 		queueContext->cmdBuffer = VK_NULL_HANDLE;
-		queueContext->numDescriptorWrites = 0;
 		queueContext->numBufferBarriers = 0;
 		queueContext->numImageBarriers = 0;
 
-		if (writeSwapchainImage)
+		if (numSignals)
 		{
 			breakIfNot(SwapchainUpdateSubmit == NULL);
 			SwapchainUpdateSubmit = &queueContext->cbSemaphore[index];
@@ -82,14 +225,44 @@ void submitCommandBuffer(DeviceQueue queue, bool writeSwapchainImage)
 		if (queue == ActiveQueue)
 		{
 			CommandBuffer = VK_NULL_HANDLE;
-			DescriptorPool = VK_NULL_HANDLE;
+			Recorder = NULL;
 			ActiveQueue = eDeviceQueue_Invalid;
 		}
 	}
 }
 
+static bool transferOwnership(DeviceQueue* owner, bool discard, uint32_t* srcFamily, uint32_t* dstFamily)
+{
+	const DeviceQueue from = *owner;
+	*owner = ActiveQueue;
+	*srcFamily = VK_QUEUE_FAMILY_IGNORED;
+	*dstFamily = VK_QUEUE_FAMILY_IGNORED;
+	if (discard || from == eDeviceQueue_Invalid || from == ActiveQueue || QueueContext[from].queueOwner == QueueContext[ActiveQueue].queueOwner)
+	{
+		return false;
+	}
+	// another queue of the same family needs no transfer, only the release semaphore to order against it
+	if (QueueContext[from].queueFamily != QueueContext[ActiveQueue].queueFamily)
+	{
+		*srcFamily = QueueContext[from].queueFamily;
+		*dstFamily = QueueContext[ActiveQueue].queueFamily;
+	}
+	return true;
+}
+
+static VkAccessFlags getReleaseAccess(DeviceQueue owner, VkAccessFlags access)
+{
+	const VkQueueFlags flags = QueueContext[owner].requiredFlags;
+	if (!(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+	{
+		access &= VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	}
+	return access;
+}
+
 void bufferMemoryBarrier(Buffer buffer, VkAccessFlags from, VkAccessFlags to)
 {
+	traceCall(eTraceOp_BufferMemoryBarrier, traceObject(buffer), from, to);
 	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
 	breakIfNot(queueContext->numBufferBarriers < MAX_RESOURCE_BARRIERS);
 	VkBufferMemoryBarrier* barrier = queueContext->bufferBarriers + (queueContext->numBufferBarriers++);
@@ -102,11 +275,29 @@ void bufferMemoryBarrier(Buffer buffer, VkAccessFlags from, VkAccessFlags to)
 	barrier->buffer = getBufferHandle(buffer);
 	barrier->offset = 0;
 	barrier->size = buffer->size;
+
+	// hand written barriers synchronize themselves, useBuffer starts over from here
+	memset(&buffer->state, 0, sizeof(struct ResourceState));
+
+	const DeviceQueue owner = buffer->owner;
+	if (buffer->queue == eDeviceQueue_Invalid && transferOwnership(&buffer->owner, false, &barrier->srcQueueFamilyIndex, &barrier->dstQueueFamilyIndex))
+	{
+		struct OwnershipRelease* release = &queueContext->releases[owner];
+		breakIfNot(release->numBufferBarriers < MAX_RESOURCE_BARRIERS);
+		VkBufferMemoryBarrier* releaseBarrier = release->bufferBarriers + (release->numBufferBarriers++);
+		*releaseBarrier = *barrier;
+		releaseBarrier->srcAccessMask = getReleaseAccess(owner, from);
+		releaseBarrier->dstAccessMask = 0;
+	}
 }
 
 void imageMemoryBarrier(Image image, VkImageLayout fromLayout, VkAccessFlags fromAccess, VkImageLayout toLayout, VkAccessFlags toAccess, ImageSubset subset)
 {
+	traceCall(eTraceOp_ImageMemoryBarrier, traceObject(image), fromLayout, fromAccess, toLayout, toAccess, subset);
 	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	const uint32_t fromMip = imageSubsetFromMip(subset);
+	const uint32_t toMip = fromMip + imageSubsetNumMips(subset);
+	returnIfNot(fromMip < toMip && toMip <= image->mips);
 	breakIfNot(queueContext->numImageBarriers < MAX_RESOURCE_BARRIERS);
 	VkImageMemoryBarrier* barrier = queueContext->imageBarriers + (queueContext->numImageBarriers++);
 	barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -115,7 +306,6 @@ void imageMemoryBarrier(Image image, VkImageLayout fromLayout, VkAccessFlags fro
 	barrier->dstAccessMask = toAccess;
 	barrier->oldLayout = fromLayout;
 	barrier->newLayout = toLayout;
-	//if owner is not current queue, perform ownership transfer
 	barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier->image = image->handle;
@@ -124,11 +314,36 @@ void imageMemoryBarrier(Image image, VkImageLayout fromLayout, VkAccessFlags fro
 	barrier->subresourceRange.levelCount = imageSubsetNumMips(subset);
 	barrier->subresourceRange.baseArrayLayer = imageSubsetFromLayer(subset);
 	barrier->subresourceRange.layerCount = imageSubsetNumLayers(subset);
+
+	for (uint32_t i = fromMip; i < toMip; i++)
+	{
+		memset(&image->state[i], 0, sizeof(struct ResourceState));
+		image->state[i].layout = toLayout;
+	}
+
+	// ownership is tracked per image, so only a barrier over every mip may discard the old contents
+	const DeviceQueue owner = image->owner;
+	const bool discard = (fromLayout == VK_IMAGE_LAYOUT_UNDEFINED && fromMip == 0 && toMip == image->mips);
+	if (transferOwnership(&image->owner, discard, &barrier->srcQueueFamilyIndex, &barrier->dstQueueFamilyIndex))
+	{
+		struct OwnershipRelease* release = &queueContext->releases[owner];
+		breakIfNot(release->numImageBarriers < MAX_RESOURCE_BARRIERS);
+		VkImageMemoryBarrier* releaseBarrier = release->imageBarriers + (release->numImageBarriers++);
+		*releaseBarrier = *barrier;
+		releaseBarrier->srcAccessMask = getReleaseAccess(owner, fromAccess);
+		releaseBarrier->dstAccessMask = 0;
+		if (releaseBarrier->srcQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED)
+		{
+			releaseBarrier->newLayout = releaseBarrier->oldLayout;
+		}
+	}
 }
 
 void pipelineBarrier(VkPipelineStageFlags from, VkPipelineStageFlags to)
 {
+	traceCall(eTraceOp_PipelineBarrier, from, to);
 	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	flushPendingCopies(queueContext);
 	vkCmdPipelineBarrier(CommandBuffer, from, to, 0, 0, NULL, queueContext->numBufferBarriers, queueContext->bufferBarriers, queueContext->numImageBarriers, queueContext->imageBarriers);
 	queueContext->numBufferBarriers = 0;
 	queueContext->numImageBarriers = 0;
@@ -136,12 +351,33 @@ void pipelineBarrier(VkPipelineStageFlags from, VkPipelineStageFlags to)
 
 void updateBuffer(Buffer buffer, const void* data, size_t dstOffset, size_t bytes)
 {
-	const uint32_t index = (buffer->queue == eDeviceQueue_Invalid) ? 0 : QueueContext[buffer->queue].currentIndex;
-	vkCmdUpdateBuffer(CommandBuffer, buffer->context[index].handle, dstOffset, bytes, data);
+	traceData(data, bytes, eTraceOp_UpdateBuffer, traceObject(buffer), dstOffset);
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	VkBuffer src = VK_NULL_HANDLE;
+	VkDeviceSize srcOffset = 0;
+	void* staging = allocateStagingData(queueContext, bytes, &src, &srcOffset);
+	returnIfNot(staging);
+	memcpy(staging, data, bytes);
+	if (buffer->queue == eDeviceQueue_Invalid && buffer->owner == eDeviceQueue_Invalid)
+	{
+		buffer->owner = ActiveQueue;
+	}
+	struct PendingCopy* copy = addPendingCopy(queueContext);
+	copy->src = src;
+	copy->dstBuffer = getBufferHandle(buffer);
+	copy->bufferRegion.srcOffset = srcOffset;
+	copy->bufferRegion.dstOffset = dstOffset;
+	copy->bufferRegion.size = bytes;
+}
+
+static inline int maxInt(int a, int b)
+{
+	return (a < b) ? b : a;
 }
 
 void updateImageMipLevel(Buffer src, Image dst, uint32_t mipLevel)
 {
+	traceCall(eTraceOp_UpdateImageMipLevel, traceObject(src), traceObject(dst), mipLevel);
 	VkBufferImageCopy region = {
 		.imageSubresource = {
 			.aspectMask = dst->aspect,
@@ -150,16 +386,39 @@ void updateImageMipLevel(Buffer src, Image dst, uint32_t mipLevel)
 		},
 		.imageExtent = dst->size
 	};
+	// staged copies into dst go first, so this one lands after them
+	flushPendingCopies(&QueueContext[ActiveQueue]);
 	vkCmdCopyBufferToImage(CommandBuffer, getBufferHandle(src), dst->handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 }
 
-static inline int maxInt(int a, int b)
+void uploadImage(Image dst, uint32_t mipLevel, const void* data, size_t bytes)
 {
-	return (a < b) ? b : a;
+	traceData(data, bytes, eTraceOp_UploadImage, traceObject(dst), mipLevel);
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	VkBuffer src = VK_NULL_HANDLE;
+	VkDeviceSize srcOffset = 0;
+	void* staging = allocateStagingData(queueContext, bytes, &src, &srcOffset);
+	returnIfNot(staging);
+	memcpy(staging, data, bytes);
+	struct PendingCopy* copy = addPendingCopy(queueContext);
+	if (dst->owner == eDeviceQueue_Invalid)
+	{
+		dst->owner = ActiveQueue;
+	}
+	copy->src = src;
+	copy->dstImage = dst->handle;
+	copy->imageRegion.bufferOffset = srcOffset;
+	copy->imageRegion.imageSubresource.aspectMask = dst->aspect;
+	copy->imageRegion.imageSubresource.mipLevel = mipLevel;
+	copy->imageRegion.imageSubresource.layerCount = 1;
+	copy->imageRegion.imageExtent.width = maxInt((int)(dst->size.width >> mipLevel), 1);
+	copy->imageRegion.imageExtent.height = maxInt((int)(dst->size.height >> mipLevel), 1);
+	copy->imageRegion.imageExtent.depth = maxInt((int)(dst->size.depth >> mipLevel), 1);
 }
 
 void blit(Image src, Image dst, ImageSubset srcSubset, ImageSubset dstSubset)
 {
+	traceCall(eTraceOp_Blit, traceObject(src), traceObject(dst), srcSubset, dstSubset);
 	VkImageBlit imageBlit = {
 		.srcSubresource = {
 			.aspectMask = src->aspect,
@@ -188,11 +447,14 @@ void blit(Image src, Image dst, ImageSubset srcSubset, ImageSubset dstSubset)
 			}
 		}
 	};
+	flushPendingCopies(&QueueContext[ActiveQueue]);
 	vkCmdBlitImage(CommandBuffer, src->handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst->handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
 }
 
-void beginRenderPass(RenderPass renderPass, Framebuffer framebuffer)
+static void beginRenderPassContents(RenderPass renderPass, Framebuffer framebuffer, VkSubpassContents contents)
 {
+	beginTrackedRenderPass(&QueueContext[ActiveQueue], renderPass, framebuffer);
+	flushPendingCopies(&QueueContext[ActiveQueue]);
 	uint32_t numClears = 0;
 	const VkClearValue* clears = getRenderPassClearValues(renderPass, &numClears);
 	VkRenderPassBeginInfo rpbi = {
@@ -203,125 +465,527 @@ void beginRenderPass(RenderPass renderPass, Framebuffer framebuffer)
 		.clearValueCount = numClears,
 		.pClearValues = clears
 	};
-	vkCmdBeginRenderPass(CommandBuffer, &rpbi, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(CommandBuffer, &rpbi, contents);
+}
+
+void beginRenderPass(RenderPass renderPass, Framebuffer framebuffer)
+{
+	traceCall(eTraceOp_BeginRenderPass, traceObject(renderPass), traceObject(framebuffer));
+	beginRenderPassContents(renderPass, framebuffer, VK_SUBPASS_CONTENTS_INLINE);
 	vkCmdSetViewport(CommandBuffer, 0, 1, &framebuffer->viewport);
 	vkCmdSetScissor(CommandBuffer, 0, 1, &framebuffer->scissor);
 }
 
+void beginParallelRenderPass(RenderPass renderPass, Framebuffer framebuffer)
+{
+	traceCall(eTraceOp_BeginParallelRenderPass, traceObject(renderPass), traceObject(framebuffer));
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	returnIfNot(queueContext->secondaries || !NumRecordingContexts);
+	beginRenderPassContents(renderPass, framebuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	queueContext->inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	queueContext->inheritance.renderPass = getRenderPassHandle(renderPass);
+	queueContext->inheritance.subpass = 0;
+	queueContext->inheritance.framebuffer = framebuffer->handle;
+	queueContext->passViewport = framebuffer->viewport;
+	queueContext->passScissor = framebuffer->scissor;
+	queueContext->parallelPass = true;
+}
+
 void bindSamplerState(uint32_t binding, SamplerState sampler)
 {
+	traceCall(eTraceOp_BindSamplerState, binding, traceObject(sampler));
 	breakIfNot(binding < MAX_SAMPLER_STATES);
+	struct RecordContext* recorder = Recorder;
+	VkDescriptorImageInfo* info = &recorder->descriptors.samplerStates[binding];
+	recorder->stats.descriptorBinds++;
+	const uint64_t mask = 1ull << (binding + SS_BINDING_OFFSET);
+	if (!(recorder->descriptors.bound & mask) || info->sampler != sampler)
+	{
+		info->sampler = sampler;
+		recorder->descriptors.bound |= mask;
+		recorder->descriptorsDirty = true;
+	}
+	else
+	{
+		recorder->stats.skippedDescriptorBinds++;
+	}
+}
+
+// lock free so worker threads recording secondaries can share the ring
+static void* allocateTransientData(size_t bytes, size_t alignment, VkBuffer* buffer, size_t* offset)
+{
 	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
-	VkDescriptorImageInfo* info = &queueContext->samplerStates[binding];
-	info->sampler = sampler;
-	info->imageView = VK_NULL_HANDLE;
-	info->imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	VkWriteDescriptorSet* descriptorWrite = queueContext->descriptorWrites + (queueContext->numDescriptorWrites++);
-	descriptorWrite->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrite->pNext = NULL;
-	descriptorWrite->dstSet = VK_NULL_HANDLE;
-	descriptorWrite->dstBinding = binding + SS_BINDING_OFFSET;
-	descriptorWrite->dstArrayElement = 0;
-	descriptorWrite->descriptorCount = 1;
-	descriptorWrite->descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-	descriptorWrite->pImageInfo = info;
-	descriptorWrite->pBufferInfo = NULL;
-	descriptorWrite->pTexelBufferView = NULL;
+	// ring memory is rewritten every frame, command bundles must bind persistent buffers
+	retvalIfNot(queueContext->transientRing && !Recorder->persistent, NULL);
+	int current = 0;
+	size_t head = 0;
+	do
+	{
+		current = SDL_AtomicGet(&queueContext->transientHead);
+		head = ((size_t)current + alignment - 1) & ~(alignment - 1);
+		retvalIfNot(head + bytes <= queueContext->transientRing->size, NULL);
+	} while (!SDL_AtomicCAS(&queueContext->transientHead, current, (int)(head + bytes)));
+	*buffer = getBufferHandle(queueContext->transientRing);
+	*offset = head;
+	return (uint8_t*)getBufferMappedPtr(queueContext->transientRing) + head;
 }
 
-void bindUniformBuffer(uint32_t binding, Buffer buffer)
+static void setUniformBinding(uint32_t binding, VkBuffer buffer, size_t range, size_t offset)
 {
 	breakIfNot(binding < MAX_UNIFORM_BUFFERS);
-	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
-	VkDescriptorBufferInfo* info = &queueContext->uniformBuffers[binding];
-	info->buffer = getBufferHandle(buffer);
-	info->offset = 0;
-	info->range = VK_WHOLE_SIZE;
-	VkWriteDescriptorSet* descriptorWrite = queueContext->descriptorWrites + (queueContext->numDescriptorWrites++);
-	descriptorWrite->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrite->pNext = NULL;
-	descriptorWrite->dstSet = VK_NULL_HANDLE;
-	descriptorWrite->dstBinding = binding + UB_BINDING_OFFSET;
-	descriptorWrite->dstArrayElement = 0;
-	descriptorWrite->descriptorCount = 1;
-	descriptorWrite->descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptorWrite->pImageInfo = NULL;
-	descriptorWrite->pBufferInfo = info;
-	descriptorWrite->pTexelBufferView = NULL;
+	struct RecordContext* recorder = Recorder;
+	VkDescriptorBufferInfo* info = &recorder->descriptors.uniformBuffers[binding];
+	recorder->stats.descriptorBinds++;
+	const uint64_t mask = 1ull << (binding + UB_BINDING_OFFSET);
+	const bool changed = !(recorder->descriptors.bound & mask) || info->buffer != buffer || info->range != range;
+	if (changed)
+	{
+		info->buffer = buffer;
+		info->range = range;
+		recorder->descriptors.bound |= mask;
+		recorder->descriptorsDirty = true;
+	}
+	if (recorder->uniformOffsets[binding] != (uint32_t)offset)
+	{
+		recorder->uniformOffsets[binding] = (uint32_t)offset;
+		recorder->offsetsDirty = true;
+	}
+	else if (!changed)
+	{
+		recorder->stats.skippedDescriptorBinds++;
+	}
+}
+
+void bindUniformBuffer(uint32_t binding, Buffer buffer)
+{
+	traceCall(eTraceOp_BindUniformBuffer, binding, traceObject(buffer));
+	setUniformBinding(binding, getBufferHandle(buffer), buffer->size, 0);
+}
+
+void* bindUniformData(uint32_t binding, size_t bytes)
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	size_t offset = 0;
+	void* retval = allocateTransientData(bytes, (size_t)DeviceProperties.limits.minUniformBufferOffsetAlignment, &buffer, &offset);
+	if (retval)
+	{
+		setUniformBinding(binding, buffer, bytes, offset);
+	}
+	traceMapped(eTraceOp_BindUniformData, retval, bytes, binding, bytes);
+	return retval;
 }
 
 void bindSampledImage(uint32_t binding, Image image)
 {
-	breakIfNot(binding < MAX_SAMPLER_STATES);
-	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
-	VkDescriptorImageInfo* info = &queueContext->sampledImages[binding];
-	info->sampler = VK_NULL_HANDLE;
-	info->imageView = image->view;
-	info->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	VkWriteDescriptorSet* descriptorWrite = queueContext->descriptorWrites + (queueContext->numDescriptorWrites++);
-	descriptorWrite->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrite->pNext = NULL;
-	descriptorWrite->dstSet = VK_NULL_HANDLE;
-	descriptorWrite->dstBinding = binding + SI_BINDING_OFFSET;
-	descriptorWrite->dstArrayElement = 0;
-	descriptorWrite->descriptorCount = 1;
-	descriptorWrite->descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-	descriptorWrite->pImageInfo = info;
-	descriptorWrite->pBufferInfo = NULL;
-	descriptorWrite->pTexelBufferView = NULL;
+	traceCall(eTraceOp_BindSampledImage, binding, traceObject(image));
+	breakIfNot(binding < MAX_SAMPLED_IMAGES);
+	struct RecordContext* recorder = Recorder;
+	VkDescriptorImageInfo* info = &recorder->descriptors.sampledImages[binding];
+	recorder->stats.descriptorBinds++;
+	const uint64_t mask = 1ull << (binding + SI_BINDING_OFFSET);
+	if (!(recorder->descriptors.bound & mask) || info->imageView != image->view)
+	{
+		info->imageView = image->view;
+		info->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		recorder->descriptors.bound |= mask;
+		recorder->descriptorsDirty = true;
+	}
+	else
+	{
+		recorder->stats.skippedDescriptorBinds++;
+	}
+}
+
+void bindStorageBuffer(uint32_t binding, Buffer buffer)
+{
+	traceCall(eTraceOp_BindStorageBuffer, binding, traceObject(buffer));
+	breakIfNot(binding < MAX_STORAGE_BUFFERS);
+	struct RecordContext* recorder = Recorder;
+	VkDescriptorBufferInfo* info = &recorder->descriptors.storageBuffers[binding];
+	const VkBuffer handle = getBufferHandle(buffer);
+	recorder->stats.descriptorBinds++;
+	const uint64_t mask = 1ull << (binding + SB_BINDING_OFFSET);
+	if (!(recorder->descriptors.bound & mask) || info->buffer != handle)
+	{
+		info->buffer = handle;
+		info->range = VK_WHOLE_SIZE;
+		recorder->descriptors.bound |= mask;
+		recorder->descriptorsDirty = true;
+	}
+	else
+	{
+		recorder->stats.skippedDescriptorBinds++;
+	}
+}
+
+void bindStorageImage(uint32_t binding, Image image)
+{
+	traceCall(eTraceOp_BindStorageImage, binding, traceObject(image));
+	breakIfNot(binding < MAX_STORAGE_IMAGES);
+	struct RecordContext* recorder = Recorder;
+	VkDescriptorImageInfo* info = &recorder->descriptors.storageImages[binding];
+	recorder->stats.descriptorBinds++;
+	const uint64_t mask = 1ull << (binding + ST_BINDING_OFFSET);
+	if (!(recorder->descriptors.bound & mask) || info->imageView != image->view)
+	{
+		info->imageView = image->view;
+		info->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		recorder->descriptors.bound |= mask;
+		recorder->descriptorsDirty = true;
+	}
+	else
+	{
+		recorder->stats.skippedDescriptorBinds++;
+	}
+}
+
+static void setVertexBinding(uint32_t binding, VkBuffer buffer, VkDeviceSize offset)
+{
+	struct RecordContext* recorder = Recorder;
+	recorder->stats.vertexBufferBinds++;
+	if (binding < MAX_VERTEX_BUFFERS)
+	{
+		const uint32_t mask = 1u << binding;
+		if ((recorder->boundVertexBuffers & mask) && recorder->vertexBuffers[binding] == buffer && recorder->vertexOffsets[binding] == offset)
+		{
+			recorder->stats.skippedVertexBufferBinds++;
+			return;
+		}
+		recorder->vertexBuffers[binding] = buffer;
+		recorder->vertexOffsets[binding] = offset;
+		recorder->boundVertexBuffers |= mask;
+	}
+	vkCmdBindVertexBuffers(CommandBuffer, binding, 1, &buffer, &offset);
+}
+
+static void setIndexBinding(VkIndexType indexType, VkBuffer buffer, VkDeviceSize offset)
+{
+	struct RecordContext* recorder = Recorder;
+	recorder->stats.indexBufferBinds++;
+	if (recorder->indexBuffer == buffer && recorder->indexOffset == offset && recorder->indexType == indexType)
+	{
+		recorder->stats.skippedIndexBufferBinds++;
+		return;
+	}
+	recorder->indexBuffer = buffer;
+	recorder->indexOffset = offset;
+	recorder->indexType = indexType;
+	vkCmdBindIndexBuffer(CommandBuffer, buffer, offset, indexType);
 }
 
 void bindVertexBufferRange(uint32_t binding, Buffer buffer, size_t offset)
 {
-	VkBuffer bufferHandle = getBufferHandle(buffer);
-	vkCmdBindVertexBuffers(CommandBuffer, binding, 1, &bufferHandle, &offset);
+	traceCall(eTraceOp_BindVertexBufferRange, binding, traceObject(buffer), offset);
+	setVertexBinding(binding, getBufferHandle(buffer), offset);
 }
 
 void bindIndexBufferRange(VkIndexType indexType, Buffer buffer, size_t offset)
 {
-	vkCmdBindIndexBuffer(CommandBuffer, getBufferHandle(buffer), offset, indexType);
+	traceCall(eTraceOp_BindIndexBufferRange, indexType, traceObject(buffer), offset);
+	setIndexBinding(indexType, getBufferHandle(buffer), offset);
+}
+
+void* bindVertexData(uint32_t binding, size_t bytes)
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	size_t offset = 0;
+	void* retval = allocateTransientData(bytes, 16, &buffer, &offset);
+	if (retval)
+	{
+		setVertexBinding(binding, buffer, offset);
+	}
+	traceMapped(eTraceOp_BindVertexData, retval, bytes, binding, bytes);
+	return retval;
+}
+
+void* bindIndexData(VkIndexType indexType, size_t bytes)
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	size_t offset = 0;
+	void* retval = allocateTransientData(bytes, 16, &buffer, &offset);
+	if (retval)
+	{
+		setIndexBinding(indexType, buffer, offset);
+	}
+	traceMapped(eTraceOp_BindIndexData, retval, bytes, indexType, bytes);
+	return retval;
+}
+
+static void setPipelineBinding(VkPipelineBindPoint bindPoint, VkPipeline handle)
+{
+	struct RecordContext* recorder = Recorder;
+	recorder->stats.pipelineBinds++;
+	if (recorder->pipelines[bindPoint] == handle)
+	{
+		recorder->stats.skippedPipelineBinds++;
+		return;
+	}
+	recorder->pipelines[bindPoint] = handle;
+	vkCmdBindPipeline(CommandBuffer, bindPoint, handle);
 }
 
 void bindGraphicsPipeline(Pipeline pipeline)
 {
-	vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, getPipelineHandle(pipeline));
+	traceCall(eTraceOp_BindGraphicsPipeline, traceObject(pipeline));
+	VkPipeline handle = getPipelineHandle(pipeline);
+	SkipDrawCalls = (handle == VK_NULL_HANDLE);
+	if (!pipeline || SDL_AtomicGet(&pipeline->status) != ePipelineStatus_Ready)
+	{
+		Recorder->incomplete = true;
+	}
+	if (!SkipDrawCalls)
+	{
+		setPipelineBinding(VK_PIPELINE_BIND_POINT_GRAPHICS, handle);
+	}
 }
 
-static VkDescriptorSet applyPendingDescriptorUpdates()
+static void applyPendingDescriptorUpdates(VkPipelineBindPoint bindPoint)
 {
-	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
-	if (queueContext->numDescriptorWrites)
-	{
-		VkDescriptorSet retval = VK_NULL_HANDLE;
-		VkDescriptorSetAllocateInfo dsai = {
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-			.descriptorPool = DescriptorPool,
-			.descriptorSetCount = 1,
-			.pSetLayouts = &DescriptorSetLayout
-		};
-		breakIfFailed(vkAllocateDescriptorSets(Device, &dsai, &retval));
-		for (uint32_t i = 0; i < queueContext->numDescriptorWrites; i++)
+	struct RecordContext* recorder = Recorder;
+	if (recorder->descriptorsDirty && !PushDescriptors && recorder->descriptors.bound)
+	{
+		struct DescriptorCache* cache = recorder->descriptorCache;
+		const uint64_t key = hashBytes(&recorder->descriptors, sizeof(struct DescriptorTuple), kHashSeed);
+		VkDescriptorSet set = findCachedDescriptorSet(cache, &recorder->descriptors, key);
+		if (set == VK_NULL_HANDLE)
 		{
-			queueContext->descriptorWrites[i].dstSet = retval;
+			set = allocateDescriptorSet(recorder->descriptorPools);
+			returnIfNot(set != VK_NULL_HANDLE);
+
+			VkWriteDescriptorSet writes[MAX_SHADER_BINDINGS];
+			const uint32_t numWrites = getDescriptorWrites(&recorder->descriptors, set, NULL, NULL, writes);
+			vkUpdateDescriptorSets(Device, numWrites, writes, 0, NULL);
+			addCachedDescriptorSet(cache, &recorder->descriptors, key, set);
 		}
-		vkUpdateDescriptorSets(Device, queueContext->numDescriptorWrites, queueContext->descriptorWrites, 0, NULL);
-		queueContext->numDescriptorWrites = 0;
-		return retval;
+		if (set != recorder->descriptorSet)
+		{
+			recorder->descriptorSet = set;
+			recorder->offsetsDirty = true;
+		}
+		recorder->descriptorsDirty = false;
+	}
+	if (recorder->descriptorsDirty || recorder->offsetsDirty)
+	{
+		// graphics and compute keep separate descriptor bindings
+		recorder->boundPoints = 0;
+		recorder->descriptorsDirty = false;
+		recorder->offsetsDirty = false;
+	}
+	if (recorder->boundPoints & (1u << bindPoint))
+	{
+		return;
 	}
-	return VK_NULL_HANDLE;
+
+	if (PushDescriptors)
+	{
+		VkWriteDescriptorSet writes[MAX_SHADER_BINDINGS];
+		VkDescriptorBufferInfo pushUniforms[MAX_UNIFORM_BUFFERS];
+		const uint32_t numWrites = getDescriptorWrites(&recorder->descriptors, VK_NULL_HANDLE, recorder->uniformOffsets, pushUniforms, writes);
+		if (numWrites)
+		{
+			recorder->stats.descriptorSetBinds++;
+			vkCmdPushDescriptorSetKHR(CommandBuffer, bindPoint, PipelineLayout, 0, numWrites, writes);
+		}
+	}
+	else if (recorder->descriptorSet != VK_NULL_HANDLE)
+	{
+		recorder->stats.descriptorSetBinds++;
+		vkCmdBindDescriptorSets(CommandBuffer, bindPoint, PipelineLayout, 0, 1, &recorder->descriptorSet, MAX_UNIFORM_BUFFERS, recorder->uniformOffsets);
+	}
+	recorder->boundPoints |= 1u << bindPoint;
 }
 
 void drawIndexed(uint32_t numIndices, uint32_t numInstances, uint32_t firstIndex, uint32_t firstVertex, uint32_t firstInstance)
 {
-	VkDescriptorSet descriptorSet = applyPendingDescriptorUpdates();
-	if (descriptorSet != VK_NULL_HANDLE)
+	traceCall(eTraceOp_DrawIndexed, numIndices, numInstances, firstIndex, firstVertex, firstInstance);
+	if (SkipDrawCalls)
 	{
-		vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+		return;
 	}
+	applyPendingDescriptorUpdates(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	Recorder->stats.draws++;
 	vkCmdDrawIndexed(CommandBuffer, numIndices, numInstances, firstIndex, firstVertex, firstInstance);
 }
 
+static void drawIndexedIndirectHandle(VkBuffer buffer, VkDeviceSize offset, uint32_t numDraws)
+{
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	Recorder->stats.draws++;
+	Recorder->stats.indirectDraws += numDraws;
+	if (MultiDrawIndirect || numDraws <= 1)
+	{
+		vkCmdDrawIndexedIndirect(CommandBuffer, buffer, offset, numDraws, stride);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < numDraws; i++)
+		{
+			vkCmdDrawIndexedIndirect(CommandBuffer, buffer, offset + (VkDeviceSize)i * stride, 1, stride);
+		}
+	}
+}
+
+void drawIndexedIndirect(Buffer buffer, size_t offset, uint32_t numDraws)
+{
+	traceCall(eTraceOp_DrawIndexedIndirect, traceObject(buffer), offset, numDraws);
+	if (SkipDrawCalls)
+	{
+		return;
+	}
+	applyPendingDescriptorUpdates(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	drawIndexedIndirectHandle(getBufferHandle(buffer), offset, numDraws);
+}
+
+// without VK_KHR_draw_indirect_count all maxDraws records are issued, the writer must zero instanceCount of unused ones
+void drawIndexedIndirectCount(Buffer buffer, size_t offset, Buffer countBuffer, size_t countOffset, uint32_t maxDraws)
+{
+	traceCall(eTraceOp_DrawIndexedIndirectCount, traceObject(buffer), offset, traceObject(countBuffer), countOffset, maxDraws);
+	if (SkipDrawCalls)
+	{
+		return;
+	}
+	applyPendingDescriptorUpdates(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	if (DrawIndirectCount)
+	{
+		Recorder->stats.draws++;
+		Recorder->stats.indirectDraws += maxDraws;
+		vkCmdDrawIndexedIndirectCountKHR(CommandBuffer, getBufferHandle(buffer), offset, getBufferHandle(countBuffer), countOffset, maxDraws, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else
+	{
+		drawIndexedIndirectHandle(getBufferHandle(buffer), offset, maxDraws);
+	}
+}
+
+void drawIndexedMulti(const VkDrawIndexedIndirectCommand* draws, uint32_t numDraws)
+{
+	traceData(draws, numDraws * sizeof(VkDrawIndexedIndirectCommand), eTraceOp_DrawIndexedMulti, numDraws);
+	if (SkipDrawCalls || !numDraws)
+	{
+		return;
+	}
+	VkBuffer buffer = VK_NULL_HANDLE;
+	size_t offset = 0;
+	void* data = allocateTransientData(numDraws * sizeof(VkDrawIndexedIndirectCommand), 16, &buffer, &offset);
+	returnIfNot(data);
+	memcpy(data, draws, numDraws * sizeof(VkDrawIndexedIndirectCommand));
+	applyPendingDescriptorUpdates(VK_PIPELINE_BIND_POINT_GRAPHICS);
+	drawIndexedIndirectHandle(buffer, offset, numDraws);
+}
+
+void bindComputePipeline(Pipeline pipeline)
+{
+	traceCall(eTraceOp_BindComputePipeline, traceObject(pipeline));
+	VkPipeline handle = getPipelineHandle(pipeline);
+	SkipDispatches = (handle == VK_NULL_HANDLE);
+	if (!SkipDispatches)
+	{
+		setPipelineBinding(VK_PIPELINE_BIND_POINT_COMPUTE, handle);
+	}
+}
+
+void dispatch(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ)
+{
+	traceCall(eTraceOp_Dispatch, groupsX, groupsY, groupsZ);
+	if (SkipDispatches)
+	{
+		return;
+	}
+	applyPendingDescriptorUpdates(VK_PIPELINE_BIND_POINT_COMPUTE);
+	Recorder->stats.dispatches++;
+	flushPendingCopies(&QueueContext[ActiveQueue]);
+	vkCmdDispatch(CommandBuffer, groupsX, groupsY, groupsZ);
+}
+
+void dispatchIndirect(Buffer buffer, size_t offset)
+{
+	traceCall(eTraceOp_DispatchIndirect, traceObject(buffer), offset);
+	if (SkipDispatches)
+	{
+		return;
+	}
+	applyPendingDescriptorUpdates(VK_PIPELINE_BIND_POINT_COMPUTE);
+	Recorder->stats.dispatches++;
+	flushPendingCopies(&QueueContext[ActiveQueue]);
+	vkCmdDispatchIndirect(CommandBuffer, getBufferHandle(buffer), offset);
+}
+
 void endRenderPass(void)
 {
+	traceCall(eTraceOp_EndRenderPass);
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	if (queueContext->parallelPass)
+	{
+		// secondaries run in context order regardless of which thread finished first
+		VkCommandBuffer handles[MAX_RECORDING_CONTEXTS];
+		uint32_t numHandles = 0;
+		for (uint32_t i = 0; i < NumRecordingContexts; i++)
+		{
+			struct SecondaryContext* secondary = &queueContext->secondaries[i];
+			if (secondary->pending)
+			{
+				handles[numHandles++] = secondary->pending;
+				secondary->pending = VK_NULL_HANDLE;
+			}
+		}
+		if (numHandles)
+		{
+			vkCmdExecuteCommands(CommandBuffer, numHandles, handles);
+		}
+		queueContext->parallelPass = false;
+		invalidateBoundState(&queueContext->recorder);
+	}
 	vkCmdEndRenderPass(CommandBuffer);
+	endTrackedRenderPass(queueContext);
+}
+
+void beginRecordingContext(uint32_t context)
+{
+	traceCall(eTraceOp_BeginRecordingContext, context);
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	returnIfNot(queueContext->parallelPass && context < NumRecordingContexts);
+	struct SecondaryContext* secondary = &queueContext->secondaries[context];
+	struct SecondaryFrame* frame = &secondary->frames[queueContext->currentIndex];
+	breakIfNot(secondary->pending == VK_NULL_HANDLE);
+	if (frame->numUsed == frame->numHandles)
+	{
+		safeRealloc(frame->cbHandle, (frame->numHandles + 1) * sizeof(VkCommandBuffer));
+		VkCommandBufferAllocateInfo cbai = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = secondary->cmdPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1
+		};
+		breakIfFailed(vkAllocateCommandBuffers(Device, &cbai, &frame->cbHandle[frame->numHandles++]));
+	}
+
+	VkCommandBuffer handle = frame->cbHandle[frame->numUsed++];
+	breakIfFailed(vkResetCommandBuffer(handle, 0));
+	VkCommandBufferBeginInfo cbbi = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &queueContext->inheritance
+	};
+	breakIfFailed(vkBeginCommandBuffer(handle, &cbbi));
+	vkCmdSetViewport(handle, 0, 1, &queueContext->passViewport);
+	vkCmdSetScissor(handle, 0, 1, &queueContext->passScissor);
+
+	resetRecordContext(&secondary->recorder, &frame->descriptorPools, &frame->descriptorCache);
+	CommandBuffer = handle;
+	Recorder = &secondary->recorder;
+	Secondary = secondary;
+	SkipDrawCalls = false;
+	SkipDispatches = false;
+}
+
+void endRecordingContext(void)
+{
+	traceCall(eTraceOp_EndRecordingContext);
+	returnIfNot(Secondary);
+	breakIfFailed(vkEndCommandBuffer(CommandBuffer));
+	flushCommandStats(Recorder);
+	Secondary->pending = CommandBuffer;
+	CommandBuffer = VK_NULL_HANDLE;
+	Recorder = NULL;
+	Secondary = NULL;
 }
@@ -0,0 +1,247 @@
+#pragma once
+
+static void setDescriptorWrite(VkWriteDescriptorSet* write, VkDescriptorSet set, uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo* image, const VkDescriptorBufferInfo* buffer)
+{
+	write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write->pNext = NULL;
+	write->dstSet = set;
+	write->dstBinding = binding;
+	write->dstArrayElement = 0;
+	write->descriptorCount = 1;
+	write->descriptorType = type;
+	write->pImageInfo = image;
+	write->pBufferInfo = buffer;
+	write->pTexelBufferView = NULL;
+}
+
+// pushUniforms receives the uniform ranges with their offsets baked in, set writes use dynamic offsets instead
+static uint32_t getDescriptorWrites(const struct DescriptorTuple* tuple, VkDescriptorSet set, const uint32_t* offsets, VkDescriptorBufferInfo* pushUniforms, VkWriteDescriptorSet* writes)
+{
+	uint32_t numWrites = 0;
+#if MAX_SAMPLER_STATES
+	for (uint32_t i = 0; i < MAX_SAMPLER_STATES; i++)
+	{
+		if (tuple->bound & (1ull << (i + SS_BINDING_OFFSET)))
+		{
+			setDescriptorWrite(&writes[numWrites++], set, i + SS_BINDING_OFFSET, VK_DESCRIPTOR_TYPE_SAMPLER, &tuple->samplerStates[i], NULL);
+		}
+	}
+#endif
+#if MAX_UNIFORM_BUFFERS
+	for (uint32_t i = 0; i < MAX_UNIFORM_BUFFERS; i++)
+	{
+		if (tuple->bound & (1ull << (i + UB_BINDING_OFFSET)))
+		{
+			if (pushUniforms)
+			{
+				pushUniforms[i] = tuple->uniformBuffers[i];
+				pushUniforms[i].offset = offsets[i];
+				setDescriptorWrite(&writes[numWrites++], set, i + UB_BINDING_OFFSET, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NULL, &pushUniforms[i]);
+			}
+			else
+			{
+				setDescriptorWrite(&writes[numWrites++], set, i + UB_BINDING_OFFSET, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, NULL, &tuple->uniformBuffers[i]);
+			}
+		}
+	}
+#endif
+#if MAX_SAMPLED_IMAGES
+	for (uint32_t i = 0; i < MAX_SAMPLED_IMAGES; i++)
+	{
+		if (tuple->bound & (1ull << (i + SI_BINDING_OFFSET)))
+		{
+			setDescriptorWrite(&writes[numWrites++], set, i + SI_BINDING_OFFSET, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &tuple->sampledImages[i], NULL);
+		}
+	}
+#endif
+#if MAX_STORAGE_BUFFERS
+	for (uint32_t i = 0; i < MAX_STORAGE_BUFFERS; i++)
+	{
+		if (tuple->bound & (1ull << (i + SB_BINDING_OFFSET)))
+		{
+			setDescriptorWrite(&writes[numWrites++], set, i + SB_BINDING_OFFSET, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &tuple->storageBuffers[i]);
+		}
+	}
+#endif
+#if MAX_STORAGE_IMAGES
+	for (uint32_t i = 0; i < MAX_STORAGE_IMAGES; i++)
+	{
+		if (tuple->bound & (1ull << (i + ST_BINDING_OFFSET)))
+		{
+			setDescriptorWrite(&writes[numWrites++], set, i + ST_BINDING_OFFSET, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &tuple->storageImages[i], NULL);
+		}
+	}
+#endif
+	(void)offsets;
+	(void)pushUniforms;
+	return numWrites;
+}
+
+// open addressing over entry indices + 1, kept at most half full
+static VkDescriptorSet findCachedDescriptorSet(const struct DescriptorCache* cache, const struct DescriptorTuple* tuple, uint64_t key)
+{
+	const uint32_t mask = cache->numSlots - 1;
+	for (uint32_t slot = (uint32_t)key & mask; cache->numSlots && cache->slots[slot]; slot = (slot + 1) & mask)
+	{
+		const struct DescriptorCacheEntry* entry = &cache->entries[cache->slots[slot] - 1];
+		if (entry->key == key && memcmp(&entry->tuple, tuple, sizeof(struct DescriptorTuple)) == 0)
+		{
+			return entry->set;
+		}
+	}
+	return VK_NULL_HANDLE;
+}
+
+static void insertCachedDescriptorSet(struct DescriptorCache* cache, uint32_t entryIndex)
+{
+	const uint32_t mask = cache->numSlots - 1;
+	uint32_t slot = (uint32_t)cache->entries[entryIndex].key & mask;
+	while (cache->slots[slot])
+	{
+		slot = (slot + 1) & mask;
+	}
+	cache->slots[slot] = entryIndex + 1;
+}
+
+static void addCachedDescriptorSet(struct DescriptorCache* cache, const struct DescriptorTuple* tuple, uint64_t key, VkDescriptorSet set)
+{
+	if (cache->numEntries == cache->maxEntries)
+	{
+		cache->maxEntries = (cache->maxEntries) ? cache->maxEntries * 2 : 64;
+		safeRealloc(cache->entries, cache->maxEntries * sizeof(struct DescriptorCacheEntry));
+	}
+	if ((cache->numEntries + 1) * 2 > cache->numSlots)
+	{
+		cache->numSlots = (cache->numSlots) ? cache->numSlots * 2 : 128;
+		freeMem(cache->slots);
+		cache->slots = calloc(cache->numSlots, sizeof(uint32_t));
+		breakIfNot(cache->slots);
+		for (uint32_t i = 0; i < cache->numEntries; i++)
+		{
+			insertCachedDescriptorSet(cache, i);
+		}
+	}
+
+	struct DescriptorCacheEntry* entry = &cache->entries[cache->numEntries];
+	memcpy(&entry->tuple, tuple, sizeof(struct DescriptorTuple));
+	entry->key = key;
+	entry->set = set;
+	insertCachedDescriptorSet(cache, cache->numEntries++);
+}
+
+static void resetDescriptorCache(struct DescriptorCache* cache)
+{
+	if (cache->numEntries)
+	{
+		memset(cache->slots, 0, cache->numSlots * sizeof(uint32_t));
+		cache->numEntries = 0;
+	}
+}
+
+static void releaseDescriptorCache(struct DescriptorCache* cache)
+{
+	freeMem(cache->entries);
+	freeMem(cache->slots);
+	memset(cache, 0, sizeof(struct DescriptorCache));
+}
+
+static struct DescriptorStats DescriptorStatistics;
+static SDL_SpinLock DescriptorStatsLock = 0;
+
+static void resetRecordContext(struct RecordContext* recorder, struct DescriptorPoolChain* pools, struct DescriptorCache* cache)
+{
+	memset(recorder, 0, sizeof(struct RecordContext));
+	recorder->descriptorPools = pools;
+	recorder->descriptorCache = cache;
+}
+
+static void addDescriptorPool(struct DescriptorPoolChain* chain)
+{
+	VkDescriptorPoolSize poolSizes[_countof(DescriptorPoolSizes)];
+	for (uint32_t i = 0; i < NumDescriptorPoolSizes; i++)
+	{
+		poolSizes[i].type = DescriptorPoolSizes[i].type;
+		poolSizes[i].descriptorCount = DescriptorPoolSizes[i].descriptorCount * DescriptorPoolSets;
+	}
+	VkDescriptorPoolCreateInfo dpci = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.maxSets = DescriptorPoolSets,
+		.poolSizeCount = NumDescriptorPoolSizes,
+		.pPoolSizes = poolSizes
+	};
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	breakIfFailed(vkCreateDescriptorPool(Device, &dpci, Alloc, &pool));
+	safeRealloc(chain->pools, (chain->numPools + 1) * sizeof(VkDescriptorPool));
+	chain->pools[chain->numPools++] = pool;
+	SDL_AtomicLock(&DescriptorStatsLock);
+	DescriptorStatistics.numPools++;
+	DescriptorStatistics.setsPerPool = DescriptorPoolSets;
+	SDL_AtomicUnlock(&DescriptorStatsLock);
+}
+
+static VkDescriptorSet allocateDescriptorSet(struct DescriptorPoolChain* chain)
+{
+	VkDescriptorSetAllocateInfo dsai = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &DescriptorSetLayout
+	};
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	for (;;)
+	{
+		const bool grown = (chain->activePool == chain->numPools);
+		if (grown)
+		{
+			addDescriptorPool(chain);
+			SDL_AtomicLock(&DescriptorStatsLock);
+			DescriptorStatistics.numGrowths++;
+			SDL_AtomicUnlock(&DescriptorStatsLock);
+		}
+		dsai.descriptorPool = chain->pools[chain->activePool];
+		const VkResult result = vkAllocateDescriptorSets(Device, &dsai, &set);
+		if (result == VK_SUCCESS)
+		{
+			chain->numSets++;
+			return set;
+		}
+		retvalIfNot(!grown && (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL), VK_NULL_HANDLE);
+		chain->activePool++;
+	}
+}
+
+static void resetDescriptorPools(struct DescriptorPoolChain* chain)
+{
+	for (uint32_t i = 0; i <= chain->activePool && i < chain->numPools; i++)
+	{
+		breakIfFailed(vkResetDescriptorPool(Device, chain->pools[i], 0));
+	}
+	SDL_AtomicLock(&DescriptorStatsLock);
+	DescriptorStatistics.lastFrameSets = chain->numSets;
+	if (chain->numSets > DescriptorStatistics.peakFrameSets)
+	{
+		DescriptorStatistics.peakFrameSets = chain->numSets;
+	}
+	SDL_AtomicUnlock(&DescriptorStatsLock);
+	chain->activePool = 0;
+	chain->numSets = 0;
+}
+
+static void releaseDescriptorPools(struct DescriptorPoolChain* chain)
+{
+	for (uint32_t i = 0; i < chain->numPools; i++)
+	{
+		vkDestroyDescriptorPool(Device, chain->pools[i], Alloc);
+	}
+	SDL_AtomicLock(&DescriptorStatsLock);
+	DescriptorStatistics.numPools -= chain->numPools;
+	SDL_AtomicUnlock(&DescriptorStatsLock);
+	freeMem(chain->pools);
+	memset(chain, 0, sizeof(struct DescriptorPoolChain));
+}
+
+void getDescriptorStats(struct DescriptorStats* stats)
+{
+	SDL_AtomicLock(&DescriptorStatsLock);
+	*stats = DescriptorStatistics;
+	SDL_AtomicUnlock(&DescriptorStatsLock);
+}
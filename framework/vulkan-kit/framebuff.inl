@@ -5,6 +5,8 @@ struct FramebufferT
 	VkFramebuffer handle;
 	VkViewport viewport;
 	VkRect2D scissor;
+	Image* images;
+	uint32_t numImages;
 };
 
 Framebuffer createFramebuffer(RenderPass renderPass, Image* images)
@@ -42,8 +44,18 @@ Framebuffer createFramebuffer(RenderPass renderPass, Image* images)
 	freeMem(imageViews);
 
 	Framebuffer retval = calloc(1, sizeof(struct FramebufferT));
-	if (retval)
+	Image* attachments = malloc(numImages * sizeof(Image));
+	if (!retval || !attachments)
 	{
+		vkDestroyFramebuffer(Device, handle, Alloc);
+		freeMem(attachments);
+		freeMem(retval);
+	}
+	else
+	{
+		memcpy(attachments, images, numImages * sizeof(Image));
+		retval->images = attachments;
+		retval->numImages = numImages;
 		retval->handle = handle;
 		retval->scissor.extent.width = size.width;
 		retval->scissor.extent.height = size.height;
@@ -51,6 +63,7 @@ Framebuffer createFramebuffer(RenderPass renderPass, Image* images)
 		retval->viewport.height = (float)size.height;
 		retval->viewport.maxDepth = 1.f;
 	}
+	traceFramebuffer(traceKey(retval), renderPass, images, numImages);
 	return retval;
 }
 
@@ -58,7 +71,10 @@ void destroyFramebuffer(Framebuffer framebuffer)
 {
 	if (framebuffer)
 	{
+		traceDestroy(eTraceOp_DestroyFramebuffer, traceKey(framebuffer));
 		vkDestroyFramebuffer(Device, framebuffer->handle, Alloc);
+		freeMem(framebuffer->images);
 		freeMem(framebuffer);
+		SDL_AtomicIncRef(&ResourceGeneration);
 	}
 }
@@ -0,0 +1,715 @@
+#pragma once
+
+#define FRAME_GRAPH_NONE UINT32_MAX
+#define FRAME_GRAPH_ATTACHMENTS 8
+
+struct FrameGraphTarget
+{
+	Image image;
+	VkExtent3D size;
+	VkFormat format;
+	VkClearValue clearValue;
+	VkImageUsageFlags usage;
+	uint32_t firstUse;
+	uint32_t lastUse;
+	uint32_t aliasOf;
+	uint32_t slot;
+	bool clear;
+	bool imported;
+	bool swapchain;
+	bool output;
+	bool needed;
+};
+
+struct FrameGraphUse
+{
+	uint32_t target;
+	ResourceUsage usage;
+};
+
+struct FrameGraphPass
+{
+	const char* name;
+	void (*execute)(void* userData);
+	void* userData;
+	struct FrameGraphUse* uses;
+	RenderPass renderPass;
+	Framebuffer framebuffer;
+	uint32_t numUses;
+	uint32_t numColor;
+	uint32_t numDepth;
+	bool swapchain;
+	bool enabled;
+	bool live;
+	bool sorted;
+};
+
+struct FrameGraphSlot
+{
+	struct MemoryAllocation memory;
+	VkMemoryRequirements memReq;
+	uint32_t lastUse;
+	uint32_t firstTarget;
+	uint32_t lastTarget;
+};
+
+struct FrameGraphT
+{
+	struct FrameGraphTarget* targets;
+	struct FrameGraphPass* passes;
+	struct FrameGraphSlot* slots;
+	uint32_t* order;
+	uint32_t numTargets;
+	uint32_t numPasses;
+	uint32_t numOrdered;
+	uint32_t numSlots;
+	VkExtent3D swapchainSize;
+	struct FrameGraphStats stats;
+	bool dirty;
+};
+
+static bool isDepthFormat(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool isFrameGraphWrite(ResourceUsage usage)
+{
+	return (kResourceUsages[usage].access & kWriteAccess) != 0;
+}
+
+static bool isFrameGraphAttachment(ResourceUsage usage)
+{
+	return usage == eResourceUsage_ColorTarget || usage == eResourceUsage_DepthStencilTarget;
+}
+
+static VkExtent3D getSwapchainSize(void)
+{
+	const VkExtent3D retval = { (SwapchainImages) ? SwapchainImages->size.width : 0, (SwapchainImages) ? SwapchainImages->size.height : 0, 1 };
+	return retval;
+}
+
+static Image getFrameGraphTargetImage(const struct FrameGraphTarget* target)
+{
+	return (target->swapchain) ? SwapchainCurrentImage : target->image;
+}
+
+static uint32_t addTarget(FrameGraph graph, const struct FrameGraphTarget* target)
+{
+	safeRealloc(graph->targets, (graph->numTargets + 1) * sizeof(struct FrameGraphTarget));
+	graph->targets[graph->numTargets] = *target;
+	graph->dirty = true;
+	return graph->numTargets++;
+}
+
+FrameGraph createFrameGraph(void)
+{
+	FrameGraph retval = calloc(1, sizeof(struct FrameGraphT));
+	retvalIfNot(retval, NULL);
+	retval->dirty = true;
+	return retval;
+}
+
+uint32_t addFrameGraphTarget(FrameGraph graph, VkFormat format, const VkExtent3D* size)
+{
+	const struct FrameGraphTarget target = {
+		.size = (size) ? *size : (VkExtent3D) { 0, 0, 1 },
+		.format = format
+	};
+	return addTarget(graph, &target);
+}
+
+uint32_t importFrameGraphImage(FrameGraph graph, Image image)
+{
+	retvalIfNot(image, FRAME_GRAPH_NONE);
+	const struct FrameGraphTarget target = {
+		.image = image,
+		.size = image->size,
+		.format = image->format,
+		.imported = true
+	};
+	return addTarget(graph, &target);
+}
+
+uint32_t importFrameGraphSwapchain(FrameGraph graph)
+{
+	const struct FrameGraphTarget target = {
+		.format = SwapchainColorTarget,
+		.imported = true,
+		.swapchain = true
+	};
+	return addTarget(graph, &target);
+}
+
+void setFrameGraphClearColor(FrameGraph graph, uint32_t target, const float value[4])
+{
+	returnIfNot(target < graph->numTargets && !graph->targets[target].swapchain);
+	memcpy(graph->targets[target].clearValue.color.float32, value, 4 * sizeof(float));
+	graph->targets[target].clear = true;
+	graph->dirty = true;
+}
+
+void setFrameGraphClearDepth(FrameGraph graph, uint32_t target, float value)
+{
+	returnIfNot(target < graph->numTargets && !graph->targets[target].swapchain);
+	graph->targets[target].clearValue.depthStencil.depth = value;
+	graph->targets[target].clear = true;
+	graph->dirty = true;
+}
+
+void setFrameGraphOutput(FrameGraph graph, uint32_t target)
+{
+	returnIfNot(target < graph->numTargets);
+	graph->targets[target].output = true;
+	graph->dirty = true;
+}
+
+uint32_t addFrameGraphPass(FrameGraph graph, const char* name, void (*execute)(void* userData), void* userData)
+{
+	safeRealloc(graph->passes, (graph->numPasses + 1) * sizeof(struct FrameGraphPass));
+	safeRealloc(graph->order, (graph->numPasses + 1) * sizeof(uint32_t));
+	struct FrameGraphPass* pass = &graph->passes[graph->numPasses];
+	memset(pass, 0, sizeof(struct FrameGraphPass));
+	pass->name = name;
+	pass->execute = execute;
+	pass->userData = userData;
+	pass->enabled = true;
+	graph->dirty = true;
+	return graph->numPasses++;
+}
+
+void useFrameGraphTarget(FrameGraph graph, uint32_t pass, uint32_t target, ResourceUsage usage)
+{
+	returnIfNot(pass < graph->numPasses && target < graph->numTargets);
+	struct FrameGraphPass* p = &graph->passes[pass];
+	const struct FrameGraphTarget* t = &graph->targets[target];
+	returnIfNot(usage != eResourceUsage_ColorTarget || !isDepthFormat(t->format));
+	returnIfNot(usage != eResourceUsage_DepthStencilTarget || (isDepthFormat(t->format) && !p->numDepth));
+	// the swapchain pass brings its own render pass, depth buffer included
+	returnIfNot(!t->swapchain || usage == eResourceUsage_ColorTarget);
+	returnIfNot(!(p->swapchain || t->swapchain) || !isFrameGraphAttachment(usage) || !(p->numColor + p->numDepth));
+	returnIfNot(!isFrameGraphAttachment(usage) || p->numColor + p->numDepth < FRAME_GRAPH_ATTACHMENTS);
+
+	safeRealloc(p->uses, (p->numUses + 1) * sizeof(struct FrameGraphUse));
+	p->uses[p->numUses].target = target;
+	p->uses[p->numUses].usage = usage;
+	p->numUses++;
+	p->numColor += (usage == eResourceUsage_ColorTarget);
+	p->numDepth += (usage == eResourceUsage_DepthStencilTarget);
+	p->swapchain |= t->swapchain;
+	graph->dirty = true;
+}
+
+void enableFrameGraphPass(FrameGraph graph, uint32_t pass, bool enable)
+{
+	returnIfNot(pass < graph->numPasses);
+	graph->dirty |= (graph->passes[pass].enabled != enable);
+	graph->passes[pass].enabled = enable;
+}
+
+static bool usesTarget(const struct FrameGraphPass* pass, uint32_t target, bool write)
+{
+	for (uint32_t i = 0; i < pass->numUses; i++)
+	{
+		if (pass->uses[i].target == target && isFrameGraphWrite(pass->uses[i].usage) == write)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// readers go after every writer of what they read, writers of the same target keep their declaration order
+static bool dependsOn(FrameGraph graph, uint32_t pass, uint32_t other)
+{
+	const struct FrameGraphPass* p = &graph->passes[pass];
+	const struct FrameGraphPass* o = &graph->passes[other];
+	for (uint32_t i = 0; i < p->numUses; i++)
+	{
+		const uint32_t target = p->uses[i].target;
+		const bool write = isFrameGraphWrite(p->uses[i].usage);
+		if (usesTarget(o, target, true) && (!write || other < pass) && !usesTarget(p, target, !write))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static void sortFrameGraph(FrameGraph graph)
+{
+	for (uint32_t i = 0; i < graph->numPasses; i++)
+	{
+		graph->passes[i].sorted = false;
+	}
+
+	// the earliest declared pass whose dependencies are placed goes next
+	for (uint32_t n = 0; n < graph->numPasses; n++)
+	{
+		uint32_t next = FRAME_GRAPH_NONE;
+		for (uint32_t i = 0; i < graph->numPasses && next == FRAME_GRAPH_NONE; i++)
+		{
+			bool ready = !graph->passes[i].sorted;
+			for (uint32_t j = 0; j < graph->numPasses && ready; j++)
+			{
+				ready = (j == i) || graph->passes[j].sorted || !dependsOn(graph, i, j);
+			}
+			next = (ready) ? i : next;
+		}
+		if (next == FRAME_GRAPH_NONE)
+		{
+			// a cycle, what's left runs in declaration order
+			debugPrint("frame graph has a dependency cycle\n");
+			next = 0;
+			while (graph->passes[next].sorted)
+			{
+				next++;
+			}
+		}
+		graph->passes[next].sorted = true;
+		graph->order[n] = next;
+	}
+}
+
+// walks back from the outputs, passes whose writes nobody needs are dropped
+static void cullFrameGraph(FrameGraph graph)
+{
+	for (uint32_t i = 0; i < graph->numTargets; i++)
+	{
+		graph->targets[i].needed = graph->targets[i].imported || graph->targets[i].output;
+	}
+
+	uint32_t numLive = 0;
+	for (uint32_t n = graph->numPasses; n-- > 0;)
+	{
+		struct FrameGraphPass* pass = &graph->passes[graph->order[n]];
+		pass->live = false;
+		for (uint32_t i = 0; i < pass->numUses && pass->enabled; i++)
+		{
+			pass->live |= isFrameGraphWrite(pass->uses[i].usage) && graph->targets[pass->uses[i].target].needed;
+		}
+		for (uint32_t i = 0; i < pass->numUses && pass->live; i++)
+		{
+			graph->targets[pass->uses[i].target].needed = true;
+		}
+		numLive += pass->live;
+	}
+
+	graph->numOrdered = 0;
+	for (uint32_t n = 0; n < graph->numPasses; n++)
+	{
+		if (graph->passes[graph->order[n]].live)
+		{
+			graph->order[graph->numOrdered++] = graph->order[n];
+		}
+	}
+	graph->stats.numPasses = graph->numPasses;
+	graph->stats.numCulledPasses = graph->numPasses - numLive;
+}
+
+static VkImageUsageFlags getFrameGraphImageUsage(ResourceUsage usage)
+{
+	switch (usage)
+	{
+	case eResourceUsage_TransferSrc:
+		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	case eResourceUsage_TransferDst:
+		return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	case eResourceUsage_VertexShaderRead:
+	case eResourceUsage_FragmentShaderRead:
+	case eResourceUsage_ComputeShaderRead:
+		return VK_IMAGE_USAGE_SAMPLED_BIT;
+	case eResourceUsage_ComputeShaderWrite:
+		return VK_IMAGE_USAGE_STORAGE_BIT;
+	case eResourceUsage_ColorTarget:
+		return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case eResourceUsage_DepthStencilTarget:
+		return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	default:
+		return 0;
+	}
+}
+
+static void measureLifetimes(FrameGraph graph)
+{
+	for (uint32_t i = 0; i < graph->numTargets; i++)
+	{
+		graph->targets[i].firstUse = FRAME_GRAPH_NONE;
+		graph->targets[i].lastUse = 0;
+		graph->targets[i].aliasOf = FRAME_GRAPH_NONE;
+		graph->targets[i].slot = FRAME_GRAPH_NONE;
+		graph->targets[i].usage = 0;
+	}
+	for (uint32_t n = 0; n < graph->numOrdered; n++)
+	{
+		const struct FrameGraphPass* pass = &graph->passes[graph->order[n]];
+		for (uint32_t i = 0; i < pass->numUses; i++)
+		{
+			struct FrameGraphTarget* target = &graph->targets[pass->uses[i].target];
+			target->firstUse = (target->firstUse == FRAME_GRAPH_NONE) ? n : target->firstUse;
+			target->lastUse = n;
+			target->usage |= getFrameGraphImageUsage(pass->uses[i].usage);
+		}
+	}
+}
+
+// transients whose lifetimes don't overlap share memory, each takes the free slot closest to its size
+static void allocateTransients(FrameGraph graph)
+{
+	const VkExtent3D swapchainSize = getSwapchainSize();
+	VkMemoryRequirements* memReqs = calloc(graph->numTargets, sizeof(VkMemoryRequirements));
+	graph->slots = calloc(graph->numTargets, sizeof(struct FrameGraphSlot));
+	if (!memReqs || !graph->slots)
+	{
+		breakIfNot(0);
+		freeMem(memReqs);
+		freeMem(graph->slots);
+		return;
+	}
+	graph->numSlots = 0;
+	graph->swapchainSize = swapchainSize;
+	graph->stats.numTransients = 0;
+	graph->stats.unaliasedBytes = 0;
+	graph->stats.transientBytes = 0;
+
+	for (uint32_t n = 0; n < graph->numOrdered; n++)
+	{
+		for (uint32_t i = 0; i < graph->numTargets; i++)
+		{
+			struct FrameGraphTarget* target = &graph->targets[i];
+			if (target->imported || target->firstUse != n)
+			{
+				continue;
+			}
+
+			const VkExtent3D size = (target->size.width) ? target->size : swapchainSize;
+			target->image = createTransientImage(target->format, &size, target->usage);
+			if (!target->image)
+			{
+				continue;
+			}
+
+			VkMemoryDedicatedRequirements dedicatedReq = { .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+			VkMemoryRequirements2 memReq = { .sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2, .pNext = &dedicatedReq };
+			const VkImageMemoryRequirementsInfo2 imri = { .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2, .image = target->image->handle };
+			vkGetImageMemoryRequirements2(Device, &imri, &memReq);
+			memReqs[i] = memReq.memoryRequirements;
+			graph->stats.numTransients++;
+			graph->stats.unaliasedBytes += memReqs[i].size;
+			if (dedicatedReq.requiresDedicatedAllocation)
+			{
+				bindTransientImage(target->image, NULL);
+				graph->stats.transientBytes += memReqs[i].size;
+				continue;
+			}
+
+			struct FrameGraphSlot* slot = NULL;
+			VkDeviceSize bestFit = 0;
+			for (uint32_t j = 0; j < graph->numSlots; j++)
+			{
+				struct FrameGraphSlot* candidate = &graph->slots[j];
+				const VkDeviceSize fit = (candidate->memReq.size > memReqs[i].size) ? candidate->memReq.size - memReqs[i].size : memReqs[i].size - candidate->memReq.size;
+				if (candidate->lastUse < n && (candidate->memReq.memoryTypeBits & memReqs[i].memoryTypeBits) && (!slot || fit < bestFit))
+				{
+					slot = candidate;
+					bestFit = fit;
+				}
+			}
+			if (slot)
+			{
+				slot->memReq.size = (slot->memReq.size > memReqs[i].size) ? slot->memReq.size : memReqs[i].size;
+				slot->memReq.alignment = (slot->memReq.alignment > memReqs[i].alignment) ? slot->memReq.alignment : memReqs[i].alignment;
+				slot->memReq.memoryTypeBits &= memReqs[i].memoryTypeBits;
+				target->aliasOf = slot->lastTarget;
+			}
+			else
+			{
+				slot = &graph->slots[graph->numSlots++];
+				slot->memReq = memReqs[i];
+				slot->firstTarget = i;
+			}
+			slot->lastTarget = i;
+			// outputs are read after the graph ran, nothing later may reuse their memory
+			slot->lastUse = (target->output) ? graph->numOrdered : target->lastUse;
+			target->slot = (uint32_t)(slot - graph->slots);
+		}
+	}
+
+	for (uint32_t j = 0; j < graph->numSlots; j++)
+	{
+		struct FrameGraphSlot* slot = &graph->slots[j];
+		const VkMemoryPropertyFlags memExcluded = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		allocateMemory(&slot->memory, &slot->memReq, NULL, false, false, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memExcluded, 0);
+		graph->stats.transientBytes += slot->memReq.size;
+
+		// the first one in a slot follows the last one from the frame before
+		if (slot->firstTarget != slot->lastTarget)
+		{
+			graph->targets[slot->firstTarget].aliasOf = slot->lastTarget;
+		}
+	}
+	for (uint32_t i = 0; i < graph->numTargets; i++)
+	{
+		if (graph->targets[i].slot != FRAME_GRAPH_NONE)
+		{
+			bindTransientImage(graph->targets[i].image, &graph->slots[graph->targets[i].slot].memory);
+		}
+	}
+	graph->stats.numMemorySlots = graph->numSlots;
+	freeMem(memReqs);
+}
+
+static VkAttachmentDescription getFrameGraphAttachment(FrameGraph graph, uint32_t n, const struct FrameGraphUse* use)
+{
+	const struct FrameGraphTarget* target = &graph->targets[use->target];
+	const bool first = (n == target->firstUse);
+	const bool hasStencil = (target->format == VK_FORMAT_D16_UNORM_S8_UINT || target->format == VK_FORMAT_D24_UNORM_S8_UINT || target->format == VK_FORMAT_D32_SFLOAT_S8_UINT);
+	const VkImageLayout layout = kResourceUsages[use->usage].layout;
+
+	// first writes clear or start from nothing, only contents something reads later get stored
+	VkAttachmentDescription retval = {
+		.format = target->format,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.loadOp = (!first || (target->imported && !target->clear)) ? VK_ATTACHMENT_LOAD_OP_LOAD : (target->clear) ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		.storeOp = (target->imported || target->output || n < target->lastUse) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		.finalLayout = layout
+	};
+	retval.initialLayout = (retval.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD) ? layout : VK_IMAGE_LAYOUT_UNDEFINED;
+	if (hasStencil)
+	{
+		retval.stencilLoadOp = retval.loadOp;
+		retval.stencilStoreOp = retval.storeOp;
+	}
+	return retval;
+}
+
+// render passes outlive rebuilds so pipelines made from them stay valid, only a changed op recreates the handle
+static void setupFrameGraphPass(FrameGraph graph, uint32_t n)
+{
+	struct FrameGraphPass* pass = &graph->passes[graph->order[n]];
+	Image images[FRAME_GRAPH_ATTACHMENTS];
+	uint32_t color = 0, depth = pass->numColor;
+
+	bool changed = false;
+	for (uint32_t i = 0; i < pass->numUses; i++)
+	{
+		const struct FrameGraphUse* use = &pass->uses[i];
+		if (!isFrameGraphAttachment(use->usage))
+		{
+			continue;
+		}
+
+		const uint32_t index = (use->usage == eResourceUsage_ColorTarget) ? color++ : depth++;
+		const struct FrameGraphTarget* target = &graph->targets[use->target];
+		const VkAttachmentDescription attachment = getFrameGraphAttachment(graph, n, use);
+		images[index] = target->image;
+		if (memcmp(&pass->renderPass->attachment[index], &attachment, sizeof(VkAttachmentDescription)) != 0)
+		{
+			VkAttachmentDescription* ad = (index < pass->numColor) ? getRenderPassColorTarget(pass->renderPass, index) : getRenderPassDepthStencilTarget(pass->renderPass);
+			*ad = attachment;
+			changed = true;
+		}
+		if (attachment.loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR && index < pass->numColor)
+		{
+			setRenderPassClearColor(pass->renderPass, index, target->clearValue.color.float32);
+		}
+		else if (attachment.loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR)
+		{
+			setRenderPassClearDepth(pass->renderPass, target->clearValue.depthStencil.depth);
+		}
+	}
+	if (changed)
+	{
+		resetRenderPassHandle(pass->renderPass);
+	}
+	pass->framebuffer = createFramebuffer(pass->renderPass, images);
+}
+
+static void createFrameGraphRenderPasses(FrameGraph graph)
+{
+	for (uint32_t i = 0; i < graph->numPasses; i++)
+	{
+		struct FrameGraphPass* pass = &graph->passes[i];
+		if (pass->swapchain || !(pass->numColor + pass->numDepth))
+		{
+			continue;
+		}
+		if (pass->renderPass && (pass->renderPass->numColor != pass->numColor || pass->renderPass->numDepth != pass->numDepth))
+		{
+			destroyRenderPass(pass->renderPass);
+			pass->renderPass = NULL;
+		}
+		if (!pass->renderPass)
+		{
+			pass->renderPass = createRenderPass(pass->numColor, pass->numDepth);
+		}
+	}
+}
+
+static void releaseFrameGraph(FrameGraph graph)
+{
+	if (graph->stats.numBuilds)
+	{
+		deviceWaitIdle();
+	}
+	for (uint32_t i = 0; i < graph->numPasses; i++)
+	{
+		destroyFramebuffer(graph->passes[i].framebuffer);
+		graph->passes[i].framebuffer = NULL;
+	}
+	for (uint32_t i = 0; i < graph->numTargets; i++)
+	{
+		if (!graph->targets[i].imported)
+		{
+			destroyImage(graph->targets[i].image);
+			graph->targets[i].image = NULL;
+		}
+	}
+	for (uint32_t i = 0; i < graph->numSlots; i++)
+	{
+		freeDeviceMemory(&graph->slots[i].memory);
+	}
+	freeMem(graph->slots);
+	graph->numSlots = 0;
+}
+
+// waits for the device, a rebuild is for when the graph or the swapchain changed shape, not for every frame
+static void buildFrameGraph(FrameGraph graph)
+{
+	releaseFrameGraph(graph);
+	sortFrameGraph(graph);
+	cullFrameGraph(graph);
+	measureLifetimes(graph);
+	allocateTransients(graph);
+	createFrameGraphRenderPasses(graph);
+	for (uint32_t n = 0; n < graph->numOrdered; n++)
+	{
+		const struct FrameGraphPass* pass = &graph->passes[graph->order[n]];
+		if (pass->renderPass)
+		{
+			setupFrameGraphPass(graph, n);
+		}
+	}
+	graph->stats.numBuilds++;
+	graph->dirty = false;
+}
+
+static bool isFrameGraphStale(FrameGraph graph)
+{
+	const VkExtent3D swapchainSize = getSwapchainSize();
+	return graph->dirty || swapchainSize.width != graph->swapchainSize.width || swapchainSize.height != graph->swapchainSize.height;
+}
+
+RenderPass getFrameGraphRenderPass(FrameGraph graph, uint32_t pass)
+{
+	retvalIfNot(pass < graph->numPasses, NULL);
+	if (isFrameGraphStale(graph))
+	{
+		buildFrameGraph(graph);
+	}
+	return (graph->passes[pass].swapchain) ? SwapchainRenderPass : graph->passes[pass].renderPass;
+}
+
+Image getFrameGraphImage(FrameGraph graph, uint32_t target)
+{
+	retvalIfNot(target < graph->numTargets, NULL);
+	return getFrameGraphTargetImage(&graph->targets[target]);
+}
+
+// aliased memory still holds the previous occupant's work, the first use has to wait for all of it
+static void inheritAliasedState(Image image, const Image previous)
+{
+	struct ResourceState* state = &image->state[0];
+	memset(state, 0, sizeof(struct ResourceState));
+	state->writeStages = previous->state[0].writeStages | previous->state[0].readStages;
+	state->writeAccess = previous->state[0].writeAccess;
+	state->layout = VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+void executeFrameGraph(FrameGraph graph)
+{
+	if (isFrameGraphStale(graph))
+	{
+		buildFrameGraph(graph);
+	}
+
+	for (uint32_t n = 0; n < graph->numOrdered; n++)
+	{
+		const struct FrameGraphPass* pass = &graph->passes[graph->order[n]];
+		if (pass->name)
+		{
+			beginGpuScope(pass->name);
+		}
+		for (uint32_t i = 0; i < pass->numUses; i++)
+		{
+			const struct FrameGraphTarget* target = &graph->targets[pass->uses[i].target];
+			if (target->firstUse == n && target->aliasOf != FRAME_GRAPH_NONE)
+			{
+				inheritAliasedState(target->image, graph->targets[target->aliasOf].image);
+			}
+		}
+		for (uint32_t i = 0; i < pass->numUses; i++)
+		{
+			Image image = getFrameGraphTargetImage(&graph->targets[pass->uses[i].target]);
+			if (!isFrameGraphAttachment(pass->uses[i].usage))
+			{
+				useImage(image, pass->uses[i].usage, makeImageSubset(0, image->mips, 0, 1));
+			}
+		}
+
+		if (pass->swapchain)
+		{
+			beginRenderPass(SwapchainRenderPass, getSwapchainFramebuffer());
+		}
+		else if (pass->framebuffer)
+		{
+			beginRenderPass(pass->renderPass, pass->framebuffer);
+		}
+		if (pass->execute)
+		{
+			pass->execute(pass->userData);
+		}
+		if (pass->swapchain || pass->framebuffer)
+		{
+			endRenderPass();
+		}
+		if (pass->name)
+		{
+			endGpuScope();
+		}
+	}
+}
+
+void getFrameGraphStats(FrameGraph graph, struct FrameGraphStats* stats)
+{
+	*stats = graph->stats;
+}
+
+void destroyFrameGraph(FrameGraph graph)
+{
+	if (graph)
+	{
+		releaseFrameGraph(graph);
+		for (uint32_t i = 0; i < graph->numPasses; i++)
+		{
+			destroyRenderPass(graph->passes[i].renderPass);
+			freeMem(graph->passes[i].uses);
+		}
+		freeMem(graph->passes);
+		freeMem(graph->targets);
+		freeMem(graph->order);
+		freeMem(graph);
+	}
+}
@@ -3,35 +3,29 @@
 struct ImageT
 {
 	VkImage handle;
-	VkDeviceMemory memory;
+	struct MemoryAllocation memory;
 	VkImageView view;
 	VkFormat format;
 	VkExtent3D size;
 	uint32_t mips;
 	VkImageAspectFlags aspect;
-	//device queue owner
+	DeviceQueue owner;
+	struct ResourceState state[MAX_IMAGE_MIPS];
 };
 
 static void initImage(Image image, VkFormat format, const VkExtent3D* size, uint32_t numMips, bool isCube, bool alloc)
 {
 	breakIfNot(image->handle);
+	breakIfNot(numMips <= MAX_IMAGE_MIPS);
 	if (alloc)
 	{
-		VkMemoryRequirements memReq;
-		vkGetImageMemoryRequirements(Device, image->handle, &memReq);
 		VkMemoryPropertyFlags memReqired = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 		VkMemoryPropertyFlags memExcluded = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-		VkMemoryAllocateInfo mai = {
-			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-			.allocationSize = memReq.size,
-			.memoryTypeIndex = findMemoryType(&memReq, memReqired, memExcluded, 0)
-		};
-		breakIfFailed(vkAllocateMemory(Device, &mai, Alloc, &image->memory));
-		vkBindImageMemory(Device, image->handle, image->memory, 0);
+		allocateDeviceMemory(&image->memory, VK_NULL_HANDLE, image->handle, memReqired, memExcluded, 0);
 	}
 	else
 	{
-		image->memory = VK_NULL_HANDLE;
+		memset(&image->memory, 0, sizeof(struct MemoryAllocation));
 	}
 
 	VkImageAspectFlags aspect = 0;
@@ -69,9 +63,11 @@ static void initImage(Image image, VkFormat format, const VkExtent3D* size, uint
 	breakIfFailed(vkCreateImageView(Device, &ivci, Alloc, &image->view));
 
 	image->aspect = aspect;
+	image->owner = eDeviceQueue_Invalid;
 	image->format = format;
 	image->mips = numMips;
 	image->size = *size;
+	memset(image->state, 0, sizeof(image->state));
 }
 
 Image createRenderTargetImage(VkFormat format, const VkExtent3D* size)
@@ -115,6 +111,7 @@ Image createRenderTargetImage(VkFormat format, const VkExtent3D* size)
 
 	retval->handle = handle;
 	initImage(retval, format, size, 1, false, true);
+	traceCreate(eTraceOp_CreateRenderTargetImage, traceKey(retval), format, size->width, size->height, size->depth);
 	return retval;
 }
 
@@ -144,17 +141,94 @@ Image createSampledImage(VkFormat format, const VkExtent3D* size, uint32_t numMi
 	}
 
 	retval->handle = handle;
-	initImage(retval, format, size, 1, false, true);
+	initImage(retval, format, size, numMips, false, true);
+	traceCreate(eTraceOp_CreateSampledImage, traceKey(retval), format, size->width, size->height, size->depth, numMips);
+	return retval;
+}
+
+Image createStorageImage(VkFormat format, const VkExtent3D* size, uint32_t numMips)
+{
+	VkImageCreateInfo ici = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = (size->depth > 1) ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D,
+		.format = format,
+		.extent = *size,
+		.mipLevels = numMips,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+	};
+
+	VkImage handle = VK_NULL_HANDLE;
+	breakIfFailed(vkCreateImage(Device, &ici, Alloc, &handle));
+
+	Image retval = calloc(1, sizeof(struct ImageT));
+	breakIfNot(retval);
+	if (!retval)
+	{
+		vkDestroyImage(Device, handle, Alloc);
+		return NULL;
+	}
+
+	retval->handle = handle;
+	initImage(retval, format, size, numMips, false, true);
+	traceCreate(eTraceOp_CreateStorageImage, traceKey(retval), format, size->width, size->height, size->depth, numMips);
+	return retval;
+}
+
+// transient attachments, the frame graph places several of them in the same memory before bindTransientImage
+static Image createTransientImage(VkFormat format, const VkExtent3D* size, VkImageUsageFlags usage)
+{
+	VkImageCreateInfo ici = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = format,
+		.extent = *size,
+		.mipLevels = 1,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = usage
+	};
+
+	VkImage handle = VK_NULL_HANDLE;
+	breakIfFailed(vkCreateImage(Device, &ici, Alloc, &handle));
+
+	Image retval = calloc(1, sizeof(struct ImageT));
+	breakIfNot(retval);
+	if (!retval)
+	{
+		vkDestroyImage(Device, handle, Alloc);
+		return NULL;
+	}
+
+	retval->handle = handle;
+	retval->format = format;
+	retval->size = *size;
+	traceCreate(eTraceOp_CreateTransientImage, traceKey(retval), format, size->width, size->height, size->depth, usage);
 	return retval;
 }
 
+// the image doesn't own aliased memory, without any it gets its own
+static void bindTransientImage(Image image, const struct MemoryAllocation* memory)
+{
+	if (memory)
+	{
+		breakIfFailed(vkBindImageMemory(Device, image->handle, memory->memory, memory->offset));
+	}
+	initImage(image, image->format, &image->size, 1, false, !memory);
+}
+
 void destroyImage(Image image)
 {
 	if (image)
 	{
+		traceDestroy(eTraceOp_DestroyImage, traceKey(image));
 		vkDestroyImageView(Device, image->view, Alloc);
 		vkDestroyImage(Device, image->handle, Alloc);
-		vkFreeMemory(Device, image->memory, Alloc);
+		freeDeviceMemory(&image->memory);
 		freeMem(image);
+		SDL_AtomicIncRef(&ResourceGeneration);
 	}
 }
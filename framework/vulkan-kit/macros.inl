@@ -4,6 +4,18 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 #endif
 
+#ifdef _MSC_VER
+#define threadLocal __declspec(thread)
+#else
+#define threadLocal _Thread_local
+#endif
+
+#ifndef _MSC_VER
+#define _fileno fileno
+#define _countof(arr) (sizeof(arr) / sizeof((arr)[0]))
+#define __debugbreak __builtin_trap
+#endif
+
 #ifdef _DEBUG
 
 #define returnIfNot(expr) { if (!(expr)) { __debugbreak(); return; } }
@@ -46,6 +58,9 @@
 #define imageSubsetNumMips(subset) (((subset) >> 4) & 0x0000000Fu)
 #define imageSubsetFromMip(subset) ((subset) & 0x0000000Fu)
 
+// every mip a subset can address, enough for a 32k texture
+#define MAX_IMAGE_MIPS 16
+
 #if !defined(MAX_SAMPLER_STATES)
 #define MAX_SAMPLER_STATES 1
 #endif
@@ -58,6 +73,14 @@
 #define MAX_SAMPLED_IMAGES 1
 #endif
 
+#if !defined(MAX_STORAGE_BUFFERS)
+#define MAX_STORAGE_BUFFERS 1
+#endif
+
+#if !defined(MAX_STORAGE_IMAGES)
+#define MAX_STORAGE_IMAGES 1
+#endif
+
 #if !defined(MAX_PUSH_CONST_BYTES)
 #define MAX_PUSH_CONST_BYTES 0
 #endif
@@ -66,15 +89,126 @@
 #define MAX_RESOURCE_BARRIERS 8
 #endif
 
-#if !defined(MAX_DRAW_CALLS)
-#define MAX_DRAW_CALLS 1024
+#if !defined(MAX_VERTEX_BUFFERS)
+#define MAX_VERTEX_BUFFERS 4
+#endif
+
+#if MAX_VERTEX_BUFFERS > 32
+#error "MAX_VERTEX_BUFFERS must fit the 32 bit bound-vertex-buffer mask"
+#endif
+
+#if !defined(MAX_RECORDING_CONTEXTS)
+#define MAX_RECORDING_CONTEXTS 32
+#endif
+
+#if !defined(WITH_NULL_BACKEND)
+#define WITH_NULL_BACKEND 0
+#endif
+
+#if !defined(WITH_PROFILER)
+#define WITH_PROFILER 0
+#endif
+
+#if WITH_PROFILER
+#define profileBegin(name) beginProfileZone(name)
+#define profileEnd() endProfileZone()
+#else
+#define profileBegin(name)
+#define profileEnd()
+#endif
+
+#if !defined(WITH_TRACE)
+#define WITH_TRACE 0
+#endif
+
+#if WITH_TRACE
+#define traceKey(object) ((uint64_t)(uintptr_t)(object))
+#define traceObject(object) getTraceObject(traceKey(object))
+#define traceCall(...) traceData(NULL, 0, __VA_ARGS__)
+#define traceData(data, bytes, ...) do { if (TraceFile) { \
+	const uint64_t traceArgs[] = { __VA_ARGS__ }; \
+	writeTraceRecord((enum TraceOp)traceArgs[0], 0, traceArgs + 1, _countof(traceArgs) - 1, data, bytes); \
+} } while (0)
+#define traceCreate(op, key, ...) do { if (TraceFile && (key)) { \
+	const uint64_t traceArgs[] = { 0, __VA_ARGS__ }; \
+	writeTraceRecord(op, key, traceArgs + 1, _countof(traceArgs) - 1, NULL, 0); \
+} } while (0)
+#define traceMapped(op, data, bytes, ...) do { if (TraceFile) { \
+	const uint64_t traceArgs[] = { 0, __VA_ARGS__ }; \
+	setTracePending(op, traceArgs + 1, _countof(traceArgs) - 1, data, bytes); \
+} } while (0)
+#define traceDestroy(op, key) do { if (TraceFile) writeTraceDestroy(op, key); } while (0)
+#define traceMappedBuffer(key, data, bytes) do { if (TraceFile) addTraceMappedBuffer(key, data, bytes); } while (0)
+#define traceFramebuffer(key, renderPass, images, numImages) do { if (TraceFile && (key)) \
+	writeTraceFramebuffer(key, renderPass, images, numImages); } while (0)
+#define tracePipeline(op, key, shaderFile, stageFlags, renderPass) do { if (TraceFile && (key)) \
+	writeTracePipeline(op, key, shaderFile, stageFlags, renderPass); } while (0)
+#define traceSuspend() (TraceSuspended++)
+#define traceResume() (TraceSuspended--)
+#else
+#define traceCall(...)
+#define traceData(...)
+#define traceCreate(...)
+#define traceMapped(...)
+#define traceDestroy(...)
+#define traceMappedBuffer(...)
+#define traceFramebuffer(...)
+#define tracePipeline(...)
+#define traceSuspend()
+#define traceResume()
+#endif
+
+#if !defined(TRACE_MAX_ARGS)
+#define TRACE_MAX_ARGS 8
+#endif
+
+#if !defined(PROFILER_ZONES_PER_THREAD)
+#define PROFILER_ZONES_PER_THREAD 16384
+#endif
+
+#if !defined(PROFILER_MAX_DEPTH)
+#define PROFILER_MAX_DEPTH 32
+#endif
+
+#if !defined(MAX_TIMESTAMP_SCOPES)
+#define MAX_TIMESTAMP_SCOPES 64
+#endif
+
+#if !defined(DESCRIPTOR_POOL_SETS)
+#define DESCRIPTOR_POOL_SETS 1024
+#endif
+
+#if !defined(MEMORY_BLOCK_SIZE)
+#define MEMORY_BLOCK_SIZE (64u << 20)
+#endif
+
+#if !defined(MEMORY_MIN_ALLOCATION)
+#define MEMORY_MIN_ALLOCATION 256u
+#endif
+
+#if !defined(TRANSIENT_MEMORY_BYTES)
+#define TRANSIENT_MEMORY_BYTES (4u << 20)
+#endif
+
+#if !defined(STAGING_MEMORY_BYTES)
+#define STAGING_MEMORY_BYTES (16u << 20)
+#endif
+
+#if !defined(MAX_PENDING_COPIES)
+#define MAX_PENDING_COPIES 64
 #endif
 
 #define SS_BINDING_OFFSET (0)
 #define UB_BINDING_OFFSET (SS_BINDING_OFFSET) + (MAX_SAMPLER_STATES)
 #define SI_BINDING_OFFSET (UB_BINDING_OFFSET) + (MAX_UNIFORM_BUFFERS)
+#define SB_BINDING_OFFSET (SI_BINDING_OFFSET) + (MAX_SAMPLED_IMAGES)
+#define ST_BINDING_OFFSET (SB_BINDING_OFFSET) + (MAX_STORAGE_BUFFERS)
+
+#define MAX_SHADER_BINDINGS ((MAX_SAMPLER_STATES) + (MAX_UNIFORM_BUFFERS) + (MAX_SAMPLED_IMAGES) + (MAX_STORAGE_BUFFERS) + (MAX_STORAGE_IMAGES))
 
-#define MAX_SHADER_BINDINGS ((MAX_SAMPLER_STATES) + (MAX_UNIFORM_BUFFERS) + (MAX_SAMPLED_IMAGES))
+#if MAX_SHADER_BINDINGS > 64
+#error "MAX_SHADER_BINDINGS must fit the 64 bit bound-descriptor mask"
+#endif
 
 #ifndef MAX_INSTANCE_EXTENSIONS
 #define MAX_INSTANCE_EXTENSIONS 8
@@ -0,0 +1,291 @@
+#pragma once
+
+// buddy allocator: every block is a power of two multiple of MEMORY_MIN_ALLOCATION,
+// longest[] is a complete binary tree holding (largest free order + 1) per subtree
+struct MemoryBlock
+{
+	VkDeviceMemory memory;
+	uint8_t* mapped;
+	uint8_t* longest;
+	uint32_t levels;
+};
+
+struct MemoryPool
+{
+	struct MemoryBlock** blocks;
+	uint32_t numBlocks;
+};
+
+struct MemoryAllocation
+{
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	uint8_t* mapped;
+	struct MemoryBlock* block;
+	uint32_t typeIndex;
+	uint32_t order;
+	bool linear;
+};
+
+static VkPhysicalDeviceMemoryProperties MemoryProperties;
+static struct MemoryPool MemoryPools[VK_MAX_MEMORY_TYPES][2];
+static struct MemoryStats MemoryStatistics;
+
+static uint32_t getMemoryBlockLevels(uint32_t typeIndex)
+{
+	const VkDeviceSize heapSize = MemoryProperties.memoryHeaps[MemoryProperties.memoryTypes[typeIndex].heapIndex].size;
+	uint32_t levels = 0;
+	while (((VkDeviceSize)MEMORY_MIN_ALLOCATION << (levels + 1)) <= MEMORY_BLOCK_SIZE
+		&& ((VkDeviceSize)MEMORY_MIN_ALLOCATION << (levels + 4)) <= heapSize)
+	{
+		++levels;
+	}
+	return levels;
+}
+
+static struct MemoryBlock* createMemoryBlock(uint32_t typeIndex, uint32_t levels)
+{
+	const size_t numNodes = ((size_t)2 << levels) - 1;
+	struct MemoryBlock* block = calloc(1, sizeof(struct MemoryBlock) + numNodes);
+	breakIfNot(block);
+	block->longest = (uint8_t*)(block + 1);
+	block->levels = levels;
+	for (uint32_t depth = 0, node = 0; depth <= levels; depth++)
+	{
+		for (uint32_t i = 0; i < (1u << depth); i++)
+		{
+			block->longest[node++] = (uint8_t)(levels - depth + 1);
+		}
+	}
+
+	VkMemoryAllocateInfo mai = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize = (VkDeviceSize)MEMORY_MIN_ALLOCATION << levels,
+		.memoryTypeIndex = typeIndex
+	};
+	breakIfFailed(vkAllocateMemory(Device, &mai, Alloc, &block->memory));
+	if (MemoryProperties.memoryTypes[typeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		breakIfFailed(vkMapMemory(Device, block->memory, 0, VK_WHOLE_SIZE, 0, (void**)&block->mapped));
+	}
+
+	MemoryStatistics.blockBytes += mai.allocationSize;
+	MemoryStatistics.numBlocks++;
+	return block;
+}
+
+static void destroyMemoryBlock(struct MemoryBlock* block)
+{
+	MemoryStatistics.blockBytes -= (VkDeviceSize)MEMORY_MIN_ALLOCATION << block->levels;
+	MemoryStatistics.numBlocks--;
+	vkFreeMemory(Device, block->memory, Alloc);
+	freeMem(block);
+}
+
+static void updateMemoryBlock(struct MemoryBlock* block, uint32_t node, uint32_t order)
+{
+	while (node)
+	{
+		node = (node - 1) / 2;
+		++order;
+		const uint8_t left = block->longest[2 * node + 1];
+		const uint8_t right = block->longest[2 * node + 2];
+		block->longest[node] = (left == order && right == order) ? (uint8_t)(order + 1) : ((left > right) ? left : right);
+	}
+}
+
+static bool allocateFromBlock(struct MemoryBlock* block, uint32_t order, VkDeviceSize* offset)
+{
+	if (order > block->levels || block->longest[0] <= order)
+	{
+		return false;
+	}
+
+	uint32_t node = 0;
+	for (uint32_t nodeOrder = block->levels; nodeOrder > order; nodeOrder--)
+	{
+		const uint8_t left = block->longest[2 * node + 1];
+		const uint8_t right = block->longest[2 * node + 2];
+		node = (left > order && (right <= order || left <= right)) ? 2 * node + 1 : 2 * node + 2;
+	}
+	block->longest[node] = 0;
+	updateMemoryBlock(block, node, order);
+
+	const uint32_t firstNode = (1u << (block->levels - order)) - 1;
+	*offset = (VkDeviceSize)(node - firstNode) * ((VkDeviceSize)MEMORY_MIN_ALLOCATION << order);
+	return true;
+}
+
+static void freeFromBlock(struct MemoryBlock* block, VkDeviceSize offset, uint32_t order)
+{
+	const uint32_t firstNode = (1u << (block->levels - order)) - 1;
+	const uint32_t node = firstNode + (uint32_t)(offset / ((VkDeviceSize)MEMORY_MIN_ALLOCATION << order));
+	block->longest[node] = (uint8_t)(order + 1);
+	updateMemoryBlock(block, node, order);
+}
+
+// dedicatedInfo is chained when the allocation gets its own VkDeviceMemory, nothing gets bound here
+static void allocateMemory(struct MemoryAllocation* allocation, const VkMemoryRequirements* memReq, const VkMemoryDedicatedAllocateInfo* dedicatedInfo,
+	bool dedicated, bool linear, VkMemoryPropertyFlags required, VkMemoryPropertyFlags excluded, VkMemoryPropertyFlags maybe)
+{
+	memset(allocation, 0, sizeof(struct MemoryAllocation));
+	allocation->typeIndex = findMemoryType(memReq, required, excluded, maybe);
+	allocation->size = memReq->size;
+	allocation->linear = linear;
+
+	const uint32_t levels = getMemoryBlockLevels(allocation->typeIndex);
+	const VkDeviceSize bytes = (allocation->size > memReq->alignment) ? allocation->size : memReq->alignment;
+	if (dedicated || bytes > ((VkDeviceSize)MEMORY_MIN_ALLOCATION << levels) / 2)
+	{
+		VkMemoryAllocateInfo mai = {
+			.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+			.pNext = dedicatedInfo,
+			.allocationSize = allocation->size,
+			.memoryTypeIndex = allocation->typeIndex
+		};
+		breakIfFailed(vkAllocateMemory(Device, &mai, Alloc, &allocation->memory));
+		if (MemoryProperties.memoryTypes[allocation->typeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			breakIfFailed(vkMapMemory(Device, allocation->memory, 0, VK_WHOLE_SIZE, 0, (void**)&allocation->mapped));
+		}
+		MemoryStatistics.dedicatedBytes += allocation->size;
+		MemoryStatistics.numDedicated++;
+	}
+	else
+	{
+		uint32_t order = 0;
+		while (((VkDeviceSize)MEMORY_MIN_ALLOCATION << order) < bytes)
+		{
+			++order;
+		}
+
+		struct MemoryPool* pool = &MemoryPools[allocation->typeIndex][allocation->linear];
+		struct MemoryBlock* block = NULL;
+		for (uint32_t i = 0; i < pool->numBlocks && !block; i++)
+		{
+			if (allocateFromBlock(pool->blocks[i], order, &allocation->offset))
+			{
+				block = pool->blocks[i];
+			}
+		}
+		if (!block)
+		{
+			block = createMemoryBlock(allocation->typeIndex, levels);
+			safeRealloc(pool->blocks, (pool->numBlocks + 1) * sizeof(struct MemoryBlock*));
+			pool->blocks[pool->numBlocks++] = block;
+			allocateFromBlock(block, order, &allocation->offset);
+		}
+
+		allocation->block = block;
+		allocation->order = order;
+		allocation->memory = block->memory;
+		allocation->mapped = (block->mapped) ? block->mapped + allocation->offset : NULL;
+		MemoryStatistics.usedBytes += (VkDeviceSize)MEMORY_MIN_ALLOCATION << order;
+		MemoryStatistics.numAllocations++;
+	}
+}
+
+static void allocateDeviceMemory(struct MemoryAllocation* allocation, VkBuffer buffer, VkImage image, VkMemoryPropertyFlags required, VkMemoryPropertyFlags excluded, VkMemoryPropertyFlags maybe)
+{
+	VkMemoryDedicatedRequirements dedicatedReq = { .sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS };
+	VkMemoryRequirements2 memReq = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2,
+		.pNext = &dedicatedReq
+	};
+	if (buffer != VK_NULL_HANDLE)
+	{
+		VkBufferMemoryRequirementsInfo2 bmri = {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2,
+			.buffer = buffer
+		};
+		vkGetBufferMemoryRequirements2(Device, &bmri, &memReq);
+	}
+	else
+	{
+		VkImageMemoryRequirementsInfo2 imri = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2,
+			.image = image
+		};
+		vkGetImageMemoryRequirements2(Device, &imri, &memReq);
+	}
+
+	const VkMemoryDedicatedAllocateInfo mdai = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+		.image = image,
+		.buffer = buffer
+	};
+	const bool dedicated = dedicatedReq.requiresDedicatedAllocation || dedicatedReq.prefersDedicatedAllocation;
+	allocateMemory(allocation, &memReq.memoryRequirements, &mdai, dedicated, buffer != VK_NULL_HANDLE, required, excluded, maybe);
+
+	if (buffer != VK_NULL_HANDLE)
+	{
+		breakIfFailed(vkBindBufferMemory(Device, buffer, allocation->memory, allocation->offset));
+	}
+	else
+	{
+		breakIfFailed(vkBindImageMemory(Device, image, allocation->memory, allocation->offset));
+	}
+}
+
+static void freeDeviceMemory(struct MemoryAllocation* allocation)
+{
+	struct MemoryBlock* block = allocation->block;
+	if (block)
+	{
+		freeFromBlock(block, allocation->offset, allocation->order);
+		MemoryStatistics.usedBytes -= (VkDeviceSize)MEMORY_MIN_ALLOCATION << allocation->order;
+		MemoryStatistics.numAllocations--;
+
+		// keep the last block of a pool around to avoid thrashing on alloc/free cycles
+		struct MemoryPool* pool = &MemoryPools[allocation->typeIndex][allocation->linear];
+		if (block->longest[0] == block->levels + 1 && pool->numBlocks > 1)
+		{
+			for (uint32_t i = 0; i < pool->numBlocks; i++)
+			{
+				if (pool->blocks[i] == block)
+				{
+					pool->blocks[i] = pool->blocks[--pool->numBlocks];
+					break;
+				}
+			}
+			destroyMemoryBlock(block);
+		}
+	}
+	else if (allocation->memory != VK_NULL_HANDLE)
+	{
+		vkFreeMemory(Device, allocation->memory, Alloc);
+		MemoryStatistics.dedicatedBytes -= allocation->size;
+		MemoryStatistics.numDedicated--;
+	}
+	memset(allocation, 0, sizeof(struct MemoryAllocation));
+}
+
+static void initMemoryAllocator(void)
+{
+	vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
+	memset(MemoryPools, 0, sizeof(MemoryPools));
+	memset(&MemoryStatistics, 0, sizeof(MemoryStatistics));
+}
+
+static void releaseMemoryAllocator(void)
+{
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+	{
+		for (uint32_t j = 0; j < 2; j++)
+		{
+			struct MemoryPool* pool = &MemoryPools[i][j];
+			for (uint32_t k = 0; k < pool->numBlocks; k++)
+			{
+				destroyMemoryBlock(pool->blocks[k]);
+			}
+			freeMem(pool->blocks);
+			pool->numBlocks = 0;
+		}
+	}
+}
+
+void getMemoryStats(struct MemoryStats* stats)
+{
+	*stats = MemoryStatistics;
+}
@@ -0,0 +1,620 @@
+#pragma once
+
+#if WITH_NULL_BACKEND
+
+// every entry point vulkan-kit calls succeeds without touching a driver,
+// host visible memory is backed by malloc so uploads and transient data still work
+struct NullObject
+{
+	VkDeviceSize size;
+	uint8_t* data;
+};
+
+static const char* kNullDeviceExtensions[] = {
+	VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
+	VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME,
+	VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME
+};
+
+static struct { int unused; } NullInstance, NullPhysicalDevice, NullDevice, NullQueue;
+static SDL_atomic_t NullHandleCounter;
+
+#define nextNullHandle(type) ((type)(uintptr_t)(SDL_AtomicIncRef(&NullHandleCounter) + 1))
+#define toNullHandle(type, object) ((type)(uintptr_t)(object))
+#define fromNullHandle(handle) ((struct NullObject*)(uintptr_t)(handle))
+
+static VkResult VKAPI_CALL nullCreateInstance(const VkInstanceCreateInfo* info, const VkAllocationCallbacks* alloc, VkInstance* instance)
+{
+	*instance = (VkInstance)&NullInstance;
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullDestroyInstance(VkInstance instance, const VkAllocationCallbacks* alloc)
+{
+}
+
+static void VKAPI_CALL nullDestroySurfaceKHR(VkInstance instance, VkSurfaceKHR surface, const VkAllocationCallbacks* alloc)
+{
+}
+
+static VkResult VKAPI_CALL nullEnumeratePhysicalDevices(VkInstance instance, uint32_t* count, VkPhysicalDevice* devices)
+{
+	if (devices && *count > 0)
+	{
+		devices[0] = (VkPhysicalDevice)&NullPhysicalDevice;
+	}
+	*count = 1;
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullGetPhysicalDeviceProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties* properties)
+{
+	const VkPhysicalDeviceProperties retval = {
+		.apiVersion = VK_API_VERSION_1_1,
+		.deviceType = VK_PHYSICAL_DEVICE_TYPE_CPU,
+		.deviceName = "vulkan-kit null device",
+		.limits = {
+			.maxImageDimension2D = 16384,
+			.maxUniformBufferRange = 65536,
+			.maxStorageBufferRange = UINT32_MAX,
+			.maxPushConstantsSize = 128,
+			.maxMemoryAllocationCount = UINT32_MAX,
+			.bufferImageGranularity = 1,
+			.maxBoundDescriptorSets = 8,
+			.maxDrawIndirectCount = UINT32_MAX,
+			.minUniformBufferOffsetAlignment = 64,
+			.minStorageBufferOffsetAlignment = 64,
+			.nonCoherentAtomSize = 64,
+			.optimalBufferCopyOffsetAlignment = 16,
+			.optimalBufferCopyRowPitchAlignment = 16,
+			.timestampPeriod = 1.f,
+			.timestampComputeAndGraphics = VK_TRUE,
+			.maxComputeWorkGroupCount = { 65535, 65535, 65535 }
+		}
+	};
+	*properties = retval;
+}
+
+static void VKAPI_CALL nullGetPhysicalDeviceProperties2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties2* properties)
+{
+	nullGetPhysicalDeviceProperties(physicalDevice, &properties->properties);
+	for (VkBaseOutStructure* next = properties->pNext; next; next = next->pNext)
+	{
+		if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR)
+		{
+			((VkPhysicalDevicePushDescriptorPropertiesKHR*)next)->maxPushDescriptors = 32;
+		}
+	}
+}
+
+static void VKAPI_CALL nullGetPhysicalDeviceFeatures(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures* features)
+{
+	memset(features, 0, sizeof(VkPhysicalDeviceFeatures));
+	features->multiDrawIndirect = VK_TRUE;
+	features->drawIndirectFirstInstance = VK_TRUE;
+}
+
+static void VKAPI_CALL nullGetPhysicalDeviceFeatures2(VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2* features)
+{
+	nullGetPhysicalDeviceFeatures(physicalDevice, &features->features);
+	for (VkBaseOutStructure* next = features->pNext; next; next = next->pNext)
+	{
+		if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR)
+		{
+			((VkPhysicalDeviceSynchronization2FeaturesKHR*)next)->synchronization2 = VK_TRUE;
+		}
+	}
+}
+
+static void VKAPI_CALL nullGetPhysicalDeviceMemoryProperties(VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties* properties)
+{
+	memset(properties, 0, sizeof(VkPhysicalDeviceMemoryProperties));
+	// one type with every flag like lavapipe, so the exclusion fallback in findMemoryType gets exercised
+	properties->memoryTypeCount = 1;
+	properties->memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+		| VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	properties->memoryTypes[0].heapIndex = 0;
+	properties->memoryHeapCount = 1;
+	properties->memoryHeaps[0].size = 512ull << 20;
+	properties->memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+}
+
+static void VKAPI_CALL nullGetPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice physicalDevice, uint32_t* count, VkQueueFamilyProperties* properties)
+{
+	if (properties && *count > 0)
+	{
+		memset(properties, 0, sizeof(VkQueueFamilyProperties));
+		properties->queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+		properties->queueCount = 1;
+		properties->timestampValidBits = 64;
+	}
+	*count = 1;
+}
+
+static void VKAPI_CALL nullGetPhysicalDeviceFormatProperties(VkPhysicalDevice physicalDevice, VkFormat format, VkFormatProperties* properties)
+{
+	properties->linearTilingFeatures = ~(VkFormatFeatureFlags)0;
+	properties->optimalTilingFeatures = ~(VkFormatFeatureFlags)0;
+	properties->bufferFeatures = ~(VkFormatFeatureFlags)0;
+}
+
+static VkResult VKAPI_CALL nullEnumerateDeviceExtensionProperties(VkPhysicalDevice physicalDevice, const char* layer, uint32_t* count, VkExtensionProperties* properties)
+{
+	const uint32_t numAvailable = _countof(kNullDeviceExtensions);
+	if (!properties)
+	{
+		*count = numAvailable;
+		return VK_SUCCESS;
+	}
+	const uint32_t numWritten = (*count < numAvailable) ? *count : numAvailable;
+	for (uint32_t i = 0; i < numWritten; i++)
+	{
+		snprintf(properties[i].extensionName, VK_MAX_EXTENSION_NAME_SIZE, "%s", kNullDeviceExtensions[i]);
+		properties[i].specVersion = 1;
+	}
+	*count = numWritten;
+	return (numWritten < numAvailable) ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullCreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* info, const VkAllocationCallbacks* alloc, VkDevice* device)
+{
+	*device = (VkDevice)&NullDevice;
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullDestroyDevice(VkDevice device, const VkAllocationCallbacks* alloc)
+{
+}
+
+static VkResult VKAPI_CALL nullDeviceWaitIdle(VkDevice device)
+{
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullGetDeviceQueue(VkDevice device, uint32_t family, uint32_t index, VkQueue* queue)
+{
+	*queue = (VkQueue)&NullQueue;
+}
+
+static VkResult VKAPI_CALL nullQueueSubmit(VkQueue queue, uint32_t count, const VkSubmitInfo* submits, VkFence fence)
+{
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullAllocateMemory(VkDevice device, const VkMemoryAllocateInfo* info, const VkAllocationCallbacks* alloc, VkDeviceMemory* memory)
+{
+	VkPhysicalDeviceMemoryProperties props;
+	nullGetPhysicalDeviceMemoryProperties(VK_NULL_HANDLE, &props);
+	retvalIfNot(info->memoryTypeIndex < props.memoryTypeCount, VK_ERROR_OUT_OF_DEVICE_MEMORY);
+	struct NullObject* object = calloc(1, sizeof(struct NullObject));
+	retvalIfNot(object, VK_ERROR_OUT_OF_HOST_MEMORY);
+	object->size = info->allocationSize;
+	if (props.memoryTypes[info->memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		object->data = malloc((size_t)info->allocationSize);
+		if (!object->data)
+		{
+			freeMem(object);
+			return VK_ERROR_OUT_OF_HOST_MEMORY;
+		}
+	}
+	*memory = toNullHandle(VkDeviceMemory, object);
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullFreeMemory(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* alloc)
+{
+	struct NullObject* object = fromNullHandle(memory);
+	if (object)
+	{
+		freeMem(object->data);
+		freeMem(object);
+	}
+}
+
+static VkResult VKAPI_CALL nullMapMemory(VkDevice device, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size, VkMemoryMapFlags flags, void** data)
+{
+	struct NullObject* object = fromNullHandle(memory);
+	retvalIfNot(object->data, VK_ERROR_MEMORY_MAP_FAILED);
+	*data = object->data + offset;
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullCreateBuffer(VkDevice device, const VkBufferCreateInfo* info, const VkAllocationCallbacks* alloc, VkBuffer* buffer)
+{
+	struct NullObject* object = calloc(1, sizeof(struct NullObject));
+	retvalIfNot(object, VK_ERROR_OUT_OF_HOST_MEMORY);
+	object->size = info->size;
+	*buffer = toNullHandle(VkBuffer, object);
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullDestroyBuffer(VkDevice device, VkBuffer buffer, const VkAllocationCallbacks* alloc)
+{
+	struct NullObject* object = fromNullHandle(buffer);
+	freeMem(object);
+}
+
+// sized for the widest texel, exact image footprints do not matter here
+static VkResult VKAPI_CALL nullCreateImage(VkDevice device, const VkImageCreateInfo* info, const VkAllocationCallbacks* alloc, VkImage* image)
+{
+	struct NullObject* object = calloc(1, sizeof(struct NullObject));
+	retvalIfNot(object, VK_ERROR_OUT_OF_HOST_MEMORY);
+	const VkDeviceSize texels = (VkDeviceSize)info->extent.width * info->extent.height * info->extent.depth * info->arrayLayers;
+	object->size = 16 * ((info->mipLevels > 1) ? texels + texels / 3 : texels);
+	*image = toNullHandle(VkImage, object);
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullDestroyImage(VkDevice device, VkImage image, const VkAllocationCallbacks* alloc)
+{
+	struct NullObject* object = fromNullHandle(image);
+	freeMem(object);
+}
+
+static void getNullMemoryRequirements(const struct NullObject* object, VkMemoryRequirements2* requirements)
+{
+	requirements->memoryRequirements.size = (object->size + 255) & ~(VkDeviceSize)255;
+	requirements->memoryRequirements.alignment = 256;
+	requirements->memoryRequirements.memoryTypeBits = 1;
+}
+
+static void VKAPI_CALL nullGetBufferMemoryRequirements2(VkDevice device, const VkBufferMemoryRequirementsInfo2* info, VkMemoryRequirements2* requirements)
+{
+	getNullMemoryRequirements(fromNullHandle(info->buffer), requirements);
+}
+
+static void VKAPI_CALL nullGetImageMemoryRequirements2(VkDevice device, const VkImageMemoryRequirementsInfo2* info, VkMemoryRequirements2* requirements)
+{
+	getNullMemoryRequirements(fromNullHandle(info->image), requirements);
+}
+
+static VkResult VKAPI_CALL nullBindBufferMemory(VkDevice device, VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize offset)
+{
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullBindImageMemory(VkDevice device, VkImage image, VkDeviceMemory memory, VkDeviceSize offset)
+{
+	return VK_SUCCESS;
+}
+
+#define NULL_OBJECT(type) \
+static VkResult VKAPI_CALL nullCreate##type(VkDevice device, const Vk##type##CreateInfo* info, const VkAllocationCallbacks* alloc, Vk##type* handle) \
+{ \
+	*handle = nextNullHandle(Vk##type); \
+	return VK_SUCCESS; \
+} \
+static void VKAPI_CALL nullDestroy##type(VkDevice device, Vk##type handle, const VkAllocationCallbacks* alloc) \
+{ \
+}
+
+NULL_OBJECT(CommandPool)
+NULL_OBJECT(DescriptorPool)
+NULL_OBJECT(DescriptorSetLayout)
+NULL_OBJECT(Fence)
+NULL_OBJECT(Framebuffer)
+NULL_OBJECT(ImageView)
+NULL_OBJECT(PipelineCache)
+NULL_OBJECT(PipelineLayout)
+NULL_OBJECT(QueryPool)
+NULL_OBJECT(RenderPass)
+NULL_OBJECT(Sampler)
+NULL_OBJECT(Semaphore)
+NULL_OBJECT(ShaderModule)
+
+#undef NULL_OBJECT
+
+static void VKAPI_CALL nullDestroySwapchainKHR(VkDevice device, VkSwapchainKHR swapchain, const VkAllocationCallbacks* alloc)
+{
+}
+
+static VkResult VKAPI_CALL nullCreateGraphicsPipelines(VkDevice device, VkPipelineCache cache, uint32_t count, const VkGraphicsPipelineCreateInfo* infos, const VkAllocationCallbacks* alloc, VkPipeline* pipelines)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		pipelines[i] = nextNullHandle(VkPipeline);
+	}
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullCreateComputePipelines(VkDevice device, VkPipelineCache cache, uint32_t count, const VkComputePipelineCreateInfo* infos, const VkAllocationCallbacks* alloc, VkPipeline* pipelines)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		pipelines[i] = nextNullHandle(VkPipeline);
+	}
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullDestroyPipeline(VkDevice device, VkPipeline pipeline, const VkAllocationCallbacks* alloc)
+{
+}
+
+static VkResult VKAPI_CALL nullGetPipelineCacheData(VkDevice device, VkPipelineCache cache, size_t* size, void* data)
+{
+	*size = 0;
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullAllocateCommandBuffers(VkDevice device, const VkCommandBufferAllocateInfo* info, VkCommandBuffer* buffers)
+{
+	for (uint32_t i = 0; i < info->commandBufferCount; i++)
+	{
+		buffers[i] = nextNullHandle(VkCommandBuffer);
+	}
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullAllocateDescriptorSets(VkDevice device, const VkDescriptorSetAllocateInfo* info, VkDescriptorSet* sets)
+{
+	for (uint32_t i = 0; i < info->descriptorSetCount; i++)
+	{
+		sets[i] = nextNullHandle(VkDescriptorSet);
+	}
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullResetDescriptorPool(VkDevice device, VkDescriptorPool pool, VkDescriptorPoolResetFlags flags)
+{
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullUpdateDescriptorSets(VkDevice device, uint32_t numWrites, const VkWriteDescriptorSet* writes, uint32_t numCopies, const VkCopyDescriptorSet* copies)
+{
+}
+
+static VkResult VKAPI_CALL nullGetFenceStatus(VkDevice device, VkFence fence)
+{
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullWaitForFences(VkDevice device, uint32_t count, const VkFence* fences, VkBool32 waitAll, uint64_t timeout)
+{
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullResetFences(VkDevice device, uint32_t count, const VkFence* fences)
+{
+	return VK_SUCCESS;
+}
+
+// no query is ever available, so timestamp scopes resolve to nothing
+static VkResult VKAPI_CALL nullGetQueryPoolResults(VkDevice device, VkQueryPool pool, uint32_t first, uint32_t count, size_t bytes, void* data, VkDeviceSize stride, VkQueryResultFlags flags)
+{
+	memset(data, 0, bytes);
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullBeginCommandBuffer(VkCommandBuffer cmdBuffer, const VkCommandBufferBeginInfo* info)
+{
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullEndCommandBuffer(VkCommandBuffer cmdBuffer)
+{
+	return VK_SUCCESS;
+}
+
+static VkResult VKAPI_CALL nullResetCommandBuffer(VkCommandBuffer cmdBuffer, VkCommandBufferResetFlags flags)
+{
+	return VK_SUCCESS;
+}
+
+static void VKAPI_CALL nullCmdBeginRenderPass(VkCommandBuffer cmdBuffer, const VkRenderPassBeginInfo* info, VkSubpassContents contents)
+{
+}
+
+static void VKAPI_CALL nullCmdEndRenderPass(VkCommandBuffer cmdBuffer)
+{
+}
+
+static void VKAPI_CALL nullCmdExecuteCommands(VkCommandBuffer cmdBuffer, uint32_t count, const VkCommandBuffer* buffers)
+{
+}
+
+static void VKAPI_CALL nullCmdBindPipeline(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipeline pipeline)
+{
+}
+
+static void VKAPI_CALL nullCmdBindDescriptorSets(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t first, uint32_t count, const VkDescriptorSet* sets, uint32_t numOffsets, const uint32_t* offsets)
+{
+}
+
+static void VKAPI_CALL nullCmdPushDescriptorSetKHR(VkCommandBuffer cmdBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, uint32_t count, const VkWriteDescriptorSet* writes)
+{
+}
+
+static void VKAPI_CALL nullCmdBindVertexBuffers(VkCommandBuffer cmdBuffer, uint32_t first, uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets)
+{
+}
+
+static void VKAPI_CALL nullCmdBindIndexBuffer(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+}
+
+static void VKAPI_CALL nullCmdSetViewport(VkCommandBuffer cmdBuffer, uint32_t first, uint32_t count, const VkViewport* viewports)
+{
+}
+
+static void VKAPI_CALL nullCmdSetScissor(VkCommandBuffer cmdBuffer, uint32_t first, uint32_t count, const VkRect2D* scissors)
+{
+}
+
+static void VKAPI_CALL nullCmdDrawIndexed(VkCommandBuffer cmdBuffer, uint32_t numIndices, uint32_t numInstances, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+}
+
+static void VKAPI_CALL nullCmdDrawIndexedIndirect(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset, uint32_t count, uint32_t stride)
+{
+}
+
+static void VKAPI_CALL nullCmdDrawIndexedIndirectCountKHR(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxCount, uint32_t stride)
+{
+}
+
+static void VKAPI_CALL nullCmdDispatch(VkCommandBuffer cmdBuffer, uint32_t x, uint32_t y, uint32_t z)
+{
+}
+
+static void VKAPI_CALL nullCmdDispatchIndirect(VkCommandBuffer cmdBuffer, VkBuffer buffer, VkDeviceSize offset)
+{
+}
+
+static void VKAPI_CALL nullCmdPipelineBarrier(VkCommandBuffer cmdBuffer, VkPipelineStageFlags src, VkPipelineStageFlags dst, VkDependencyFlags flags,
+	uint32_t numMemory, const VkMemoryBarrier* memory, uint32_t numBuffer, const VkBufferMemoryBarrier* buffer, uint32_t numImage, const VkImageMemoryBarrier* image)
+{
+}
+
+static void VKAPI_CALL nullCmdPipelineBarrier2KHR(VkCommandBuffer cmdBuffer, const VkDependencyInfoKHR* dependency)
+{
+}
+
+static void VKAPI_CALL nullCmdCopyBuffer(VkCommandBuffer cmdBuffer, VkBuffer src, VkBuffer dst, uint32_t count, const VkBufferCopy* regions)
+{
+}
+
+static void VKAPI_CALL nullCmdCopyBufferToImage(VkCommandBuffer cmdBuffer, VkBuffer src, VkImage dst, VkImageLayout layout, uint32_t count, const VkBufferImageCopy* regions)
+{
+}
+
+static void VKAPI_CALL nullCmdBlitImage(VkCommandBuffer cmdBuffer, VkImage src, VkImageLayout srcLayout, VkImage dst, VkImageLayout dstLayout, uint32_t count, const VkImageBlit* regions, VkFilter filter)
+{
+}
+
+static void VKAPI_CALL nullCmdResetQueryPool(VkCommandBuffer cmdBuffer, VkQueryPool pool, uint32_t first, uint32_t count)
+{
+}
+
+static void VKAPI_CALL nullCmdWriteTimestamp(VkCommandBuffer cmdBuffer, VkPipelineStageFlags stage, VkQueryPool pool, uint32_t query)
+{
+}
+
+static PFN_vkVoidFunction VKAPI_CALL nullGetInstanceProcAddr(VkInstance instance, const char* name);
+
+static PFN_vkVoidFunction VKAPI_CALL nullGetDeviceProcAddr(VkDevice device, const char* name)
+{
+	return nullGetInstanceProcAddr(VK_NULL_HANDLE, name);
+}
+
+// the assignment checks each stub against its PFN type, unknown entry points stay NULL
+#define NULL_PROC(fn) if (strcmp(name, "vk" #fn) == 0) { PFN_vk##fn proc = null##fn; return (PFN_vkVoidFunction)proc; }
+
+static PFN_vkVoidFunction VKAPI_CALL nullGetInstanceProcAddr(VkInstance instance, const char* name)
+{
+	NULL_PROC(GetInstanceProcAddr)
+	NULL_PROC(GetDeviceProcAddr)
+	NULL_PROC(CreateInstance)
+	NULL_PROC(DestroyInstance)
+	NULL_PROC(DestroySurfaceKHR)
+	NULL_PROC(EnumeratePhysicalDevices)
+	NULL_PROC(GetPhysicalDeviceProperties)
+	NULL_PROC(GetPhysicalDeviceProperties2)
+	NULL_PROC(GetPhysicalDeviceFeatures)
+	NULL_PROC(GetPhysicalDeviceFeatures2)
+	NULL_PROC(GetPhysicalDeviceMemoryProperties)
+	NULL_PROC(GetPhysicalDeviceQueueFamilyProperties)
+	NULL_PROC(GetPhysicalDeviceFormatProperties)
+	NULL_PROC(EnumerateDeviceExtensionProperties)
+	NULL_PROC(CreateDevice)
+	NULL_PROC(DestroyDevice)
+	NULL_PROC(DeviceWaitIdle)
+	NULL_PROC(GetDeviceQueue)
+	NULL_PROC(QueueSubmit)
+	NULL_PROC(AllocateMemory)
+	NULL_PROC(FreeMemory)
+	NULL_PROC(MapMemory)
+	NULL_PROC(CreateBuffer)
+	NULL_PROC(DestroyBuffer)
+	NULL_PROC(CreateImage)
+	NULL_PROC(DestroyImage)
+	NULL_PROC(GetBufferMemoryRequirements2)
+	NULL_PROC(GetImageMemoryRequirements2)
+	NULL_PROC(BindBufferMemory)
+	NULL_PROC(BindImageMemory)
+	NULL_PROC(CreateCommandPool)
+	NULL_PROC(DestroyCommandPool)
+	NULL_PROC(CreateDescriptorPool)
+	NULL_PROC(DestroyDescriptorPool)
+	NULL_PROC(CreateDescriptorSetLayout)
+	NULL_PROC(DestroyDescriptorSetLayout)
+	NULL_PROC(CreateFence)
+	NULL_PROC(DestroyFence)
+	NULL_PROC(CreateFramebuffer)
+	NULL_PROC(DestroyFramebuffer)
+	NULL_PROC(CreateImageView)
+	NULL_PROC(DestroyImageView)
+	NULL_PROC(CreatePipelineCache)
+	NULL_PROC(DestroyPipelineCache)
+	NULL_PROC(CreatePipelineLayout)
+	NULL_PROC(DestroyPipelineLayout)
+	NULL_PROC(CreateQueryPool)
+	NULL_PROC(DestroyQueryPool)
+	NULL_PROC(CreateRenderPass)
+	NULL_PROC(DestroyRenderPass)
+	NULL_PROC(CreateSampler)
+	NULL_PROC(DestroySampler)
+	NULL_PROC(CreateSemaphore)
+	NULL_PROC(DestroySemaphore)
+	NULL_PROC(CreateShaderModule)
+	NULL_PROC(DestroyShaderModule)
+	NULL_PROC(DestroySwapchainKHR)
+	NULL_PROC(CreateGraphicsPipelines)
+	NULL_PROC(CreateComputePipelines)
+	NULL_PROC(DestroyPipeline)
+	NULL_PROC(GetPipelineCacheData)
+	NULL_PROC(AllocateCommandBuffers)
+	NULL_PROC(AllocateDescriptorSets)
+	NULL_PROC(ResetDescriptorPool)
+	NULL_PROC(UpdateDescriptorSets)
+	NULL_PROC(GetFenceStatus)
+	NULL_PROC(WaitForFences)
+	NULL_PROC(ResetFences)
+	NULL_PROC(GetQueryPoolResults)
+	NULL_PROC(BeginCommandBuffer)
+	NULL_PROC(EndCommandBuffer)
+	NULL_PROC(ResetCommandBuffer)
+	NULL_PROC(CmdBeginRenderPass)
+	NULL_PROC(CmdEndRenderPass)
+	NULL_PROC(CmdExecuteCommands)
+	NULL_PROC(CmdBindPipeline)
+	NULL_PROC(CmdBindDescriptorSets)
+	NULL_PROC(CmdPushDescriptorSetKHR)
+	NULL_PROC(CmdBindVertexBuffers)
+	NULL_PROC(CmdBindIndexBuffer)
+	NULL_PROC(CmdSetViewport)
+	NULL_PROC(CmdSetScissor)
+	NULL_PROC(CmdDrawIndexed)
+	NULL_PROC(CmdDrawIndexedIndirect)
+	NULL_PROC(CmdDrawIndexedIndirectCountKHR)
+	NULL_PROC(CmdDispatch)
+	NULL_PROC(CmdDispatchIndirect)
+	NULL_PROC(CmdPipelineBarrier)
+	NULL_PROC(CmdPipelineBarrier2KHR)
+	NULL_PROC(CmdCopyBuffer)
+	NULL_PROC(CmdCopyBufferToImage)
+	NULL_PROC(CmdBlitImage)
+	NULL_PROC(CmdResetQueryPool)
+	NULL_PROC(CmdWriteTimestamp)
+	return NULL;
+}
+
+#undef NULL_PROC
+
+static VkResult initializeLoader(void)
+{
+	if (NullBackend)
+	{
+		// surfaces and swapchains need a real driver
+		retvalIfNot(!Window, VK_ERROR_INITIALIZATION_FAILED);
+		volkInitializeCustom(nullGetInstanceProcAddr);
+		return VK_SUCCESS;
+	}
+	return volkInitialize();
+}
+
+#else
+
+#define initializeLoader() volkInitialize()
+
+#endif
@@ -1,28 +1,58 @@
 #pragma once
 
+enum PipelineStatus
+{
+	ePipelineStatus_Idle,
+	ePipelineStatus_Pending,
+	ePipelineStatus_Ready
+};
+
 struct PipelineT
 {
 	VkPipeline handle;
 	VkPipelineBindPoint bindPoint;
+	SDL_atomic_t status;
+	Pipeline fallback;
+	Pipeline nextPending;
+};
+
+struct PipelineState
+{
+	uint64_t key;
+	VkPipeline handle;
+	uint32_t refCount;
 };
 
+static struct PipelineState* PipelineStates = NULL;
+static uint32_t NumPipelineStates = 0;
+
+static SDL_mutex* PipelineLock = NULL;
+static SDL_cond* CompilerWake = NULL;
+static SDL_cond* CompilerDone = NULL;
+static SDL_Thread** CompilerThreads = NULL;
+static Pipeline PendingHead = NULL;
+static Pipeline PendingTail = NULL;
+static bool CompilerExit = false;
+
 struct GraphicsPipeline
 {
 	struct PipelineT base;
+	uint64_t shaderKey;
 	RenderPass renderPass;
 	VkPipelineShaderStageCreateInfo* shaderStages;
 	VkPipelineColorBlendAttachmentState* blendAttachment;
 	VkPipelineDepthStencilStateCreateInfo depthStencil;
 	VkPipelineRasterizationStateCreateInfo rasterizer;
 	VkVertexInputAttributeDescription* vertexAttrs;
+	VkVertexInputBindingDescription vertexBindings[MAX_VERTEX_BUFFERS];
 	uint32_t numShaderStages;
 	uint32_t numVertexAttrs;
-	uint32_t vertexStride;
 };
 
 struct ComputePipeline
 {
 	struct PipelineT base;
+	uint64_t shaderKey;
 	VkComputePipelineCreateInfo createInfo;
 };
 
@@ -52,6 +82,91 @@ static void setShaderStage(struct GraphicsPipeline* gp, VkShaderStageFlags stage
 	ss->pName = kShaderMain;
 }
 
+struct VertexFormat
+{
+	VkFormat format;
+	uint8_t bytes;
+	uint8_t componentBytes;
+	bool integer;
+};
+
+static const struct VertexFormat kVertexFormats[] = {
+	{ VK_FORMAT_R32_SFLOAT, 4, 4, false },
+	{ VK_FORMAT_R32G32_SFLOAT, 8, 4, false },
+	{ VK_FORMAT_R32G32B32_SFLOAT, 12, 4, false },
+	{ VK_FORMAT_R32G32B32A32_SFLOAT, 16, 4, false },
+	{ VK_FORMAT_R32_SINT, 4, 4, true },
+	{ VK_FORMAT_R32G32_SINT, 8, 4, true },
+	{ VK_FORMAT_R32G32B32_SINT, 12, 4, true },
+	{ VK_FORMAT_R32G32B32A32_SINT, 16, 4, true },
+	{ VK_FORMAT_R32_UINT, 4, 4, true },
+	{ VK_FORMAT_R32G32_UINT, 8, 4, true },
+	{ VK_FORMAT_R32G32B32_UINT, 12, 4, true },
+	{ VK_FORMAT_R32G32B32A32_UINT, 16, 4, true },
+	{ VK_FORMAT_R16_SFLOAT, 2, 2, false },
+	{ VK_FORMAT_R16G16_SFLOAT, 4, 2, false },
+	{ VK_FORMAT_R16G16B16_SFLOAT, 6, 2, false },
+	{ VK_FORMAT_R16G16B16A16_SFLOAT, 8, 2, false },
+	{ VK_FORMAT_R16_SNORM, 2, 2, false },
+	{ VK_FORMAT_R16G16_SNORM, 4, 2, false },
+	{ VK_FORMAT_R16G16B16_SNORM, 6, 2, false },
+	{ VK_FORMAT_R16G16B16A16_SNORM, 8, 2, false },
+	{ VK_FORMAT_R16_UNORM, 2, 2, false },
+	{ VK_FORMAT_R16G16_UNORM, 4, 2, false },
+	{ VK_FORMAT_R16G16B16A16_UNORM, 8, 2, false },
+	{ VK_FORMAT_R8_SNORM, 1, 1, false },
+	{ VK_FORMAT_R8G8_SNORM, 2, 1, false },
+	{ VK_FORMAT_R8G8B8_SNORM, 3, 1, false },
+	{ VK_FORMAT_R8G8B8A8_SNORM, 4, 1, false },
+	{ VK_FORMAT_R8_UNORM, 1, 1, false },
+	{ VK_FORMAT_R8G8_UNORM, 2, 1, false },
+	{ VK_FORMAT_R8G8B8_UNORM, 3, 1, false },
+	{ VK_FORMAT_R8G8B8A8_UNORM, 4, 1, false },
+	{ VK_FORMAT_A2B10G10R10_UNORM_PACK32, 4, 4, false },
+	{ VK_FORMAT_A2B10G10R10_SNORM_PACK32, 4, 4, false }
+};
+
+static const struct VertexFormat* findVertexFormat(VkFormat format)
+{
+	for (uint32_t i = 0; i < _countof(kVertexFormats); i++)
+	{
+		if (kVertexFormats[i].format == format)
+		{
+			return kVertexFormats + i;
+		}
+	}
+	return NULL;
+}
+
+// attributes are sorted by location and packed within their binding at component alignment
+static void layoutVertexInputs(struct GraphicsPipeline* gp)
+{
+	uint32_t alignment[MAX_VERTEX_BUFFERS];
+	for (uint32_t i = 0; i < MAX_VERTEX_BUFFERS; i++)
+	{
+		gp->vertexBindings[i].binding = i;
+		gp->vertexBindings[i].stride = 0;
+		alignment[i] = 1;
+	}
+	for (uint32_t i = 0; i < gp->numVertexAttrs; i++)
+	{
+		VkVertexInputAttributeDescription* attr = gp->vertexAttrs + i;
+		const struct VertexFormat* format = findVertexFormat(attr->format);
+		breakIfNot(attr->binding < MAX_VERTEX_BUFFERS && format);
+		VkVertexInputBindingDescription* binding = gp->vertexBindings + attr->binding;
+		attr->offset = (binding->stride + format->componentBytes - 1) & ~(format->componentBytes - 1u);
+		binding->stride = attr->offset + format->bytes;
+		if (format->componentBytes > alignment[attr->binding])
+		{
+			alignment[attr->binding] = format->componentBytes;
+		}
+	}
+	for (uint32_t i = 0; i < MAX_VERTEX_BUFFERS; i++)
+	{
+		gp->vertexBindings[i].stride = (gp->vertexBindings[i].stride + alignment[i] - 1) & ~(alignment[i] - 1);
+	}
+}
+
 Pipeline createGraphicsPipeline(const char* shaderFile, VkShaderStageFlags stageFlags, RenderPass renderPass)
 {
 	breakIfNot(renderPass);
@@ -79,51 +194,298 @@ Pipeline createGraphicsPipeline(const char* shaderFile, VkShaderStageFlags stage
 		blendAttachment[i].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	}
 
+	for (uint32_t i = 0; i < MAX_VERTEX_BUFFERS; i++)
+	{
+		retval->vertexBindings[i].inputRate = (i == 0) ? VK_VERTEX_INPUT_RATE_VERTEX : VK_VERTEX_INPUT_RATE_INSTANCE;
+	}
+
+	retval->shaderKey = kHashSeed;
 	if (stageFlags & VK_SHADER_STAGE_VERTEX_BIT)
 	{
-		VkShaderModule module = compileShader(VK_SHADER_STAGE_VERTEX_BIT, shaderFile, &retval->vertexAttrs, &retval->numVertexAttrs, &retval->vertexStride);
+		VkShaderModule module = compileShader(VK_SHADER_STAGE_VERTEX_BIT, shaderFile, &retval->shaderKey, &retval->vertexAttrs, &retval->numVertexAttrs);
 		if (module != VK_NULL_HANDLE)
 		{
 			setShaderStage(retval, VK_SHADER_STAGE_VERTEX_BIT, module);
 		}
+		layoutVertexInputs(retval);
 	}
 
 	if (stageFlags & VK_SHADER_STAGE_FRAGMENT_BIT)
 	{
-		VkShaderModule module = compileShader(VK_SHADER_STAGE_FRAGMENT_BIT, shaderFile, NULL, NULL, NULL);
+		VkShaderModule module = compileShader(VK_SHADER_STAGE_FRAGMENT_BIT, shaderFile, &retval->shaderKey, NULL, NULL);
 		if (module != VK_NULL_HANDLE)
 		{
 			setShaderStage(retval, VK_SHADER_STAGE_FRAGMENT_BIT, module);
 		}
 	}
 
+	tracePipeline(eTraceOp_CreateGraphicsPipeline, traceKey(&retval->base), shaderFile, stageFlags, renderPass);
+	return &retval->base;
+}
+
+Pipeline createComputePipeline(const char* shaderFile)
+{
+	struct ComputePipeline* retval = calloc(1, sizeof(struct ComputePipeline));
+	retvalIfNot(retval, NULL);
+
+	retval->shaderKey = kHashSeed;
+	VkShaderModule module = compileShader(VK_SHADER_STAGE_COMPUTE_BIT, shaderFile, &retval->shaderKey, NULL, NULL);
+	if (module == VK_NULL_HANDLE)
+	{
+		freeMem(retval);
+		return NULL;
+	}
+
+	retval->base.bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+	retval->createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	retval->createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	retval->createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	retval->createInfo.stage.module = module;
+	retval->createInfo.stage.pName = kShaderMain;
+	retval->createInfo.layout = PipelineLayout;
+	tracePipeline(eTraceOp_CreateComputePipeline, traceKey(&retval->base), shaderFile, VK_SHADER_STAGE_COMPUTE_BIT, NULL);
 	return &retval->base;
 }
 
 void setGraphicsPipelineDepthTest(Pipeline pipeline, bool write, bool test, VkCompareOp compareOp)
 {
+	traceCall(eTraceOp_SetGraphicsPipelineDepthTest, traceObject(pipeline), write, test, compareOp);
 	if (pipeline->bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
 	{
 		struct GraphicsPipeline* gp = (struct GraphicsPipeline*)pipeline;
-		gp->depthStencil.depthWriteEnable = (write) ? VK_TRUE : VK_FALSE;
-		gp->depthStencil.depthTestEnable = (test) ? VK_TRUE : VK_FALSE;
-		gp->depthStencil.depthCompareOp = compareOp;
+		SDL_LockMutex(PipelineLock);
+		bool idle = SDL_AtomicGet(&pipeline->status) == ePipelineStatus_Idle;
+		if (idle)
+		{
+			gp->depthStencil.depthWriteEnable = (write) ? VK_TRUE : VK_FALSE;
+			gp->depthStencil.depthTestEnable = (test) ? VK_TRUE : VK_FALSE;
+			gp->depthStencil.depthCompareOp = compareOp;
+		}
+		SDL_UnlockMutex(PipelineLock);
+		returnIfNot(idle);
 	}
 }
 
 void setGraphicsPipelineFaceCulling(Pipeline pipeline, VkCullModeFlags mode)
 {
+	traceCall(eTraceOp_SetGraphicsPipelineFaceCulling, traceObject(pipeline), mode);
+	if (pipeline->bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
+	{
+		struct GraphicsPipeline* gp = (struct GraphicsPipeline*)pipeline;
+		SDL_LockMutex(PipelineLock);
+		bool idle = SDL_AtomicGet(&pipeline->status) == ePipelineStatus_Idle;
+		if (idle)
+		{
+			gp->rasterizer.cullMode = mode;
+		}
+		SDL_UnlockMutex(PipelineLock);
+		returnIfNot(idle);
+	}
+}
+
+void setGraphicsPipelineVertexInput(Pipeline pipeline, uint32_t location, uint32_t binding, VkVertexInputRate rate)
+{
+	returnIfNot(binding < MAX_VERTEX_BUFFERS);
+	traceCall(eTraceOp_SetGraphicsPipelineVertexInput, traceObject(pipeline), location, binding, rate);
 	if (pipeline->bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
 	{
+		// the compiler reads the vertex layout, only pipelines that aren't queued or built take changes
 		struct GraphicsPipeline* gp = (struct GraphicsPipeline*)pipeline;
-		gp->rasterizer.cullMode = mode;
+		SDL_LockMutex(PipelineLock);
+		bool idle = SDL_AtomicGet(&pipeline->status) == ePipelineStatus_Idle;
+		if (idle)
+		{
+			for (uint32_t i = 0; i < gp->numVertexAttrs; i++)
+			{
+				if (gp->vertexAttrs[i].location == location)
+				{
+					gp->vertexAttrs[i].binding = binding;
+				}
+			}
+			gp->vertexBindings[binding].inputRate = rate;
+			layoutVertexInputs(gp);
+		}
+		SDL_UnlockMutex(PipelineLock);
+		returnIfNot(idle);
+	}
+}
+
+// packed formats are converted to the reflected shader type on fetch, integer inputs keep integer formats
+void setGraphicsPipelineVertexFormat(Pipeline pipeline, uint32_t location, VkFormat format)
+{
+	const struct VertexFormat* packed = findVertexFormat(format);
+	VkFormatProperties props = { 0 };
+	vkGetPhysicalDeviceFormatProperties(PhysicalDevice, format, &props);
+	returnIfNot(packed && (props.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT));
+	traceCall(eTraceOp_SetGraphicsPipelineVertexFormat, traceObject(pipeline), location, format);
+	if (pipeline->bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
+	{
+		struct GraphicsPipeline* gp = (struct GraphicsPipeline*)pipeline;
+		SDL_LockMutex(PipelineLock);
+		bool idle = SDL_AtomicGet(&pipeline->status) == ePipelineStatus_Idle;
+		bool matches = true;
+		for (uint32_t i = 0; idle && i < gp->numVertexAttrs; i++)
+		{
+			if (gp->vertexAttrs[i].location == location)
+			{
+				matches = findVertexFormat(gp->vertexAttrs[i].format)->integer == packed->integer;
+				if (matches)
+				{
+					gp->vertexAttrs[i].format = format;
+					layoutVertexInputs(gp);
+				}
+				break;
+			}
+		}
+		SDL_UnlockMutex(PipelineLock);
+		returnIfNot(idle && matches);
+	}
+}
+
+void setPipelineFallback(Pipeline pipeline, Pipeline fallback)
+{
+	traceCall(eTraceOp_SetPipelineFallback, traceObject(pipeline), traceObject(fallback));
+	pipeline->fallback = fallback;
+}
+
+static VkPipeline findPipelineState(uint64_t key)
+{
+	VkPipeline retval = VK_NULL_HANDLE;
+	SDL_LockMutex(PipelineLock);
+	for (uint32_t i = 0; i < NumPipelineStates; i++)
+	{
+		if (PipelineStates[i].key == key)
+		{
+			++PipelineStates[i].refCount;
+			retval = PipelineStates[i].handle;
+			break;
+		}
 	}
+	SDL_UnlockMutex(PipelineLock);
+	return retval;
+}
+
+// compiler threads may have built the same state meanwhile, the first one added wins
+static VkPipeline addPipelineState(uint64_t key, VkPipeline handle)
+{
+	SDL_LockMutex(PipelineLock);
+	for (uint32_t i = 0; i < NumPipelineStates; i++)
+	{
+		if (PipelineStates[i].key == key)
+		{
+			++PipelineStates[i].refCount;
+			vkDestroyPipeline(Device, handle, Alloc);
+			handle = PipelineStates[i].handle;
+			SDL_UnlockMutex(PipelineLock);
+			return handle;
+		}
+	}
+	safeRealloc(PipelineStates, (NumPipelineStates + 1) * sizeof(struct PipelineState));
+	struct PipelineState* state = &PipelineStates[NumPipelineStates++];
+	state->key = key;
+	state->handle = handle;
+	state->refCount = 1;
+	SDL_UnlockMutex(PipelineLock);
+	return handle;
+}
+
+static void releasePipelineState(VkPipeline handle)
+{
+	SDL_LockMutex(PipelineLock);
+	for (uint32_t i = 0; i < NumPipelineStates; i++)
+	{
+		if (PipelineStates[i].handle == handle)
+		{
+			if (--PipelineStates[i].refCount == 0)
+			{
+				vkDestroyPipeline(Device, handle, Alloc);
+				PipelineStates[i] = PipelineStates[--NumPipelineStates];
+			}
+			if (NumPipelineStates == 0)
+			{
+				freeMem(PipelineStates);
+			}
+			SDL_UnlockMutex(PipelineLock);
+			return;
+		}
+	}
+	SDL_UnlockMutex(PipelineLock);
+	vkDestroyPipeline(Device, handle, Alloc);
+}
+
+static void waitForPipeline(Pipeline pipeline)
+{
+	if (SDL_AtomicGet(&pipeline->status) == ePipelineStatus_Pending)
+	{
+		SDL_LockMutex(PipelineLock);
+		while (SDL_AtomicGet(&pipeline->status) == ePipelineStatus_Pending)
+		{
+			SDL_CondWait(CompilerDone, PipelineLock);
+		}
+		SDL_UnlockMutex(PipelineLock);
+	}
+}
+
+void loadPipelineCache(void)
+{
+	size_t bytes = 0;
+	void* data = NULL;
+	FILE* file = (PipelineCacheFile) ? fopen(PipelineCacheFile, "rb") : NULL;
+	if (file)
+	{
+		fclose(file);
+		data = loadFromFile(PipelineCacheFile, &bytes);
+	}
+	if (data)
+	{
+		const VkPhysicalDeviceProperties props = DeviceProperties;
+		const VkPipelineCacheHeaderVersionOne* header = data;
+		if (bytes < sizeof(VkPipelineCacheHeaderVersionOne)
+			|| header->headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			|| header->vendorID != props.vendorID
+			|| header->deviceID != props.deviceID
+			|| memcmp(header->pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			freeMem(data);
+			bytes = 0;
+		}
+	}
+	VkPipelineCacheCreateInfo pcci = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = bytes,
+		.pInitialData = data
+	};
+	breakIfFailed(vkCreatePipelineCache(Device, &pcci, Alloc, &PipelineCache));
+	freeMem(data);
+}
+
+void savePipelineCache(void)
+{
+	size_t bytes = 0;
+	if (PipelineCacheFile && vkGetPipelineCacheData(Device, PipelineCache, &bytes, NULL) == VK_SUCCESS && bytes)
+	{
+		void* data = malloc(bytes);
+		if (data && vkGetPipelineCacheData(Device, PipelineCache, &bytes, data) == VK_SUCCESS)
+		{
+			FILE* file = fopen(PipelineCacheFile, "wb");
+			if (file)
+			{
+				fwrite(data, 1, bytes, file);
+				fclose(file);
+			}
+		}
+		freeMem(data);
+	}
+	vkDestroyPipelineCache(Device, PipelineCache, Alloc);
+	PipelineCache = VK_NULL_HANDLE;
 }
 
 void destroyPipeline(Pipeline pipeline)
 {
 	if (pipeline)
 	{
+		traceDestroy(eTraceOp_DestroyPipeline, traceKey(pipeline));
+		waitForPipeline(pipeline);
 		switch (pipeline->bindPoint)
 		{
 		case VK_PIPELINE_BIND_POINT_GRAPHICS:
@@ -138,26 +500,35 @@ void destroyPipeline(Pipeline pipeline)
 			}
 			break;
 		case VK_PIPELINE_BIND_POINT_COMPUTE:
+			vkDestroyShaderModule(Device, ((struct ComputePipeline*)pipeline)->createInfo.stage.module, Alloc);
 			break;
 		default:
 			breakIfNot(0);
 		}
-		vkDestroyPipeline(Device, pipeline->handle, Alloc);
+		if (pipeline->handle != VK_NULL_HANDLE)
+		{
+			releasePipelineState(pipeline->handle);
+		}
 		freeMem(pipeline);
+		SDL_AtomicIncRef(&ResourceGeneration);
 	}
 }
 
 static void buildGraphicsPipeline(struct GraphicsPipeline* gp)
 {
-	VkVertexInputBindingDescription inputBinding = {
-		.binding = 0,
-		.stride = gp->vertexStride,
-		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-	};
+	uint32_t numInputBindings = 0;
+	VkVertexInputBindingDescription inputBindings[MAX_VERTEX_BUFFERS];
+	for (uint32_t i = 0; i < MAX_VERTEX_BUFFERS; i++)
+	{
+		if (gp->vertexBindings[i].stride)
+		{
+			inputBindings[numInputBindings++] = gp->vertexBindings[i];
+		}
+	}
 	VkPipelineVertexInputStateCreateInfo pvisci = {
 		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-		.vertexBindingDescriptionCount = 1,
-		.pVertexBindingDescriptions = &inputBinding,
+		.vertexBindingDescriptionCount = numInputBindings,
+		.pVertexBindingDescriptions = inputBindings,
 		.vertexAttributeDescriptionCount = gp->numVertexAttrs,
 		.pVertexAttributeDescriptions = gp->vertexAttrs
 	};
@@ -187,6 +558,20 @@ static void buildGraphicsPipeline(struct GraphicsPipeline* gp)
 		.dynamicStateCount = _countof(dynamicStates),
 		.pDynamicStates = dynamicStates
 	};
+	const VkRenderPass renderPass = getRenderPassHandle(gp->renderPass);
+	uint64_t key = hashBytes(&gp->shaderKey, sizeof(gp->shaderKey), kHashSeed);
+	key = hashRenderPass(gp->renderPass, key);
+	key = hashBytes(&gp->depthStencil, sizeof(gp->depthStencil), key);
+	key = hashBytes(&gp->rasterizer, sizeof(gp->rasterizer), key);
+	key = hashBytes(gp->blendAttachment, gp->renderPass->numColor * sizeof(VkPipelineColorBlendAttachmentState), key);
+	key = hashBytes(inputBindings, numInputBindings * sizeof(VkVertexInputBindingDescription), key);
+	key = hashBytes(gp->vertexAttrs, gp->numVertexAttrs * sizeof(VkVertexInputAttributeDescription), key);
+	gp->base.handle = findPipelineState(key);
+	if (gp->base.handle != VK_NULL_HANDLE)
+	{
+		return;
+	}
+
 	VkGraphicsPipelineCreateInfo gpci = {
 		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 		.stageCount = gp->numShaderStages,
@@ -201,35 +586,178 @@ static void buildGraphicsPipeline(struct GraphicsPipeline* gp)
 		.pColorBlendState = &pcbsci,
 		.pDynamicState = &pdsci,
 		.layout = PipelineLayout,
-		.renderPass =  getRenderPassHandle(gp->renderPass)
+		.renderPass = renderPass
 	};
-	breakIfFailed(vkCreateGraphicsPipelines(Device, VK_NULL_HANDLE, 1, &gpci, Alloc, &gp->base.handle));
+	breakIfFailed(vkCreateGraphicsPipelines(Device, PipelineCache, 1, &gpci, Alloc, &gp->base.handle));
+	gp->base.handle = addPipelineState(key, gp->base.handle);
 }
 
 static void buildComputePipeline(struct ComputePipeline* cp)
 {
-	breakIfFailed(vkCreateComputePipelines(Device, VK_NULL_HANDLE, 1, &cp->createInfo, Alloc, &cp->base.handle));
+	const VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+	uint64_t key = hashBytes(&cp->shaderKey, sizeof(cp->shaderKey), kHashSeed);
+	key = hashBytes(&bindPoint, sizeof(bindPoint), key);
+	cp->base.handle = findPipelineState(key);
+	if (cp->base.handle != VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	breakIfFailed(vkCreateComputePipelines(Device, PipelineCache, 1, &cp->createInfo, Alloc, &cp->base.handle));
+	cp->base.handle = addPipelineState(key, cp->base.handle);
+}
+
+static void buildPipeline(Pipeline pipeline)
+{
+	profileBegin("buildPipeline");
+	switch (pipeline->bindPoint)
+	{
+	case VK_PIPELINE_BIND_POINT_GRAPHICS:
+		buildGraphicsPipeline((struct GraphicsPipeline*)pipeline);
+		break;
+	case VK_PIPELINE_BIND_POINT_COMPUTE:
+		buildComputePipeline((struct ComputePipeline*)pipeline);
+		break;
+	default:
+		breakIfNot(0);
+	}
+	profileEnd();
+}
+
+static int runPipelineCompiler(void* userData)
+{
+	(void)userData;
+	SDL_LockMutex(PipelineLock);
+	while (PendingHead || !CompilerExit)
+	{
+		Pipeline pipeline = PendingHead;
+		if (!pipeline)
+		{
+			SDL_CondWait(CompilerWake, PipelineLock);
+			continue;
+		}
+		PendingHead = pipeline->nextPending;
+		if (!PendingHead)
+		{
+			PendingTail = NULL;
+		}
+		pipeline->nextPending = NULL;
+		SDL_UnlockMutex(PipelineLock);
+
+		buildPipeline(pipeline);
+
+		SDL_LockMutex(PipelineLock);
+		SDL_AtomicSet(&pipeline->status, ePipelineStatus_Ready);
+		SDL_CondBroadcast(CompilerDone);
+	}
+	SDL_UnlockMutex(PipelineLock);
+	return 0;
+}
+
+void startPipelineCompiler(void)
+{
+	PipelineLock = SDL_CreateMutex();
+	breakIfNot(PipelineLock);
+	if (NumCompilerThreads)
+	{
+		CompilerExit = false;
+		CompilerWake = SDL_CreateCond();
+		CompilerDone = SDL_CreateCond();
+		CompilerThreads = calloc(NumCompilerThreads, sizeof(SDL_Thread*));
+		breakIfNot(CompilerWake && CompilerDone && CompilerThreads);
+		for (uint32_t i = 0; i < NumCompilerThreads; i++)
+		{
+			CompilerThreads[i] = SDL_CreateThread(runPipelineCompiler, "vkk-pipeline-compiler", NULL);
+			breakIfNot(CompilerThreads[i]);
+		}
+	}
+}
+
+void stopPipelineCompiler(void)
+{
+	if (CompilerThreads)
+	{
+		SDL_LockMutex(PipelineLock);
+		CompilerExit = true;
+		SDL_CondBroadcast(CompilerWake);
+		SDL_UnlockMutex(PipelineLock);
+		for (uint32_t i = 0; i < NumCompilerThreads; i++)
+		{
+			SDL_WaitThread(CompilerThreads[i], NULL);
+		}
+		freeMem(CompilerThreads);
+		SDL_DestroyCond(CompilerDone);
+		SDL_DestroyCond(CompilerWake);
+		CompilerDone = NULL;
+		CompilerWake = NULL;
+	}
+	SDL_DestroyMutex(PipelineLock);
+	PipelineLock = NULL;
+}
+
+void compilePipelineAsync(Pipeline pipeline)
+{
+	returnIfNot(pipeline);
+	traceCall(eTraceOp_CompilePipelineAsync, traceObject(pipeline));
+	if (!SDL_AtomicCAS(&pipeline->status, ePipelineStatus_Idle, ePipelineStatus_Pending))
+	{
+		return;
+	}
+
+	if (pipeline->bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
+	{
+		getRenderPassHandle(((struct GraphicsPipeline*)pipeline)->renderPass);
+	}
+
+	if (!CompilerThreads)
+	{
+		SDL_LockMutex(PipelineLock);
+		buildPipeline(pipeline);
+		SDL_AtomicSet(&pipeline->status, ePipelineStatus_Ready);
+		SDL_UnlockMutex(PipelineLock);
+		return;
+	}
+
+	SDL_LockMutex(PipelineLock);
+	if (PendingTail)
+	{
+		PendingTail->nextPending = pipeline;
+	}
+	else
+	{
+		PendingHead = pipeline;
+	}
+	PendingTail = pipeline;
+	SDL_CondSignal(CompilerWake);
+	SDL_UnlockMutex(PipelineLock);
+}
+
+bool isPipelineReady(Pipeline pipeline)
+{
+	return pipeline && SDL_AtomicGet(&pipeline->status) == ePipelineStatus_Ready;
 }
 
 VkPipeline getPipelineHandle(Pipeline pipeline)
 {
 	if (pipeline)
 	{
-		if (pipeline->handle == VK_NULL_HANDLE)
+		switch (SDL_AtomicGet(&pipeline->status))
 		{
-			switch (pipeline->bindPoint)
+		case ePipelineStatus_Idle:
+			// recording threads may race to build the same pipeline, PipelineLock is recursive
+			SDL_LockMutex(PipelineLock);
+			if (SDL_AtomicGet(&pipeline->status) == ePipelineStatus_Idle)
 			{
-			case VK_PIPELINE_BIND_POINT_GRAPHICS:
-				buildGraphicsPipeline((struct GraphicsPipeline*)pipeline);
-				break;
-			case VK_PIPELINE_BIND_POINT_COMPUTE:
-				buildComputePipeline((struct ComputePipeline*)pipeline);
-				break;
-			default:
-				breakIfNot(0);
+				buildPipeline(pipeline);
+				SDL_AtomicSet(&pipeline->status, ePipelineStatus_Ready);
 			}
+			SDL_UnlockMutex(PipelineLock);
+			return getPipelineHandle(pipeline);
+		case ePipelineStatus_Pending:
+			return (isPipelineReady(pipeline->fallback)) ? pipeline->fallback->handle : VK_NULL_HANDLE;
+		default:
+			return pipeline->handle;
 		}
-		return pipeline->handle;
 	}
 	return NULL;
 }
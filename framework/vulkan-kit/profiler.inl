@@ -0,0 +1,149 @@
+#pragma once
+
+#if WITH_PROFILER
+
+struct ProfileZone
+{
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+	uint32_t depth;
+};
+
+// written only by its owning thread, the capture reads entries below the published head
+struct ProfileThread
+{
+	struct ProfileZone zones[PROFILER_ZONES_PER_THREAD];
+	const char* openNames[PROFILER_MAX_DEPTH];
+	uint64_t openBegins[PROFILER_MAX_DEPTH];
+	struct ProfileThread* next;
+	SDL_atomic_t head;
+	uint32_t captureStart;
+	uint32_t depth;
+	SDL_threadID threadId;
+};
+
+static struct ProfileThread* ProfileThreads = NULL;
+static threadLocal struct ProfileThread* ProfileLocal = NULL;
+static SDL_atomic_t ProfilerCapturing;
+static uint64_t ProfilerCaptureStart = 0;
+
+static struct ProfileThread* getProfileThread(void)
+{
+	struct ProfileThread* retval = ProfileLocal;
+	if (!retval)
+	{
+		retval = calloc(1, sizeof(struct ProfileThread));
+		retvalIfNot(retval, NULL);
+		retval->threadId = SDL_ThreadID();
+		do
+		{
+			retval->next = SDL_AtomicGetPtr((void**)&ProfileThreads);
+		} while (!SDL_AtomicCASPtr((void**)&ProfileThreads, retval->next, retval));
+		ProfileLocal = retval;
+	}
+	return retval;
+}
+
+void beginProfileZone(const char* name)
+{
+	struct ProfileThread* thread = getProfileThread();
+	if (thread && thread->depth < PROFILER_MAX_DEPTH)
+	{
+		thread->openNames[thread->depth] = name;
+		thread->openBegins[thread->depth] = SDL_GetPerformanceCounter();
+	}
+	if (thread)
+	{
+		thread->depth++;
+	}
+}
+
+void endProfileZone(void)
+{
+	struct ProfileThread* thread = ProfileLocal;
+	returnIfNot(thread && thread->depth > 0);
+	const uint32_t depth = --thread->depth;
+	if (depth < PROFILER_MAX_DEPTH && SDL_AtomicGet(&ProfilerCapturing))
+	{
+		const int head = SDL_AtomicGet(&thread->head);
+		struct ProfileZone* zone = &thread->zones[(uint32_t)head % PROFILER_ZONES_PER_THREAD];
+		zone->name = thread->openNames[depth];
+		zone->begin = thread->openBegins[depth];
+		zone->end = SDL_GetPerformanceCounter();
+		zone->depth = depth;
+		SDL_AtomicSet(&thread->head, head + 1);
+	}
+}
+
+static double getProfilerTimeUs(uint64_t ticks)
+{
+	return (double)ticks * 1e6 / (double)SDL_GetPerformanceFrequency();
+}
+
+void startProfilerCapture(void)
+{
+	for (struct ProfileThread* thread = SDL_AtomicGetPtr((void**)&ProfileThreads); thread; thread = thread->next)
+	{
+		thread->captureStart = (uint32_t)SDL_AtomicGet(&thread->head);
+	}
+	ProfilerCaptureStart = SDL_GetPerformanceCounter();
+	SDL_AtomicSet(&ProfilerCapturing, 1);
+	startGpuTrace();
+}
+
+// CPU zones and GPU scopes share one timeline when the device has calibrated timestamps
+void stopProfilerCapture(const char* fileName)
+{
+	SDL_AtomicSet(&ProfilerCapturing, 0);
+	FILE* file = (fileName) ? fopen(fileName, "w") : NULL;
+	if (!file)
+	{
+		stopGpuTrace(NULL);
+		return;
+	}
+
+	const double originUs = getProfilerTimeUs(ProfilerCaptureStart);
+	fprintf(file, "{\"traceEvents\":[\n");
+	for (struct ProfileThread* thread = SDL_AtomicGetPtr((void**)&ProfileThreads); thread; thread = thread->next)
+	{
+		const uint32_t head = (uint32_t)SDL_AtomicGet(&thread->head);
+		uint32_t first = thread->captureStart;
+		if (head - first > PROFILER_ZONES_PER_THREAD)
+		{
+			// the ring wrapped during the capture, keep the newest zones
+			first = head - PROFILER_ZONES_PER_THREAD;
+		}
+		for (uint32_t i = first; i != head; i++)
+		{
+			const struct ProfileZone* zone = &thread->zones[i % PROFILER_ZONES_PER_THREAD];
+			fprintf(file, "{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}},\n",
+				zone->name, (unsigned long)thread->threadId, getProfilerTimeUs(zone->begin) - originUs, getProfilerTimeUs(zone->end - zone->begin), zone->depth);
+		}
+	}
+	writeGpuTraceEvents(file, (CalibratedTimestamps || !NumGpuTraceEvents) ? originUs : GpuTraceEvents[0].beginUs);
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}\n");
+	fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(file);
+	stopGpuTrace(NULL);
+}
+
+static void releaseProfiler(void)
+{
+	struct ProfileThread* thread = SDL_AtomicGetPtr((void**)&ProfileThreads);
+	while (thread)
+	{
+		struct ProfileThread* next = thread->next;
+		freeMem(thread);
+		thread = next;
+	}
+	ProfileThreads = NULL;
+	ProfileLocal = NULL;
+}
+
+#else
+
+#define releaseProfiler()
+
+#endif
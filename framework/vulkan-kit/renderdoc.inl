@@ -14,7 +14,7 @@ static RENDERDOC_API_1_6_0* renderDocGetAPI()
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
 		void* rdcDllHandle = SDL_LoadObject("renderdoc.dll");
 #else
-#error Not supported yet
+		void* rdcDllHandle = SDL_LoadObject("librenderdoc.so");
 #endif
 		if (rdcDllHandle)
 		{
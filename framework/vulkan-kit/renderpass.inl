@@ -54,21 +54,27 @@ RenderPass createRenderPass(uint32_t numColor, uint32_t numDepth)
 		ad->finalLayout = ar->layout;
 	}
 
+	// only the attachment stages, uses outside the pass are ordered by useImage or the caller's own barriers
+	const VkPipelineStageFlags stages = ((numColor) ? VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT : 0)
+		| ((numDepth) ? VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT : 0);
+	const VkAccessFlags writes = ((numColor) ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0) | ((numDepth) ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0);
+	const VkAccessFlags reads = ((numColor) ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0) | ((numDepth) ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT : 0);
 	retval->dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
 	retval->dependencies[0].dstSubpass = 0;
-	retval->dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-	retval->dependencies[0].dstStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
-	retval->dependencies[0].srcAccessMask = 0;
-	retval->dependencies[0].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	retval->dependencies[0].srcStageMask = stages;
+	retval->dependencies[0].dstStageMask = stages;
+	retval->dependencies[0].srcAccessMask = writes;
+	retval->dependencies[0].dstAccessMask = reads | writes;
 	retval->dependencies[0].dependencyFlags = 0;
 	retval->dependencies[1].srcSubpass = 0;
 	retval->dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-	retval->dependencies[1].srcStageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
+	retval->dependencies[1].srcStageMask = stages;
 	retval->dependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	retval->dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	retval->dependencies[1].srcAccessMask = writes;
 	retval->dependencies[1].dstAccessMask = 0;
 	retval->dependencies[1].dependencyFlags = 0;
 	
+	traceCreate(eTraceOp_CreateRenderPass, traceKey(retval), numColor, numDepth);
 	return retval;
 }
 
@@ -76,6 +82,7 @@ void setRenderPassClearColor(RenderPass renderPass, uint32_t colorTarget, const
 {
 	if (colorTarget < renderPass->numColor)
 	{
+		traceData(value, 4 * sizeof(float), eTraceOp_SetRenderPassClearColor, traceObject(renderPass), colorTarget);
 		memcpy(renderPass->clearValue[colorTarget].color.float32, value, 4 * sizeof(float));
 		renderPass->numClearValues = -1;
 	}
@@ -85,6 +92,7 @@ void setRenderPassClearDepth(RenderPass renderPass, float value)
 {
 	if (renderPass->numDepth)
 	{
+		traceData(&value, sizeof(value), eTraceOp_SetRenderPassClearDepth, traceObject(renderPass));
 		renderPass->clearValue[renderPass->numColor].depthStencil.depth = value;
 		renderPass->numClearValues = -1;
 	}
@@ -94,6 +102,7 @@ VkAttachmentDescription* getRenderPassColorTarget(RenderPass renderPass, uint32_
 {
 	if (renderPass && renderPass->numColor > colorTarget)
 	{
+		traceMapped(eTraceOp_RenderPassColorTarget, renderPass->attachment + colorTarget, sizeof(VkAttachmentDescription), traceObject(renderPass), colorTarget);
 		return (renderPass->attachment + colorTarget);
 	}
 	return NULL;
@@ -103,6 +112,7 @@ VkAttachmentDescription* getRenderPassDepthStencilTarget(RenderPass renderPass)
 {
 	if (renderPass && renderPass->numDepth)
 	{
+		traceMapped(eTraceOp_RenderPassDepthStencilTarget, renderPass->attachment + renderPass->numColor, sizeof(VkAttachmentDescription), traceObject(renderPass));
 		return (renderPass->attachment + renderPass->numColor);
 	}
 	return NULL;
@@ -169,10 +179,30 @@ VkRenderPass getRenderPassHandle(RenderPass renderPass)
 	return renderPass->handle;
 }
 
+// pipelines are shared between passes with the same description, handles get reused once a pass is destroyed
+static uint64_t hashRenderPass(RenderPass renderPass, uint64_t seed)
+{
+	const uint32_t numAttachments = renderPass->numColor + renderPass->numDepth;
+	uint64_t retval = hashBytes(&renderPass->numColor, sizeof(renderPass->numColor), seed);
+	retval = hashBytes(&renderPass->numDepth, sizeof(renderPass->numDepth), retval);
+	retval = hashBytes(renderPass->attachment, numAttachments * sizeof(VkAttachmentDescription), retval);
+	retval = hashBytes(renderPass->reference, numAttachments * sizeof(VkAttachmentReference), retval);
+	return hashBytes(renderPass->dependencies, sizeof(renderPass->dependencies), retval);
+}
+
+// after an attachment description changed, the device has to be done with the old handle
+static void resetRenderPassHandle(RenderPass renderPass)
+{
+	vkDestroyRenderPass(Device, renderPass->handle, Alloc);
+	renderPass->handle = VK_NULL_HANDLE;
+	renderPass->numClearValues = -1;
+}
+
 void destroyRenderPass(RenderPass renderPass)
 {
 	if (renderPass)
 	{
+		traceDestroy(eTraceOp_DestroyRenderPass, traceKey(renderPass));
 		vkDestroyRenderPass(Device, renderPass->handle, Alloc);
 		freeMem(renderPass->attachment);
 		freeMem(renderPass->reference);
@@ -0,0 +1,164 @@
+#pragma once
+
+#define RENDER_QUEUE_LAYERS 16
+
+struct RenderQueueItem
+{
+	uint64_t key;
+	uint32_t index;
+};
+
+struct RenderQueueT
+{
+	struct DrawPacket* packets;
+	struct RenderQueueItem* items;
+	struct RenderQueueItem* scratch;
+	void (*bindMaterial)(const void* material);
+	uint32_t numPackets;
+	uint32_t maxPackets;
+	uint32_t backToFrontLayers;
+};
+
+RenderQueue createRenderQueue(void (*bindMaterial)(const void* material))
+{
+	RenderQueue retval = calloc(1, sizeof(struct RenderQueueT));
+	retvalIfNot(retval, NULL);
+	retval->bindMaterial = bindMaterial;
+	return retval;
+}
+
+void setRenderQueueLayerOrder(RenderQueue queue, uint32_t layer, bool backToFront)
+{
+	returnIfNot(layer < RENDER_QUEUE_LAYERS);
+	if (backToFront)
+	{
+		queue->backToFrontLayers |= 1u << layer;
+	}
+	else
+	{
+		queue->backToFrontLayers &= ~(1u << layer);
+	}
+}
+
+static uint64_t getDepthSortBits(float depth)
+{
+	// positive floats order like their bit patterns, keep the top 24 bits
+	uint32_t bits = 0;
+	depth = (depth > 0.f) ? depth : 0.f;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits >> 8;
+}
+
+// layer:4 | pipeline:16 | material:20 | depth:24 for front-to-back layers
+// layer:4 | ~depth:24 | pipeline:16 | material:20 for back-to-front layers
+static uint64_t getRenderQueueKey(RenderQueue queue, const struct DrawPacket* packet)
+{
+	const uint64_t layer = packet->layer & (RENDER_QUEUE_LAYERS - 1);
+	const uint64_t pipeline = hashBytes(&packet->pipeline, sizeof(packet->pipeline), kHashSeed) & 0xFFFFu;
+	const uint64_t material = hashBytes(&packet->material, sizeof(packet->material), kHashSeed) & 0xFFFFFu;
+	const uint64_t depth = getDepthSortBits(packet->depth);
+	if (queue->backToFrontLayers & (1u << layer))
+	{
+		return (layer << 60) | ((~depth & 0xFFFFFFu) << 36) | (pipeline << 20) | material;
+	}
+	return (layer << 60) | (pipeline << 44) | (material << 24) | depth;
+}
+
+void addDrawPacket(RenderQueue queue, const struct DrawPacket* packet)
+{
+	if (queue->numPackets == queue->maxPackets)
+	{
+		queue->maxPackets = (queue->maxPackets) ? queue->maxPackets * 2 : 256;
+		safeRealloc(queue->packets, queue->maxPackets * sizeof(struct DrawPacket));
+		safeRealloc(queue->items, queue->maxPackets * sizeof(struct RenderQueueItem));
+		safeRealloc(queue->scratch, queue->maxPackets * sizeof(struct RenderQueueItem));
+	}
+	const uint32_t index = queue->numPackets++;
+	queue->packets[index] = *packet;
+	queue->items[index].key = getRenderQueueKey(queue, packet);
+	queue->items[index].index = index;
+}
+
+// stable LSD radix sort on 8 bit digits, passes where every key shares the digit are skipped
+static void sortRenderQueue(RenderQueue queue)
+{
+	const uint32_t count = queue->numPackets;
+	struct RenderQueueItem* src = queue->items;
+	struct RenderQueueItem* dst = queue->scratch;
+	for (uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		uint32_t offsets[256] = { 0 };
+		for (uint32_t i = 0; i < count; i++)
+		{
+			++offsets[(src[i].key >> shift) & 0xFFu];
+		}
+		if (offsets[(src[0].key >> shift) & 0xFFu] == count)
+		{
+			continue;
+		}
+		for (uint32_t i = 0, sum = 0; i < 256; i++)
+		{
+			const uint32_t n = offsets[i];
+			offsets[i] = sum;
+			sum += n;
+		}
+		for (uint32_t i = 0; i < count; i++)
+		{
+			dst[offsets[(src[i].key >> shift) & 0xFFu]++] = src[i];
+		}
+		struct RenderQueueItem* tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+	queue->items = src;
+	queue->scratch = dst;
+}
+
+void submitRenderQueue(RenderQueue queue)
+{
+	if (queue->numPackets == 0)
+	{
+		return;
+	}
+	sortRenderQueue(queue);
+
+	// vertex and index rebinds of the same range are dropped by the command layer
+	const struct DrawPacket* last = NULL;
+	for (uint32_t i = 0; i < queue->numPackets; i++)
+	{
+		const struct DrawPacket* packet = &queue->packets[queue->items[i].index];
+		if (!last || packet->pipeline != last->pipeline)
+		{
+			bindGraphicsPipeline(packet->pipeline);
+		}
+		if (queue->bindMaterial && (!last || packet->material != last->material))
+		{
+			queue->bindMaterial(packet->material);
+		}
+		for (uint32_t j = 0; j < MAX_VERTEX_BUFFERS; j++)
+		{
+			if (packet->vertexBuffers[j])
+			{
+				bindVertexBufferRange(j, packet->vertexBuffers[j], packet->vertexOffsets[j]);
+			}
+		}
+		if (packet->indexBuffer)
+		{
+			bindIndexBufferRange(packet->indexType, packet->indexBuffer, packet->indexOffset);
+		}
+		drawIndexed(packet->numIndices, packet->numInstances, packet->firstIndex, packet->firstVertex, packet->firstInstance);
+		last = packet;
+	}
+	queue->numPackets = 0;
+}
+
+void destroyRenderQueue(RenderQueue queue)
+{
+	if (queue)
+	{
+		freeMem(queue->packets);
+		freeMem(queue->items);
+		freeMem(queue->scratch);
+		freeMem(queue);
+	}
+}
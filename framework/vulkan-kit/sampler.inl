@@ -13,11 +13,14 @@ SamplerState createSamplerState(VkFilter minMag, VkSamplerMipmapMode mipMode, Vk
 	};
 	VkSampler retval = VK_NULL_HANDLE;
 	breakIfFailed(vkCreateSampler(Device, &sci, Alloc, &retval));
+	traceCreate(eTraceOp_CreateSamplerState, traceKey(retval), minMag, mipMode, addressMode);
 	return retval;
 }
 
 void destroySamplerState(SamplerState sampler)
 {
+	traceDestroy(eTraceOp_DestroySamplerState, traceKey(sampler));
 	vkDestroySampler(Device, sampler, Alloc);
+	SDL_AtomicIncRef(&ResourceGeneration);
 }
 
@@ -4,6 +4,27 @@
 #include <shaderc/shaderc.h>
 #include <spirv_cross/spirv_cross_c.h>
 
+#ifdef _WIN32
+#include <direct.h>
+#define makeDirectory(path) _mkdir(path)
+#else
+#define makeDirectory(path) mkdir(path, 0755)
+#endif
+
+#define SHADER_CACHE_MAGIC 0x534b4b56u
+#define SHADER_CACHE_VERSION 2u
+
+struct ShaderCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t numAttrs;
+	uint32_t codeBytes;
+};
+
+static shaderc_compiler_t ShaderCompiler = NULL;
+
 static shaderc_compile_options_t createCompilerOptions(VkShaderStageFlags stage)
 {
 	shaderc_compile_options_t retval = shaderc_compile_options_initialize();
@@ -29,38 +50,38 @@ static shaderc_compile_options_t createCompilerOptions(VkShaderStageFlags stage)
 	return retval;
 }
 
-static char* loadFromFile(const char* fileName, size_t* size)
+static char* readFile(FILE* file, size_t* size)
 {
 	char* retval = NULL;
-	FILE* file = fopen(fileName, "rb");
-	breakIfNot(file);
-	if (file)
+	struct stat fileStat = { 0 };
+	if (fstat(_fileno(file), &fileStat) == 0)
 	{
-		struct stat fileStat = { 0 };
-		if (fstat(_fileno(file), &fileStat) == 0)
+		size_t bytes = fileStat.st_size;
+		retval = malloc(bytes);
+		if (retval)
 		{
-			size_t bytes = fileStat.st_size;
-			retval = malloc(bytes);
-			if (retval)
+			size_t bytesRead = fread(retval, sizeof(char), bytes, file);
+			if (bytesRead != bytes)
 			{
-				size_t bytesRead = fread(retval, sizeof(char), bytes, file);
-				if (bytesRead != bytes)
-				{
-					freeMem(retval);
-				}
-				*size = bytes;
+				freeMem(retval);
 			}
+			*size = bytes;
 		}
-		fclose(file);
 	}
+	fclose(file);
 	return retval;
 }
 
-static shaderc_compilation_result_t compileShaderSource(shaderc_compiler_t compiler, const char* fileName, VkShaderStageFlags stage)
+static char* loadFromFile(const char* fileName, size_t* size)
+{
+	FILE* file = fopen(fileName, "rb");
+	breakIfNot(file);
+	return (file) ? readFile(file, size) : NULL;
+}
+
+static shaderc_compilation_result_t compileShaderSource(shaderc_compiler_t compiler, const char* fileName, const char* src, size_t srcBytes, VkShaderStageFlags stage)
 {
-	size_t srcBytes = 0;
 	shaderc_shader_kind kind = 0;
-	char* src = loadFromFile(fileName, &srcBytes);
 	switch (stage)
 	{
 	case VK_SHADER_STAGE_FRAGMENT_BIT:
@@ -74,7 +95,9 @@ static shaderc_compilation_result_t compileShaderSource(shaderc_compiler_t compi
 		break;
 	}
 	shaderc_compile_options_t options = createCompilerOptions(stage);
+	profileBegin("compileShader");
 	shaderc_compilation_result_t res = shaderc_compile_into_spv(compiler, src, srcBytes, kind, fileName, kShaderMain, options);
+	profileEnd();
 	shaderc_compilation_status sts = shaderc_result_get_compilation_status(res);
 	shaderc_compile_options_release(options);
 	if (sts != shaderc_compilation_status_success)
@@ -82,7 +105,6 @@ static shaderc_compilation_result_t compileShaderSource(shaderc_compiler_t compi
 		debugPrint("%s\n", shaderc_result_get_error_message(res));
 		breakIfNot(0);
 	}
-	freeMem(src);
 	return res;
 }
 
@@ -98,7 +120,31 @@ static VkShaderModule makeShaderModule(const uint32_t* code, size_t size)
 	return retval;
 }
 
-static void getVertexAttributes(const uint32_t* code, size_t numWords, VkVertexInputAttributeDescription** attrs, uint32_t* count, uint32_t* stride)
+static VkFormat getVertexInputFormat(spvc_basetype baseType, uint32_t vectorSize)
+{
+	static const VkFormat kFloatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+	static const VkFormat kIntFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+	static const VkFormat kUintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+	if (vectorSize >= 1 && vectorSize <= 4)
+	{
+		switch (baseType)
+		{
+		case SPVC_BASETYPE_FP32:
+			return kFloatFormats[vectorSize - 1];
+		case SPVC_BASETYPE_INT32:
+			return kIntFormats[vectorSize - 1];
+		case SPVC_BASETYPE_UINT32:
+			return kUintFormats[vectorSize - 1];
+		default:
+			break;
+		}
+	}
+	breakIfNot(0);
+	return VK_FORMAT_UNDEFINED;
+}
+
+// inputs named instance_* are fetched from binding 1, matrices take one location per column
+static void getVertexAttributes(const uint32_t* code, size_t numWords, VkVertexInputAttributeDescription** attrs, uint32_t* count)
 {
 	spvc_context context = NULL;
 	spvc_compiler compiler = NULL;
@@ -114,8 +160,14 @@ static void getVertexAttributes(const uint32_t* code, size_t numWords, VkVertexI
 	const spvc_reflected_resource* stageInputs = NULL;
 	breakIfNot(spvc_resources_get_resource_list_for_type(resources, SPVC_RESOURCE_TYPE_STAGE_INPUT, &stageInputs, &numStageInputs) == SPVC_SUCCESS);
 
-	uint32_t numItems = 0, byteStride = 0;
-	VkVertexInputAttributeDescription* items = calloc(numStageInputs, sizeof(VkVertexInputAttributeDescription));
+	uint32_t numItems = 0, maxItems = 0;
+	for (size_t i = 0; i < numStageInputs; i++)
+	{
+		const spvc_type valueType = spvc_compiler_get_type_handle(compiler, stageInputs[i].type_id);
+		const uint32_t numColumns = spvc_type_get_columns(valueType);
+		maxItems += (numColumns) ? numColumns : 1;
+	}
+	VkVertexInputAttributeDescription* items = calloc(maxItems, sizeof(VkVertexInputAttributeDescription));
 	if (!items)
 	{
 		spvc_context_destroy(context);
@@ -126,60 +178,162 @@ static void getVertexAttributes(const uint32_t* code, size_t numWords, VkVertexI
 	{
 		const uint32_t location = spvc_compiler_get_decoration(compiler, stageInputs[i].id, SpvDecorationLocation);
 		const spvc_type valueType = spvc_compiler_get_type_handle(compiler, stageInputs[i].type_id);
-		const spvc_basetype baseType = spvc_type_get_basetype(valueType);
-		const uint32_t vectorSize = spvc_type_get_vector_size(valueType);
-
-		VkVertexInputAttributeDescription* desc = items + (numItems++);
-		desc->location = location;
-		desc->binding = 0;
-		desc->offset = byteStride;
-		switch (baseType)
+		const VkFormat format = getVertexInputFormat(spvc_type_get_basetype(valueType), spvc_type_get_vector_size(valueType));
+		const uint32_t numColumns = spvc_type_get_columns(valueType);
+		const char* name = spvc_compiler_get_name(compiler, stageInputs[i].id);
+		const uint32_t binding = (name && strncmp(name, kInstanceInputPrefix, sizeof(kInstanceInputPrefix) - 1) == 0) ? 1 : 0;
+		for (uint32_t column = 0; column < ((numColumns) ? numColumns : 1); column++)
 		{
-		case SPVC_BASETYPE_FP32:
-			switch (vectorSize)
+			// keep locations sorted, offsets are laid out per binding in that order
+			uint32_t index = numItems++;
+			while (index > 0 && items[index - 1].location > location + column)
 			{
-			case 1:
-				desc->format = VK_FORMAT_R32_SFLOAT;
-				byteStride += 4;
-				break;
-			case 2:
-				desc->format = VK_FORMAT_R32G32_SFLOAT;
-				byteStride += 8;
-				break;
-			case 3:
-				desc->format = VK_FORMAT_R32G32B32_SFLOAT;
-				byteStride += 12;
-				break;
-			case 4:
-				desc->format = VK_FORMAT_R32G32B32A32_SFLOAT;
-				byteStride += 16;
-				break;
-			default:
-				break;
+				items[index] = items[index - 1];
+				--index;
 			}
-			break;
-		default:
-			breakIfNot(0);
-			break;
+			items[index].location = location + column;
+			items[index].binding = binding;
+			items[index].format = format;
+			items[index].offset = 0;
 		}
 	}
 
 	spvc_context_destroy(context);
-	*stride = byteStride;
 	*count = numItems;
 	*attrs = items;
 }
 
-VkShaderModule compileShader(VkShaderStageFlags stage, const char* fileName, VkVertexInputAttributeDescription** attrs, uint32_t* count, uint32_t* stride)
+static uint64_t getShaderCacheKey(const char* src, size_t srcBytes, VkShaderStageFlags stage)
+{
+	unsigned int spvVersion = 0, spvRevision = 0;
+	shaderc_get_spv_version(&spvVersion, &spvRevision);
+	const uint32_t version[] = { SHADER_CACHE_VERSION, spvVersion, spvRevision, stage };
+	uint64_t retval = hashBytes(version, sizeof(version), kHashSeed);
+	for (uint32_t i = 0; i < NumShaderMacros; i++)
+	{
+		const struct ShaderMacro* sm = ShaderMacros + i;
+		retval = hashBytes(sm->name, sm->nameLength, retval);
+		retval = hashBytes(sm->val, sm->valLength + 1, retval);
+	}
+	return hashBytes(src, srcBytes, retval);
+}
+
+static void getShaderCachePath(uint64_t key, char* path, size_t size)
+{
+	snprintf(path, size, "%s/%016llx.spv", ShaderCacheDir, (unsigned long long)key);
+}
+
+static struct ShaderCacheHeader* loadShaderBinary(uint64_t key)
 {
-	shaderc_compiler_t compiler = shaderc_compiler_initialize();
-	shaderc_compilation_result_t res = compileShaderSource(compiler, fileName, stage);
+	char path[512];
+	size_t bytes = 0;
+	getShaderCachePath(key, path, sizeof(path));
+	FILE* file = fopen(path, "rb");
+	if (!file)
+	{
+		return NULL;
+	}
+
+	struct ShaderCacheHeader* retval = (struct ShaderCacheHeader*)readFile(file, &bytes);
+	if (retval)
+	{
+		const size_t attrBytes = (bytes < sizeof(struct ShaderCacheHeader)) ? 0 : retval->numAttrs * sizeof(VkVertexInputAttributeDescription);
+		if (bytes < sizeof(struct ShaderCacheHeader)
+			|| retval->magic != SHADER_CACHE_MAGIC
+			|| retval->version != SHADER_CACHE_VERSION
+			|| retval->key != key
+			|| bytes != sizeof(struct ShaderCacheHeader) + attrBytes + retval->codeBytes)
+		{
+			freeMem(retval);
+		}
+	}
+	return retval;
+}
+
+static void storeShaderBinary(const struct ShaderCacheHeader* header, const VkVertexInputAttributeDescription* attrs, const void* code)
+{
+	char path[512];
+	char tempPath[544];
+	makeDirectory(ShaderCacheDir);
+	getShaderCachePath(header->key, path, sizeof(path));
+
+	// readers only ever see complete binaries, a failed rename means another writer got there first
+	snprintf(tempPath, sizeof(tempPath), "%s.%lx.tmp", path, SDL_ThreadID());
+	FILE* file = fopen(tempPath, "wb");
+	if (file)
+	{
+		bool written = fwrite(header, sizeof(struct ShaderCacheHeader), 1, file) == 1;
+		written = written && (!header->numAttrs || fwrite(attrs, sizeof(VkVertexInputAttributeDescription), header->numAttrs, file) == header->numAttrs);
+		written = written && fwrite(code, 1, header->codeBytes, file) == header->codeBytes;
+		written = (fclose(file) == 0) && written;
+		if (!written || rename(tempPath, path) != 0)
+		{
+			remove(tempPath);
+		}
+	}
+}
+
+static void releaseShaderCompiler(void)
+{
+	if (ShaderCompiler)
+	{
+		shaderc_compiler_release(ShaderCompiler);
+		ShaderCompiler = NULL;
+	}
+}
+
+VkShaderModule compileShader(VkShaderStageFlags stage, const char* fileName, uint64_t* shaderKey, VkVertexInputAttributeDescription** attrs, uint32_t* count)
+{
+	size_t srcBytes = 0;
+	char* src = loadFromFile(fileName, &srcBytes);
+	retvalIfNot(src, VK_NULL_HANDLE);
+
+	const uint64_t key = getShaderCacheKey(src, srcBytes, stage);
+	*shaderKey = hashBytes(&key, sizeof(key), *shaderKey);
+	struct ShaderCacheHeader* cached = (ShaderCacheDir) ? loadShaderBinary(key) : NULL;
+	if (cached)
+	{
+		const VkVertexInputAttributeDescription* cachedAttrs = (const VkVertexInputAttributeDescription*)(cached + 1);
+		const uint32_t* code = (const uint32_t*)(cachedAttrs + cached->numAttrs);
+		VkShaderModule retval = makeShaderModule(code, cached->codeBytes);
+		if (stage == VK_SHADER_STAGE_VERTEX_BIT)
+		{
+			*attrs = calloc(cached->numAttrs, sizeof(VkVertexInputAttributeDescription));
+			breakIfNot(*attrs || !cached->numAttrs);
+			if (*attrs && cached->numAttrs)
+			{
+				memcpy(*attrs, cachedAttrs, cached->numAttrs * sizeof(VkVertexInputAttributeDescription));
+			}
+			*count = cached->numAttrs;
+		}
+		freeMem(cached);
+		freeMem(src);
+		return retval;
+	}
+
+	if (!ShaderCompiler)
+	{
+		ShaderCompiler = shaderc_compiler_initialize();
+	}
+	shaderc_compilation_result_t res = compileShaderSource(ShaderCompiler, fileName, src, srcBytes, stage);
 	const uint32_t* code = (const uint32_t*)shaderc_result_get_bytes(res);
 	VkShaderModule retval = makeShaderModule(code, shaderc_result_get_length(res));
+	struct ShaderCacheHeader header = {
+		.magic = SHADER_CACHE_MAGIC,
+		.version = SHADER_CACHE_VERSION,
+		.key = key,
+		.codeBytes = (uint32_t)shaderc_result_get_length(res)
+	};
 	if (stage == VK_SHADER_STAGE_VERTEX_BIT)
 	{
-		getVertexAttributes(code, shaderc_result_get_length(res) >> 2, attrs, count, stride);
+		getVertexAttributes(code, shaderc_result_get_length(res) >> 2, attrs, count);
+		header.numAttrs = *count;
 	}
-	shaderc_compiler_release(compiler);
+	if (ShaderCacheDir && retval != VK_NULL_HANDLE)
+	{
+		storeShaderBinary(&header, (attrs) ? *attrs : NULL, code);
+	}
+	shaderc_result_release(res);
+	freeMem(src);
 	return retval;
 }
@@ -0,0 +1,141 @@
+#pragma once
+
+static void* allocateStagingData(struct DeviceQueueContext* queueContext, size_t bytes, VkBuffer* buffer, VkDeviceSize* offset)
+{
+	Buffer ring = queueContext->stagingRing;
+	const uint64_t size = (ring) ? ring->size : 0;
+	const uint64_t alignment = (DeviceProperties.limits.optimalBufferCopyOffsetAlignment > 16) ? DeviceProperties.limits.optimalBufferCopyOffsetAlignment : 16;
+	uint64_t head = (queueContext->stagingHead + alignment - 1) & ~(alignment - 1);
+	if (size && (head % size) + bytes > size)
+	{
+		head = (head / size + 1) * size;
+	}
+	if (size && bytes <= size && head + bytes - queueContext->stagingTail <= size)
+	{
+		queueContext->stagingHead = head + bytes;
+		*buffer = getBufferHandle(ring);
+		*offset = head % size;
+		return (uint8_t*)getBufferMappedPtr(ring) + *offset;
+	}
+
+	// oversized or ring exhausted, use a one-off buffer released with this command buffer's fence
+	struct StagingFrame* frame = &queueContext->cbStaging[queueContext->currentIndex];
+	Buffer temp = createBuffer(bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, eDeviceQueue_Invalid, true);
+	retvalIfNot(temp, NULL);
+	safeRealloc(frame->tempBuffers, (frame->numTempBuffers + 1) * sizeof(Buffer));
+	frame->tempBuffers[frame->numTempBuffers++] = temp;
+	*buffer = getBufferHandle(temp);
+	*offset = 0;
+	return getBufferMappedPtr(temp);
+}
+
+static bool pendingCopiesOverlap(const struct PendingCopy* a, const struct PendingCopy* b)
+{
+	if (a->dstImage != VK_NULL_HANDLE)
+	{
+		// uploads always cover a whole mip
+		return a->imageRegion.imageSubresource.mipLevel == b->imageRegion.imageSubresource.mipLevel;
+	}
+	return a->bufferRegion.dstOffset < b->bufferRegion.dstOffset + b->bufferRegion.size
+		&& b->bufferRegion.dstOffset < a->bufferRegion.dstOffset + a->bufferRegion.size;
+}
+
+// copies into one destination merge while their regions are disjoint, anything else keeps submission order
+static void flushPendingCopies(struct DeviceQueueContext* queueContext)
+{
+	flushResourceBarriers(queueContext);
+	VkBufferCopy bufferRegions[MAX_PENDING_COPIES];
+	VkBufferImageCopy imageRegions[MAX_PENDING_COPIES];
+	for (uint32_t i = 0; i < queueContext->numPendingCopies; i++)
+	{
+		const struct PendingCopy* copy = &queueContext->pendingCopies[i];
+		if (copy->src == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		uint32_t merged[MAX_PENDING_COPIES];
+		uint32_t numRegions = 0;
+		for (uint32_t j = i; j < queueContext->numPendingCopies; j++)
+		{
+			struct PendingCopy* other = &queueContext->pendingCopies[j];
+			if (other->src == VK_NULL_HANDLE || other->dstBuffer != copy->dstBuffer || other->dstImage != copy->dstImage)
+			{
+				continue;
+			}
+
+			bool disjoint = (other->src == copy->src);
+			for (uint32_t k = 0; disjoint && k < numRegions; k++)
+			{
+				disjoint = !pendingCopiesOverlap(&queueContext->pendingCopies[merged[k]], other);
+			}
+			if (!disjoint)
+			{
+				break;
+			}
+			merged[numRegions] = j;
+			bufferRegions[numRegions] = other->bufferRegion;
+			imageRegions[numRegions] = other->imageRegion;
+			++numRegions;
+		}
+		for (uint32_t k = 1; k < numRegions; k++)
+		{
+			queueContext->pendingCopies[merged[k]].src = VK_NULL_HANDLE;
+		}
+
+		if (copy->dstImage != VK_NULL_HANDLE)
+		{
+			vkCmdCopyBufferToImage(queueContext->cmdBuffer, copy->src, copy->dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, numRegions, imageRegions);
+		}
+		else
+		{
+			vkCmdCopyBuffer(queueContext->cmdBuffer, copy->src, copy->dstBuffer, numRegions, bufferRegions);
+		}
+	}
+	queueContext->numPendingCopies = 0;
+}
+
+static struct PendingCopy* addPendingCopy(struct DeviceQueueContext* queueContext)
+{
+	if (queueContext->numPendingCopies == MAX_PENDING_COPIES)
+	{
+		flushPendingCopies(queueContext);
+	}
+	struct PendingCopy* copy = &queueContext->pendingCopies[queueContext->numPendingCopies++];
+	memset(copy, 0, sizeof(struct PendingCopy));
+	return copy;
+}
+
+static void endStagingFrame(struct DeviceQueueContext* queueContext, uint32_t index)
+{
+	queueContext->cbStaging[index].ringEnd = queueContext->stagingHead;
+}
+
+static void reclaimStagingFrame(struct DeviceQueueContext* queueContext, uint32_t index)
+{
+	struct StagingFrame* frame = &queueContext->cbStaging[index];
+	if (frame->ringEnd > queueContext->stagingTail)
+	{
+		queueContext->stagingTail = frame->ringEnd;
+	}
+	for (uint32_t i = 0; i < frame->numTempBuffers; i++)
+	{
+		releaseBuffer(frame->tempBuffers[i]);
+	}
+	frame->numTempBuffers = 0;
+}
+
+static void releaseStaging(struct DeviceQueueContext* queueContext)
+{
+	for (uint32_t i = 0; i < queueContext->numCommandBuffers; i++)
+	{
+		reclaimStagingFrame(queueContext, i);
+		freeMem(queueContext->cbStaging[i].tempBuffers);
+	}
+	freeMem(queueContext->cbStaging);
+	if (queueContext->stagingRing)
+	{
+		releaseBuffer(queueContext->stagingRing);
+		queueContext->stagingRing = NULL;
+	}
+}
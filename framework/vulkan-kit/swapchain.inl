@@ -1,6 +1,51 @@
 #pragma once
 
-void resetSwapchain(void)
+static void resetHeadlessSwapchain(void)
+{
+	if (SwapchainImages != NULL)
+	{
+		deviceWaitIdle();
+		destroySwapchain(true);
+	}
+
+	breakIfNot(SwapchainColorTarget != VK_FORMAT_UNDEFINED);
+	if (PresentQueue != eDeviceQueue_Invalid && SwapchainLength < QueueContext[PresentQueue].numCommandBuffers)
+	{
+		SwapchainLength = QueueContext[PresentQueue].numCommandBuffers;
+	}
+	SwapchainLength = (SwapchainLength) ? SwapchainLength : 1;
+
+	const VkExtent3D extent = { HeadlessExtent.width, HeadlessExtent.height, 1 };
+
+	if (SwapchainDepthBuffer != VK_FORMAT_UNDEFINED)
+	{
+		SwapchainDepthImage = createRenderTargetImage(SwapchainDepthBuffer, &extent);
+	}
+
+	safeRealloc(SwapchainImages, SwapchainLength * sizeof(struct ImageT));
+	safeRealloc(SwapchainFramebuffers, SwapchainLength * sizeof(Framebuffer));
+	for (uint32_t i = 0; i < SwapchainLength; i++)
+	{
+		VkImageCreateInfo ici = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+			.imageType = VK_IMAGE_TYPE_2D,
+			.format = SwapchainColorTarget,
+			.extent = extent,
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.tiling = VK_IMAGE_TILING_OPTIMAL,
+			.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+		};
+		breakIfFailed(vkCreateImage(Device, &ici, Alloc, &SwapchainImages[i].handle));
+		initImage(&SwapchainImages[i], SwapchainColorTarget, &extent, 1, false, true);
+		Image renderTargets[] = { &SwapchainImages[i], SwapchainDepthImage };
+		*(SwapchainFramebuffers + i) = createFramebuffer(SwapchainRenderPass, renderTargets);
+	}
+	SwapchainCurrentIndex = 0;
+}
+
+static void resetSurfaceSwapchain(void)
 {
 	if (Swapchain != VK_NULL_HANDLE)
 	{
@@ -94,12 +139,33 @@ void resetSwapchain(void)
 	breakIfFailed(vkCreateSemaphore(Device, &ci, Alloc, &SwapchainNextSemaphore));
 }
 
+// swapchain objects are the replayer's own, a trace only refers to them
+void resetSwapchain(void)
+{
+	traceSuspend();
+	if (Surface == VK_NULL_HANDLE)
+	{
+		resetHeadlessSwapchain();
+	}
+	else
+	{
+		resetSurfaceSwapchain();
+	}
+	traceResume();
+}
+
 Framebuffer getSwapchainFramebuffer(void)
 {
-	if (!SwapchainCurrentImage)
+	if (!SwapchainCurrentImage && Swapchain == VK_NULL_HANDLE)
+	{
+		SwapchainCurrentImage = &SwapchainImages[SwapchainCurrentIndex];
+	}
+	else if (!SwapchainCurrentImage)
 	{
 		VkSemaphore semaphore = SwapchainNextSemaphore;
+		profileBegin("vkAcquireNextImageKHR");
 		VkResult result = vkAcquireNextImageKHR(Device, Swapchain, UINT64_MAX, semaphore, VK_NULL_HANDLE, &SwapchainCurrentIndex);
+		profileEnd();
 		if (result == VK_ERROR_OUT_OF_DATE_KHR)
 		{
 			return NULL;
@@ -118,6 +184,15 @@ Framebuffer getSwapchainFramebuffer(void)
 
 void presentImageToWindow(void)
 {
+	traceCall(eTraceOp_PresentImageToWindow);
+	if (Swapchain == VK_NULL_HANDLE)
+	{
+		SwapchainCurrentIndex = (SwapchainCurrentIndex + 1) % SwapchainLength;
+		SwapchainUpdateSubmit = NULL;
+		SwapchainCurrentImage = NULL;
+		return;
+	}
+
 	uint32_t waitCount = (SwapchainUpdateSubmit) ? 1 : 0;
 	VkPresentInfoKHR pi = {
 		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR, 
@@ -127,8 +202,13 @@ void presentImageToWindow(void)
 		.pSwapchains = &Swapchain,
 		.pImageIndices = &SwapchainCurrentIndex
 	};
-	VkQueue queueHandle = QueueContext[PresentQueue].queueHandle;
-	VkResult result = vkQueuePresentKHR(queueHandle, &pi);
+	const struct DeviceQueueContext* queueContext = &QueueContext[PresentQueue];
+	SDL_mutex* lock = QueueContext[queueContext->queueOwner].queueLock;
+	profileBegin("vkQueuePresentKHR");
+	SDL_LockMutex(lock);
+	VkResult result = vkQueuePresentKHR(queueContext->queueHandle, &pi);
+	SDL_UnlockMutex(lock);
+	profileEnd();
 	if (result != VK_SUCCESS && result != VK_ERROR_OUT_OF_DATE_KHR)
 	{
 		breakIfFailed(result);
@@ -141,7 +221,15 @@ void destroySwapchain(bool reset)
 {
 	for (uint32_t i = 0; i < SwapchainLength; i++)
 	{
-		vkDestroySemaphore(Device, SwapchainSemaphores[i], Alloc);
+		if (Swapchain != VK_NULL_HANDLE)
+		{
+			vkDestroySemaphore(Device, SwapchainSemaphores[i], Alloc);
+		}
+		else
+		{
+			vkDestroyImage(Device, SwapchainImages[i].handle, Alloc);
+			freeDeviceMemory(&SwapchainImages[i].memory);
+		}
 		vkDestroyImageView(Device, SwapchainImages[i].view, Alloc);
 		destroyFramebuffer(SwapchainFramebuffers[i]);
 	}
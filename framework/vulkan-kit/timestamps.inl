@@ -0,0 +1,242 @@
+#pragma once
+
+struct GpuTraceEvent
+{
+	const char* name;
+	double beginUs;
+	double durationUs;
+	DeviceQueue queue;
+	uint32_t depth;
+};
+
+static struct GpuTraceEvent* GpuTraceEvents = NULL;
+static uint32_t NumGpuTraceEvents = 0;
+static uint32_t MaxGpuTraceEvents = 0;
+static bool GpuTraceActive = false;
+
+static void createTimestampQueries(struct DeviceQueueContext* queueContext)
+{
+	uint32_t numFamilies = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &numFamilies, NULL);
+	VkQueueFamilyProperties* families = calloc(numFamilies, sizeof(VkQueueFamilyProperties));
+	returnIfNot(families);
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &numFamilies, families);
+	const uint32_t validBits = families[queueContext->queueFamily].timestampValidBits;
+	freeMem(families);
+	if (validBits == 0)
+	{
+		return;
+	}
+
+	queueContext->timestampMask = (validBits >= 64) ? ~0ull : (1ull << validBits) - 1;
+	queueContext->cbTimestamps = calloc(queueContext->numCommandBuffers, sizeof(struct TimestampFrame));
+	breakIfNot(queueContext->cbTimestamps);
+	VkQueryPoolCreateInfo qpci = {
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = 2 * MAX_TIMESTAMP_SCOPES
+	};
+	for (uint32_t i = 0; queueContext->cbTimestamps && i < queueContext->numCommandBuffers; i++)
+	{
+		breakIfFailed(vkCreateQueryPool(Device, &qpci, Alloc, &queueContext->cbTimestamps[i].pool));
+	}
+}
+
+static bool findHostTimeDomain(void)
+{
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+	HostTimeDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+	HostTimeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_RAW_EXT;
+#endif
+	bool device = false, host = false;
+	uint32_t numDomains = 0;
+	VkTimeDomainEXT domains[8];
+	breakIfFailed(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(PhysicalDevice, &numDomains, NULL));
+	numDomains = (numDomains < _countof(domains)) ? numDomains : _countof(domains);
+	vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(PhysicalDevice, &numDomains, domains);
+	for (uint32_t i = 0; i < numDomains; i++)
+	{
+		device |= (domains[i] == VK_TIME_DOMAIN_DEVICE_EXT);
+		host |= (domains[i] == HostTimeDomain);
+	}
+	return device && host;
+}
+
+// offset that maps device timestamps onto the host clock sampled by SDL_GetPerformanceCounter
+static double getGpuClockOffsetUs(uint64_t mask)
+{
+	const VkCalibratedTimestampInfoEXT infos[] = {
+		{.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT, .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT },
+		{.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT, .timeDomain = HostTimeDomain }
+	};
+	uint64_t values[2] = { 0 }, deviation = 0;
+	retvalIfFailed(vkGetCalibratedTimestampsEXT(Device, _countof(infos), infos, values, &deviation), 0.0);
+	const double hostUs = (HostTimeDomain == VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT)
+		? (double)values[1] * 1e6 / (double)SDL_GetPerformanceFrequency()
+		: (double)values[1] * 1e-3;
+	return hostUs - (double)(values[0] & mask) * (double)DeviceProperties.limits.timestampPeriod * 1e-3;
+}
+
+static void releaseTimestampQueries(struct DeviceQueueContext* queueContext)
+{
+	for (uint32_t i = 0; queueContext->cbTimestamps && i < queueContext->numCommandBuffers; i++)
+	{
+		vkDestroyQueryPool(Device, queueContext->cbTimestamps[i].pool, Alloc);
+	}
+	freeMem(queueContext->cbTimestamps);
+}
+
+static void addGpuTraceEvent(const struct GpuTiming* timing, double beginUs)
+{
+	if (NumGpuTraceEvents == MaxGpuTraceEvents)
+	{
+		MaxGpuTraceEvents = (MaxGpuTraceEvents) ? MaxGpuTraceEvents * 2 : 1024;
+		safeRealloc(GpuTraceEvents, MaxGpuTraceEvents * sizeof(struct GpuTraceEvent));
+	}
+	struct GpuTraceEvent* event = &GpuTraceEvents[NumGpuTraceEvents++];
+	event->name = timing->name;
+	event->beginUs = beginUs;
+	event->durationUs = timing->durationMs * 1000.0;
+	event->queue = timing->queue;
+	event->depth = timing->depth;
+}
+
+// called once the slot's fence has signaled, so the results are final and never wait
+static void resolveTimestampFrame(struct DeviceQueueContext* queueContext, uint32_t index)
+{
+	struct TimestampFrame* frame = &queueContext->cbTimestamps[index];
+	queueContext->numTimings = 0;
+	if (frame->numScopes == 0)
+	{
+		return;
+	}
+
+	// value and availability for each query
+	uint64_t results[4 * MAX_TIMESTAMP_SCOPES];
+	const VkResult result = vkGetQueryPoolResults(Device, frame->pool, 0, 2 * frame->numScopes, sizeof(results), results, 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	returnIfNot(result == VK_SUCCESS || result == VK_NOT_READY);
+
+	const uint64_t mask = queueContext->timestampMask;
+	const double nsPerTick = (double)DeviceProperties.limits.timestampPeriod;
+	const double offsetUs = (GpuTraceActive && CalibratedTimestamps) ? getGpuClockOffsetUs(mask) : 0.0;
+	uint64_t origin = 0;
+	for (uint32_t i = 0; i < frame->numScopes; i++)
+	{
+		const uint64_t* begin = results + 4 * i;
+		const uint64_t* end = begin + 2;
+		if (!begin[1] || !end[1])
+		{
+			// left open or recorded where timestamps are not allowed
+			continue;
+		}
+		const uint64_t beginTicks = begin[0] & mask;
+		if (queueContext->numTimings == 0)
+		{
+			origin = beginTicks;
+		}
+		struct GpuTiming* timing = &queueContext->timings[queueContext->numTimings++];
+		timing->name = frame->names[i];
+		timing->beginMs = (double)((beginTicks - origin) & mask) * nsPerTick * 1e-6;
+		timing->durationMs = (double)(((end[0] & mask) - beginTicks) & mask) * nsPerTick * 1e-6;
+		timing->queue = (DeviceQueue)(queueContext - QueueContext);
+		timing->depth = frame->depths[i];
+		if (GpuTraceActive)
+		{
+			addGpuTraceEvent(timing, (double)beginTicks * nsPerTick * 1e-3 + offsetUs);
+		}
+	}
+}
+
+static void resetTimestampFrame(struct DeviceQueueContext* queueContext, uint32_t index, VkCommandBuffer cmdBuffer)
+{
+	struct TimestampFrame* frame = &queueContext->cbTimestamps[index];
+	vkCmdResetQueryPool(cmdBuffer, frame->pool, 0, 2 * MAX_TIMESTAMP_SCOPES);
+	frame->numScopes = 0;
+	queueContext->numOpenScopes = 0;
+}
+
+// scopes are written to the primary only, names must outlive the frame
+void beginGpuScope(const char* name)
+{
+	traceData(name, (name) ? strlen(name) + 1 : 0, eTraceOp_BeginGpuScope);
+	returnIfNot(ActiveQueue != eDeviceQueue_Invalid);
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	if (!queueContext->cbTimestamps || Recorder != &queueContext->recorder)
+	{
+		return;
+	}
+	struct TimestampFrame* frame = &queueContext->cbTimestamps[queueContext->currentIndex];
+	returnIfNot(frame->numScopes < MAX_TIMESTAMP_SCOPES);
+	const uint32_t scope = frame->numScopes++;
+	frame->names[scope] = name;
+	frame->depths[scope] = queueContext->numOpenScopes;
+	queueContext->openScopes[queueContext->numOpenScopes++] = scope;
+	if (!queueContext->parallelPass)
+	{
+		vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame->pool, 2 * scope);
+	}
+}
+
+void endGpuScope(void)
+{
+	traceCall(eTraceOp_EndGpuScope);
+	returnIfNot(ActiveQueue != eDeviceQueue_Invalid);
+	struct DeviceQueueContext* queueContext = &QueueContext[ActiveQueue];
+	if (!queueContext->cbTimestamps || Recorder != &queueContext->recorder)
+	{
+		return;
+	}
+	returnIfNot(queueContext->numOpenScopes > 0);
+	struct TimestampFrame* frame = &queueContext->cbTimestamps[queueContext->currentIndex];
+	const uint32_t scope = queueContext->openScopes[--queueContext->numOpenScopes];
+	if (!queueContext->parallelPass)
+	{
+		vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame->pool, 2 * scope + 1);
+	}
+}
+
+uint32_t getGpuTimings(DeviceQueue queue, struct GpuTiming* timings, uint32_t maxTimings)
+{
+	const struct DeviceQueueContext* queueContext = &QueueContext[queue];
+	const uint32_t retval = (queueContext->numTimings < maxTimings) ? queueContext->numTimings : maxTimings;
+	if (timings && retval)
+	{
+		memcpy(timings, queueContext->timings, retval * sizeof(struct GpuTiming));
+	}
+	return retval;
+}
+
+void startGpuTrace(void)
+{
+	NumGpuTraceEvents = 0;
+	GpuTraceActive = true;
+}
+
+static void writeGpuTraceEvents(FILE* file, double originUs)
+{
+	for (uint32_t i = 0; i < NumGpuTraceEvents; i++)
+	{
+		const struct GpuTraceEvent* event = &GpuTraceEvents[i];
+		fprintf(file, "{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}},\n",
+			event->name, (int)event->queue, event->beginUs - originUs, event->durationUs, event->depth);
+	}
+}
+
+// writes the events resolved since startGpuTrace in the Chrome trace event format
+void stopGpuTrace(const char* fileName)
+{
+	GpuTraceActive = false;
+	FILE* file = (fileName) ? fopen(fileName, "w") : NULL;
+	if (file)
+	{
+		fprintf(file, "{\"traceEvents\":[\n");
+		writeGpuTraceEvents(file, (NumGpuTraceEvents) ? GpuTraceEvents[0].beginUs : 0.0);
+		fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}\n");
+		fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+		fclose(file);
+	}
+	freeMem(GpuTraceEvents);
+	NumGpuTraceEvents = 0;
+	MaxGpuTraceEvents = 0;
+}
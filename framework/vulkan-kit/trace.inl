@@ -0,0 +1,1084 @@
+#pragma once
+
+#if WITH_TRACE
+
+#define API_TRACE_MAGIC 0x544b4b56u
+#define API_TRACE_VERSION 1u
+
+// ids 1 and 2 follow the swapchain, whatever image it is on when replayed
+#define TRACE_SWAPCHAIN_RENDER_PASS 1u
+#define TRACE_SWAPCHAIN_FRAMEBUFFER 2u
+#define TRACE_FIRST_OBJECT 16u
+#define TRACE_REMOVED_KEY UINT64_MAX
+
+/*
+A trace is this header followed by records of
+	uint8 op, uint8 numArgs, varint args[numArgs], varint dataBytes, data[dataBytes]
+Objects are referred to by ids handed out in creation order, creation records carry the new id as their first argument.
+*/
+struct ApiTraceHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t transientBytes;
+	uint64_t stagingBytes;
+	uint32_t width;
+	uint32_t height;
+	uint32_t colorFormat;
+	uint32_t depthFormat;
+	uint32_t preserve;
+	uint32_t clear;
+	uint32_t swapchainImages;
+	int32_t presentQueue;
+	uint32_t commandBuffers[eDeviceQueue_EnumMax];
+	uint32_t recordingContexts;
+	uint32_t descriptorPoolSets;
+	uint32_t pushDescriptors;
+	uint32_t gpuTimestamps;
+	uint32_t maxBindings[6];
+	uint32_t reserved;
+};
+
+struct TraceObjectSlot
+{
+	uint64_t key;
+	uint64_t id;
+};
+
+struct TraceMappedBuffer
+{
+	const void* data;
+	size_t bytes;
+	uint64_t id;
+};
+
+// pointers handed back to the app are written once the app had the chance to fill them
+struct TracePending
+{
+	uint64_t args[TRACE_MAX_ARGS];
+	const void* data;
+	size_t bytes;
+	uint32_t numArgs;
+	enum TraceOp op;
+	bool active;
+};
+
+struct TraceBlock
+{
+	uint8_t* data;
+	size_t bytes;
+	size_t capacity;
+};
+
+struct TraceRecord
+{
+	uint64_t args[TRACE_MAX_ARGS];
+	const uint8_t* data;
+	size_t bytes;
+	uint32_t numArgs;
+	enum TraceOp op;
+};
+
+static SDL_mutex* TraceLock = NULL;
+static struct TraceObjectSlot* TraceObjects = NULL;
+static uint32_t NumTraceSlots = 0;
+static uint32_t NumTraceObjects = 0;
+static uint64_t NextTraceId = TRACE_FIRST_OBJECT;
+static struct TraceMappedBuffer* TraceMapped = NULL;
+static uint32_t NumTraceMapped = 0;
+static uint32_t MaxTraceMapped = 0;
+static uint64_t* TraceShaders = NULL;
+static uint32_t NumTraceShaders = 0;
+static threadLocal struct TracePending TracePendingData;
+static threadLocal struct TraceBlock TraceContextBlock;
+static threadLocal bool TraceInContext = false;
+
+static const uint32_t kTraceMaxBindings[] = {
+	MAX_SAMPLER_STATES, MAX_UNIFORM_BUFFERS, MAX_SAMPLED_IMAGES, MAX_STORAGE_BUFFERS, MAX_STORAGE_IMAGES, MAX_VERTEX_BUFFERS
+};
+
+static uint8_t* writeTraceVarint(uint8_t* ptr, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		*ptr++ = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	*ptr++ = (uint8_t)value;
+	return ptr;
+}
+
+static const uint8_t* readTraceVarint(const uint8_t* ptr, const uint8_t* end, uint64_t* value)
+{
+	uint64_t retval = 0;
+	for (uint32_t shift = 0; ptr < end && shift < 64; shift += 7)
+	{
+		const uint8_t byte = *ptr++;
+		retval |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+		{
+			*value = retval;
+			return ptr;
+		}
+	}
+	return NULL;
+}
+
+static uint32_t findTraceSlot(uint64_t key)
+{
+	const uint32_t mask = NumTraceSlots - 1;
+	uint32_t index = (uint32_t)((key ^ (key >> 29)) * 0x9e3779b97f4a7c15ull >> 32) & mask;
+	while (TraceObjects[index].key && TraceObjects[index].key != key)
+	{
+		index = (index + 1) & mask;
+	}
+	return index;
+}
+
+static uint64_t addTraceObject(uint64_t key)
+{
+	SDL_LockMutex(TraceLock);
+	if ((NumTraceObjects + 1) * 4 > NumTraceSlots * 3)
+	{
+		// rehashing also drops the slots of destroyed objects
+		struct TraceObjectSlot* slots = TraceObjects;
+		const uint32_t numSlots = NumTraceSlots;
+		NumTraceSlots = (numSlots) ? numSlots * 2 : 256;
+		TraceObjects = calloc(NumTraceSlots, sizeof(struct TraceObjectSlot));
+		breakIfNot(TraceObjects);
+		NumTraceObjects = 0;
+		for (uint32_t i = 0; i < numSlots; i++)
+		{
+			if (slots[i].key && slots[i].key != TRACE_REMOVED_KEY)
+			{
+				TraceObjects[findTraceSlot(slots[i].key)] = slots[i];
+				NumTraceObjects++;
+			}
+		}
+		freeMem(slots);
+	}
+	struct TraceObjectSlot* slot = &TraceObjects[findTraceSlot(key)];
+	if (!slot->key)
+	{
+		NumTraceObjects++;
+	}
+	slot->key = key;
+	slot->id = NextTraceId++;
+	const uint64_t retval = slot->id;
+	SDL_UnlockMutex(TraceLock);
+	return retval;
+}
+
+static uint64_t getTraceObject(uint64_t key)
+{
+	if (!key)
+	{
+		return 0;
+	}
+	if (key == traceKey(SwapchainRenderPass))
+	{
+		return TRACE_SWAPCHAIN_RENDER_PASS;
+	}
+	for (uint32_t i = 0; i < SwapchainLength; i++)
+	{
+		if (key == traceKey(SwapchainFramebuffers[i]))
+		{
+			return TRACE_SWAPCHAIN_FRAMEBUFFER;
+		}
+	}
+	uint64_t retval = 0;
+	SDL_LockMutex(TraceLock);
+	if (NumTraceSlots)
+	{
+		retval = TraceObjects[findTraceSlot(key)].id;
+	}
+	SDL_UnlockMutex(TraceLock);
+	return retval;
+}
+
+static void appendTraceBlock(const void* data, size_t bytes)
+{
+	struct TraceBlock* block = &TraceContextBlock;
+	if (block->bytes + bytes > block->capacity)
+	{
+		block->capacity = (block->bytes + bytes) * 2;
+		safeRealloc(block->data, block->capacity);
+	}
+	memcpy(block->data + block->bytes, data, bytes);
+	block->bytes += bytes;
+}
+
+static void flushTracePending(void)
+{
+	if (TracePendingData.active)
+	{
+		const struct TracePending pending = TracePendingData;
+		TracePendingData.active = false;
+		writeTraceRecord(pending.op, 0, pending.args, pending.numArgs, pending.data, pending.bytes);
+	}
+}
+
+static void writeTraceMappedBuffers(void)
+{
+	SDL_LockMutex(TraceLock);
+	for (uint32_t i = 0; i < NumTraceMapped; i++)
+	{
+		const struct TraceMappedBuffer* mapped = &TraceMapped[i];
+		writeTraceRecord(eTraceOp_BufferContents, 0, &mapped->id, 1, mapped->data, mapped->bytes);
+	}
+	NumTraceMapped = 0;
+	SDL_UnlockMutex(TraceLock);
+}
+
+static void writeTraceRecord(enum TraceOp op, uint64_t created, const uint64_t* args, uint32_t numArgs, const void* data, size_t bytes)
+{
+	if (TraceSuspended || !TraceFile)
+	{
+		return;
+	}
+	flushTracePending();
+	if (op == eTraceOp_SubmitCommandBuffer)
+	{
+		// mapped buffers are read by the GPU from here on, so this is when the app is done writing them
+		writeTraceMappedBuffers();
+	}
+
+	const uint32_t totalArgs = numArgs + ((created) ? 1 : 0);
+	returnIfNot(totalArgs <= TRACE_MAX_ARGS);
+	uint8_t header[2 + (TRACE_MAX_ARGS + 1) * 10];
+	uint8_t* ptr = header;
+	*ptr++ = (uint8_t)op;
+	*ptr++ = (uint8_t)totalArgs;
+	if (created)
+	{
+		ptr = writeTraceVarint(ptr, addTraceObject(created));
+	}
+	for (uint32_t i = 0; i < numArgs; i++)
+	{
+		ptr = writeTraceVarint(ptr, args[i]);
+	}
+	bytes = (data) ? bytes : 0;
+	ptr = writeTraceVarint(ptr, bytes);
+
+	// a recording context goes to the file in one piece so replay can hand it to a thread of its own
+	TraceInContext |= (op == eTraceOp_BeginRecordingContext);
+	if (TraceInContext)
+	{
+		appendTraceBlock(header, ptr - header);
+		appendTraceBlock(data, bytes);
+		if (op == eTraceOp_EndRecordingContext)
+		{
+			SDL_LockMutex(TraceLock);
+			fwrite(TraceContextBlock.data, 1, TraceContextBlock.bytes, TraceFile);
+			SDL_UnlockMutex(TraceLock);
+			freeMem(TraceContextBlock.data);
+			TraceContextBlock.bytes = 0;
+			TraceContextBlock.capacity = 0;
+			TraceInContext = false;
+		}
+	}
+	else
+	{
+		SDL_LockMutex(TraceLock);
+		fwrite(header, 1, ptr - header, TraceFile);
+		if (bytes)
+		{
+			fwrite(data, 1, bytes, TraceFile);
+		}
+		SDL_UnlockMutex(TraceLock);
+	}
+}
+
+static void writeTraceDestroy(enum TraceOp op, uint64_t key)
+{
+	const uint64_t id = getTraceObject(key);
+	if (id < TRACE_FIRST_OBJECT)
+	{
+		return;
+	}
+	writeTraceRecord(op, 0, &id, 1, NULL, 0);
+	SDL_LockMutex(TraceLock);
+	TraceObjects[findTraceSlot(key)].key = TRACE_REMOVED_KEY;
+	for (uint32_t i = 0; i < NumTraceMapped; i++)
+	{
+		if (TraceMapped[i].id == id)
+		{
+			TraceMapped[i--] = TraceMapped[--NumTraceMapped];
+		}
+	}
+	SDL_UnlockMutex(TraceLock);
+}
+
+static void setTracePending(enum TraceOp op, const uint64_t* args, uint32_t numArgs, const void* data, size_t bytes)
+{
+	returnIfNot(numArgs <= TRACE_MAX_ARGS);
+	flushTracePending();
+	struct TracePending* pending = &TracePendingData;
+	memcpy(pending->args, args, numArgs * sizeof(uint64_t));
+	pending->numArgs = numArgs;
+	pending->data = data;
+	pending->bytes = bytes;
+	pending->op = op;
+	pending->active = true;
+}
+
+static void addTraceMappedBuffer(uint64_t key, const void* data, size_t bytes)
+{
+	const uint64_t id = getTraceObject(key);
+	if (id < TRACE_FIRST_OBJECT || !data)
+	{
+		return;
+	}
+	SDL_LockMutex(TraceLock);
+	bool found = false;
+	for (uint32_t i = 0; i < NumTraceMapped && !found; i++)
+	{
+		found = (TraceMapped[i].data == data);
+	}
+	if (!found)
+	{
+		if (NumTraceMapped == MaxTraceMapped)
+		{
+			MaxTraceMapped = (MaxTraceMapped) ? MaxTraceMapped * 2 : 16;
+			safeRealloc(TraceMapped, MaxTraceMapped * sizeof(struct TraceMappedBuffer));
+		}
+		struct TraceMappedBuffer* mapped = &TraceMapped[NumTraceMapped++];
+		mapped->data = data;
+		mapped->bytes = bytes;
+		mapped->id = id;
+	}
+	SDL_UnlockMutex(TraceLock);
+}
+
+static void writeTraceFramebuffer(uint64_t key, RenderPass renderPass, const Image* images, uint32_t numImages)
+{
+	uint64_t* ids = malloc(numImages * sizeof(uint64_t));
+	returnIfNot(ids);
+	for (uint32_t i = 0; i < numImages; i++)
+	{
+		ids[i] = traceObject(images[i]);
+	}
+	const uint64_t args[] = { traceObject(renderPass) };
+	writeTraceRecord(eTraceOp_CreateFramebuffer, key, args, _countof(args), ids, numImages * sizeof(uint64_t));
+	freeMem(ids);
+}
+
+// shader sources are stored once each so a trace replays without the app's files
+static void writeTracePipeline(enum TraceOp op, uint64_t key, const char* shaderFile, VkShaderStageFlags stageFlags, RenderPass renderPass)
+{
+	size_t bytes = 0;
+	char* source = loadFromFile(shaderFile, &bytes);
+	const uint64_t hash = (source) ? hashBytes(source, bytes, kHashSeed) : 0;
+	SDL_LockMutex(TraceLock);
+	bool found = false;
+	for (uint32_t i = 0; i < NumTraceShaders && !found; i++)
+	{
+		found = (TraceShaders[i] == hash);
+	}
+	if (!found && source)
+	{
+		safeRealloc(TraceShaders, (NumTraceShaders + 1) * sizeof(uint64_t));
+		TraceShaders[NumTraceShaders++] = hash;
+		writeTraceRecord(eTraceOp_ShaderSource, 0, &hash, 1, source, bytes);
+	}
+	SDL_UnlockMutex(TraceLock);
+	freeMem(source);
+
+	const uint64_t args[] = { hash, stageFlags, traceObject(renderPass) };
+	writeTraceRecord(op, key, args, _countof(args), NULL, 0);
+}
+
+static void startApiTrace(void)
+{
+	if (!TraceFileName)
+	{
+		return;
+	}
+	TraceFile = fopen(TraceFileName, "wb");
+	returnIfNot(TraceFile);
+	TraceLock = SDL_CreateMutex();
+	NextTraceId = TRACE_FIRST_OBJECT;
+
+	struct ApiTraceHeader header = {
+		.magic = API_TRACE_MAGIC,
+		.version = API_TRACE_VERSION,
+		.transientBytes = TransientBytes,
+		.stagingBytes = StagingBytes,
+		.width = SwapchainImages->size.width,
+		.height = SwapchainImages->size.height,
+		.colorFormat = SwapchainImages->format,
+		.depthFormat = SwapchainDepthBuffer,
+		.preserve = SwapchainPreserve,
+		.clear = SwapchainClear,
+		.swapchainImages = SwapchainLength,
+		.presentQueue = PresentQueue,
+		.recordingContexts = NumRecordingContexts,
+		.descriptorPoolSets = DescriptorPoolSets,
+		.pushDescriptors = PushDescriptors,
+		.gpuTimestamps = GpuTimestamps
+	};
+	for (uint32_t i = 0; i < eDeviceQueue_EnumMax; i++)
+	{
+		header.commandBuffers[i] = QueueContext[i].numCommandBuffers;
+	}
+	memcpy(header.maxBindings, kTraceMaxBindings, sizeof(header.maxBindings));
+	fwrite(&header, sizeof(header), 1, TraceFile);
+}
+
+static void stopApiTrace(void)
+{
+	if (TraceFile)
+	{
+		flushTracePending();
+		fclose(TraceFile);
+		TraceFile = NULL;
+		SDL_DestroyMutex(TraceLock);
+		TraceLock = NULL;
+		freeMem(TraceObjects);
+		freeMem(TraceMapped);
+		freeMem(TraceShaders);
+		NumTraceSlots = NumTraceObjects = 0;
+		NumTraceMapped = MaxTraceMapped = 0;
+		NumTraceShaders = 0;
+	}
+}
+
+struct ReplayObject
+{
+	union
+	{
+		void* pointer;
+		SamplerState sampler;
+	};
+	enum TraceOp op;
+};
+
+struct ReplayBlock
+{
+	const uint8_t* begin;
+	const uint8_t* end;
+	SDL_Thread* thread;
+};
+
+static uint8_t* ReplayData = NULL;
+static const uint8_t* ReplayCursor = NULL;
+static const uint8_t* ReplayEnd = NULL;
+static struct ReplayObject* ReplayObjects = NULL;
+static uint64_t NumReplayObjects = 0;
+static const char* ReplayShaderDir = NULL;
+static struct ReplayBlock ReplayBlocks[MAX_RECORDING_CONTEXTS];
+static uint32_t NumReplayBlocks = 0;
+
+static const uint8_t* readTraceRecord(const uint8_t* ptr, const uint8_t* end, struct TraceRecord* record)
+{
+	memset(record, 0, sizeof(struct TraceRecord));
+	if (end - ptr < 2)
+	{
+		return NULL;
+	}
+	record->op = (enum TraceOp)ptr[0];
+	record->numArgs = ptr[1];
+	ptr += 2;
+	if (record->op >= eTraceOp_EnumMax || record->numArgs > TRACE_MAX_ARGS)
+	{
+		return NULL;
+	}
+	for (uint32_t i = 0; i < record->numArgs && ptr; i++)
+	{
+		ptr = readTraceVarint(ptr, end, &record->args[i]);
+	}
+	uint64_t bytes = 0;
+	ptr = (ptr) ? readTraceVarint(ptr, end, &bytes) : NULL;
+	if (!ptr || bytes > (uint64_t)(end - ptr))
+	{
+		return NULL;
+	}
+	record->data = ptr;
+	record->bytes = (size_t)bytes;
+	return ptr + bytes;
+}
+
+static void* getReplayObject(uint64_t id)
+{
+	switch (id)
+	{
+	case TRACE_SWAPCHAIN_RENDER_PASS:
+		return getSwapchainRenderPass();
+	case TRACE_SWAPCHAIN_FRAMEBUFFER:
+		return getSwapchainFramebuffer();
+	default:
+		return (id < NumReplayObjects) ? ReplayObjects[id].pointer : NULL;
+	}
+}
+
+static SamplerState getReplaySampler(uint64_t id)
+{
+	return (id < NumReplayObjects) ? ReplayObjects[id].sampler : VK_NULL_HANDLE;
+}
+
+static struct ReplayObject* addReplayObject(uint64_t id, enum TraceOp op)
+{
+	retvalIfNot(id >= TRACE_FIRST_OBJECT && id < UINT32_MAX, NULL);
+	if (id >= NumReplayObjects)
+	{
+		const uint64_t numObjects = (id + 1 > NumReplayObjects * 2) ? id + 1 : NumReplayObjects * 2;
+		safeRealloc(ReplayObjects, (size_t)numObjects * sizeof(struct ReplayObject));
+		memset(ReplayObjects + NumReplayObjects, 0, (size_t)(numObjects - NumReplayObjects) * sizeof(struct ReplayObject));
+		NumReplayObjects = numObjects;
+	}
+	ReplayObjects[id].op = op;
+	return &ReplayObjects[id];
+}
+
+static void releaseReplayObject(uint64_t id)
+{
+	if (id >= TRACE_FIRST_OBJECT && id < NumReplayObjects)
+	{
+		memset(&ReplayObjects[id], 0, sizeof(struct ReplayObject));
+	}
+}
+
+static void getReplayShaderPath(uint64_t hash, char* path, size_t bytes)
+{
+	snprintf(path, bytes, "%s/%016llx.glsl", ReplayShaderDir, (unsigned long long)hash);
+}
+
+static void replayTraceRecord(const struct TraceRecord* record)
+{
+	const uint64_t* args = record->args;
+	struct ReplayObject* created = NULL;
+	char path[512];
+	switch (record->op)
+	{
+	case eTraceOp_CreateVertexArray:
+		if ((created = addReplayObject(args[0], record->op)))
+			created->pointer = createVertexArray((size_t)args[1], (DeviceQueue)(int)args[2]);
+		break;
+	case eTraceOp_CreateUniformBuffer:
+		if ((created = addReplayObject(args[0], record->op)))
+			created->pointer = createUniformBuffer((size_t)args[1], (DeviceQueue)(int)args[2]);
+		break;
+	case eTraceOp_CreateStorageBuffer:
+		if ((created = addReplayObject(args[0], record->op)))
+			created->pointer = createStorageBuffer((size_t)args[1], (DeviceQueue)(int)args[2]);
+		break;
+	case eTraceOp_CreateUploadBuffer:
+		if ((created = addReplayObject(args[0], record->op)))
+			created->pointer = createUploadBuffer((size_t)args[1], (DeviceQueue)(int)args[2]);
+		break;
+	case eTraceOp_BufferContents:
+	{
+		Buffer buffer = getReplayObject(args[0]);
+		void* mapped = getBufferMappedPtr(buffer);
+		if (mapped)
+		{
+			memcpy(mapped, record->data, (record->bytes < buffer->size) ? record->bytes : buffer->size);
+		}
+		break;
+	}
+	case eTraceOp_DestroyBuffer:
+		destroyBuffer(getReplayObject(args[0]));
+		releaseReplayObject(args[0]);
+		break;
+	case eTraceOp_CreateRenderTargetImage:
+	case eTraceOp_CreateSampledImage:
+	case eTraceOp_CreateStorageImage:
+	{
+		const VkExtent3D extent = { (uint32_t)args[2], (uint32_t)args[3], (uint32_t)args[4] };
+		if (!(created = addReplayObject(args[0], record->op)))
+			break;
+		if (record->op == eTraceOp_CreateRenderTargetImage)
+			created->pointer = createRenderTargetImage((VkFormat)args[1], &extent);
+		else if (record->op == eTraceOp_CreateSampledImage)
+			created->pointer = createSampledImage((VkFormat)args[1], &extent, (uint32_t)args[5]);
+		else
+			created->pointer = createStorageImage((VkFormat)args[1], &extent, (uint32_t)args[5]);
+		break;
+	}
+	case eTraceOp_CreateTransientImage:
+	{
+		// replayed without aliasing, every transient gets memory of its own
+		const VkExtent3D extent = { (uint32_t)args[2], (uint32_t)args[3], (uint32_t)args[4] };
+		if ((created = addReplayObject(args[0], record->op)) && (created->pointer = createTransientImage((VkFormat)args[1], &extent, (VkImageUsageFlags)args[5])))
+			bindTransientImage(created->pointer, NULL);
+		break;
+	}
+	case eTraceOp_DestroyImage:
+		destroyImage(getReplayObject(args[0]));
+		releaseReplayObject(args[0]);
+		break;
+	case eTraceOp_CreateSamplerState:
+		if ((created = addReplayObject(args[0], record->op)))
+			created->sampler = createSamplerState((VkFilter)args[1], (VkSamplerMipmapMode)args[2], (VkSamplerAddressMode)args[3]);
+		break;
+	case eTraceOp_DestroySamplerState:
+		destroySamplerState(getReplaySampler(args[0]));
+		releaseReplayObject(args[0]);
+		break;
+	case eTraceOp_CreateRenderPass:
+		if ((created = addReplayObject(args[0], record->op)))
+			created->pointer = createRenderPass((uint32_t)args[1], (uint32_t)args[2]);
+		break;
+	case eTraceOp_SetRenderPassClearColor:
+	{
+		float value[4] = { 0.f };
+		memcpy(value, record->data, (record->bytes < sizeof(value)) ? record->bytes : sizeof(value));
+		setRenderPassClearColor(getReplayObject(args[0]), (uint32_t)args[1], value);
+		break;
+	}
+	case eTraceOp_SetRenderPassClearDepth:
+	{
+		float value = 1.f;
+		memcpy(&value, record->data, (record->bytes < sizeof(value)) ? record->bytes : sizeof(value));
+		setRenderPassClearDepth(getReplayObject(args[0]), value);
+		break;
+	}
+	case eTraceOp_RenderPassColorTarget:
+	case eTraceOp_RenderPassDepthStencilTarget:
+	{
+		RenderPass renderPass = getReplayObject(args[0]);
+		VkAttachmentDescription* target = (record->op == eTraceOp_RenderPassColorTarget) ? getRenderPassColorTarget(renderPass, (uint32_t)args[1]) : getRenderPassDepthStencilTarget(renderPass);
+		if (target && record->bytes == sizeof(VkAttachmentDescription) && memcmp(target, record->data, sizeof(VkAttachmentDescription)) != 0)
+		{
+			memcpy(target, record->data, sizeof(VkAttachmentDescription));
+			if (renderPass->handle)
+			{
+				// a frame graph rebuild changed the ops of a pass already in use
+				deviceWaitIdle();
+				resetRenderPassHandle(renderPass);
+			}
+		}
+		break;
+	}
+	case eTraceOp_DestroyRenderPass:
+		destroyRenderPass(getReplayObject(args[0]));
+		releaseReplayObject(args[0]);
+		break;
+	case eTraceOp_CreateFramebuffer:
+	{
+		const uint32_t numImages = (uint32_t)(record->bytes / sizeof(uint64_t));
+		Image* images = calloc(numImages + 1, sizeof(Image));
+		if (!images || !(created = addReplayObject(args[0], record->op)))
+		{
+			freeMem(images);
+			break;
+		}
+		for (uint32_t i = 0; i < numImages; i++)
+		{
+			uint64_t id = 0;
+			memcpy(&id, record->data + i * sizeof(uint64_t), sizeof(uint64_t));
+			images[i] = getReplayObject(id);
+		}
+		created->pointer = createFramebuffer(getReplayObject(args[1]), images);
+		freeMem(images);
+		break;
+	}
+	case eTraceOp_DestroyFramebuffer:
+		destroyFramebuffer(getReplayObject(args[0]));
+		releaseReplayObject(args[0]);
+		break;
+	case eTraceOp_ShaderSource:
+	{
+		getReplayShaderPath(args[0], path, sizeof(path));
+		FILE* file = fopen(path, "wb");
+		if (file)
+		{
+			fwrite(record->data, 1, record->bytes, file);
+			fclose(file);
+		}
+		break;
+	}
+	case eTraceOp_CreateGraphicsPipeline:
+		getReplayShaderPath(args[1], path, sizeof(path));
+		if ((created = addReplayObject(args[0], record->op)))
+			created->pointer = createGraphicsPipeline(path, (VkShaderStageFlags)args[2], getReplayObject(args[3]));
+		break;
+	case eTraceOp_CreateComputePipeline:
+		getReplayShaderPath(args[1], path, sizeof(path));
+		if ((created = addReplayObject(args[0], record->op)))
+			created->pointer = createComputePipeline(path);
+		break;
+	case eTraceOp_SetGraphicsPipelineDepthTest:
+		setGraphicsPipelineDepthTest(getReplayObject(args[0]), args[1] != 0, args[2] != 0, (VkCompareOp)args[3]);
+		break;
+	case eTraceOp_SetGraphicsPipelineFaceCulling:
+		setGraphicsPipelineFaceCulling(getReplayObject(args[0]), (VkCullModeFlags)args[1]);
+		break;
+	case eTraceOp_SetGraphicsPipelineVertexInput:
+		setGraphicsPipelineVertexInput(getReplayObject(args[0]), (uint32_t)args[1], (uint32_t)args[2], (VkVertexInputRate)args[3]);
+		break;
+	case eTraceOp_SetGraphicsPipelineVertexFormat:
+		setGraphicsPipelineVertexFormat(getReplayObject(args[0]), (uint32_t)args[1], (VkFormat)args[2]);
+		break;
+	case eTraceOp_SetPipelineFallback:
+		setPipelineFallback(getReplayObject(args[0]), getReplayObject(args[1]));
+		break;
+	case eTraceOp_CompilePipelineAsync:
+	{
+		// waiting keeps the replayed draws independent of how fast the pipelines compile
+		Pipeline pipeline = getReplayObject(args[0]);
+		compilePipelineAsync(pipeline);
+		while (pipeline && !isPipelineReady(pipeline))
+		{
+			SDL_Delay(1);
+		}
+		break;
+	}
+	case eTraceOp_DestroyPipeline:
+		destroyPipeline(getReplayObject(args[0]));
+		releaseReplayObject(args[0]);
+		break;
+	case eTraceOp_BeginCommandBuffer:
+		beginCommandBuffer((DeviceQueue)(int)args[0]);
+		break;
+	case eTraceOp_SubmitCommandBuffer:
+		submitCommandBuffer((DeviceQueue)(int)args[0], args[1] != 0);
+		break;
+	case eTraceOp_BufferMemoryBarrier:
+		bufferMemoryBarrier(getReplayObject(args[0]), (VkAccessFlags)args[1], (VkAccessFlags)args[2]);
+		break;
+	case eTraceOp_ImageMemoryBarrier:
+		imageMemoryBarrier(getReplayObject(args[0]), (VkImageLayout)args[1], (VkAccessFlags)args[2], (VkImageLayout)args[3], (VkAccessFlags)args[4], (ImageSubset)args[5]);
+		break;
+	case eTraceOp_PipelineBarrier:
+		pipelineBarrier((VkPipelineStageFlags)args[0], (VkPipelineStageFlags)args[1]);
+		break;
+	case eTraceOp_UseBuffer:
+		useBuffer(getReplayObject(args[0]), (ResourceUsage)args[1]);
+		break;
+	case eTraceOp_UseImage:
+		useImage(getReplayObject(args[0]), (ResourceUsage)args[1], (ImageSubset)args[2]);
+		break;
+	case eTraceOp_UpdateBuffer:
+		updateBuffer(getReplayObject(args[0]), record->data, (size_t)args[1], record->bytes);
+		break;
+	case eTraceOp_UpdateImageMipLevel:
+		updateImageMipLevel(getReplayObject(args[0]), getReplayObject(args[1]), (uint32_t)args[2]);
+		break;
+	case eTraceOp_UploadImage:
+		uploadImage(getReplayObject(args[0]), (uint32_t)args[1], record->data, record->bytes);
+		break;
+	case eTraceOp_Blit:
+		blit(getReplayObject(args[0]), getReplayObject(args[1]), (ImageSubset)args[2], (ImageSubset)args[3]);
+		break;
+	case eTraceOp_BeginRenderPass:
+		beginRenderPass(getReplayObject(args[0]), getReplayObject(args[1]));
+		break;
+	case eTraceOp_BeginParallelRenderPass:
+		beginParallelRenderPass(getReplayObject(args[0]), getReplayObject(args[1]));
+		break;
+	case eTraceOp_EndRenderPass:
+		endRenderPass();
+		break;
+	case eTraceOp_BindSamplerState:
+		bindSamplerState((uint32_t)args[0], getReplaySampler(args[1]));
+		break;
+	case eTraceOp_BindUniformBuffer:
+		bindUniformBuffer((uint32_t)args[0], getReplayObject(args[1]));
+		break;
+	case eTraceOp_BindSampledImage:
+		bindSampledImage((uint32_t)args[0], getReplayObject(args[1]));
+		break;
+	case eTraceOp_BindStorageBuffer:
+		bindStorageBuffer((uint32_t)args[0], getReplayObject(args[1]));
+		break;
+	case eTraceOp_BindStorageImage:
+		bindStorageImage((uint32_t)args[0], getReplayObject(args[1]));
+		break;
+	case eTraceOp_BindVertexBufferRange:
+		bindVertexBufferRange((uint32_t)args[0], getReplayObject(args[1]), (size_t)args[2]);
+		break;
+	case eTraceOp_BindIndexBufferRange:
+		bindIndexBufferRange((VkIndexType)args[0], getReplayObject(args[1]), (size_t)args[2]);
+		break;
+	case eTraceOp_BindUniformData:
+	case eTraceOp_BindVertexData:
+	case eTraceOp_BindIndexData:
+	{
+		void* data = NULL;
+		if (record->op == eTraceOp_BindUniformData)
+			data = bindUniformData((uint32_t)args[0], (size_t)args[1]);
+		else if (record->op == eTraceOp_BindVertexData)
+			data = bindVertexData((uint32_t)args[0], (size_t)args[1]);
+		else
+			data = bindIndexData((VkIndexType)args[0], (size_t)args[1]);
+		if (data)
+		{
+			memcpy(data, record->data, (record->bytes < args[1]) ? record->bytes : (size_t)args[1]);
+		}
+		break;
+	}
+	case eTraceOp_BindGraphicsPipeline:
+		bindGraphicsPipeline(getReplayObject(args[0]));
+		break;
+	case eTraceOp_BindComputePipeline:
+		bindComputePipeline(getReplayObject(args[0]));
+		break;
+	case eTraceOp_DrawIndexed:
+		drawIndexed((uint32_t)args[0], (uint32_t)args[1], (uint32_t)args[2], (uint32_t)args[3], (uint32_t)args[4]);
+		break;
+	case eTraceOp_DrawIndexedIndirect:
+		drawIndexedIndirect(getReplayObject(args[0]), (size_t)args[1], (uint32_t)args[2]);
+		break;
+	case eTraceOp_DrawIndexedIndirectCount:
+		drawIndexedIndirectCount(getReplayObject(args[0]), (size_t)args[1], getReplayObject(args[2]), (size_t)args[3], (uint32_t)args[4]);
+		break;
+	case eTraceOp_DrawIndexedMulti:
+	{
+		const uint32_t numDraws = (uint32_t)(record->bytes / sizeof(VkDrawIndexedIndirectCommand));
+		VkDrawIndexedIndirectCommand* draws = malloc(numDraws * sizeof(VkDrawIndexedIndirectCommand) + 1);
+		if (draws)
+		{
+			memcpy(draws, record->data, numDraws * sizeof(VkDrawIndexedIndirectCommand));
+			drawIndexedMulti(draws, numDraws);
+			freeMem(draws);
+		}
+		break;
+	}
+	case eTraceOp_Dispatch:
+		dispatch((uint32_t)args[0], (uint32_t)args[1], (uint32_t)args[2]);
+		break;
+	case eTraceOp_DispatchIndirect:
+		dispatchIndirect(getReplayObject(args[0]), (size_t)args[1]);
+		break;
+	case eTraceOp_BeginRecordingContext:
+		beginRecordingContext((uint32_t)args[0]);
+		break;
+	case eTraceOp_EndRecordingContext:
+		endRecordingContext();
+		break;
+	case eTraceOp_BeginGpuScope:
+		// the name stays valid in the loaded trace until it's unloaded
+		if (record->bytes && record->data[record->bytes - 1] == '\0')
+		{
+			beginGpuScope((const char*)record->data);
+		}
+		break;
+	case eTraceOp_EndGpuScope:
+		endGpuScope();
+		break;
+	case eTraceOp_CreateCommandBundle:
+		if ((created = addReplayObject(args[0], record->op)))
+			created->pointer = createCommandBundle((DeviceQueue)(int)args[1]);
+		break;
+	case eTraceOp_BeginCommandBundle:
+	{
+		// the recorded contents are always replayed into a fresh recording, an unrecorded one stays empty for a frame
+		CommandBundle bundle = getReplayObject(args[0]);
+		if (args[1])
+		{
+			invalidateCommandBundle(bundle);
+		}
+		if (beginCommandBundle(bundle) && !args[1])
+		{
+			invalidateCommandBundle(bundle);
+		}
+		break;
+	}
+	case eTraceOp_EndCommandBundle:
+		endCommandBundle(getReplayObject(args[0]));
+		break;
+	case eTraceOp_InvalidateCommandBundle:
+		invalidateCommandBundle(getReplayObject(args[0]));
+		break;
+	case eTraceOp_DestroyCommandBundle:
+		destroyCommandBundle(getReplayObject(args[0]));
+		releaseReplayObject(args[0]);
+		break;
+	case eTraceOp_PresentImageToWindow:
+		presentImageToWindow();
+		break;
+	default:
+		break;
+	}
+}
+
+static int replayTraceBlock(void* userData)
+{
+	const struct ReplayBlock* block = userData;
+	struct TraceRecord record;
+	for (const uint8_t* ptr = block->begin; ptr && ptr < block->end; )
+	{
+		ptr = readTraceRecord(ptr, block->end, &record);
+		if (ptr)
+		{
+			replayTraceRecord(&record);
+		}
+	}
+	return 0;
+}
+
+static void waitReplayBlocks(void)
+{
+	for (uint32_t i = 0; i < NumReplayBlocks; i++)
+	{
+		SDL_WaitThread(ReplayBlocks[i].thread, NULL);
+	}
+	NumReplayBlocks = 0;
+}
+
+// recording contexts replay on threads of their own, joined before the next call from the main stream
+static const uint8_t* startReplayBlock(const uint8_t* begin)
+{
+	struct TraceRecord record = { .op = eTraceOp_BeginRecordingContext };
+	const uint8_t* end = begin;
+	while (end && end < ReplayEnd && record.op != eTraceOp_EndRecordingContext)
+	{
+		end = readTraceRecord(end, ReplayEnd, &record);
+	}
+	end = (end) ? end : ReplayEnd;
+
+	if (NumReplayBlocks == MAX_RECORDING_CONTEXTS)
+	{
+		waitReplayBlocks();
+	}
+	struct ReplayBlock* block = &ReplayBlocks[NumReplayBlocks];
+	block->begin = begin;
+	block->end = end;
+	block->thread = SDL_CreateThread(replayTraceBlock, "vkk-replay", block);
+	if (block->thread)
+	{
+		NumReplayBlocks++;
+	}
+	else
+	{
+		replayTraceBlock(block);
+	}
+	return end;
+}
+
+bool loadApiTrace(const char* fileName, const char* shaderDirectory)
+{
+	FILE* file = fopen(fileName, "rb");
+	if (!file)
+	{
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	const long bytes = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	ReplayData = (bytes > 0) ? malloc((size_t)bytes) : NULL;
+	const bool loaded = ReplayData && fread(ReplayData, 1, (size_t)bytes, file) == (size_t)bytes;
+	fclose(file);
+
+	struct ApiTraceHeader header = { 0 };
+	bool compatible = loaded && (size_t)bytes >= sizeof(header);
+	if (compatible)
+	{
+		memcpy(&header, ReplayData, sizeof(header));
+		compatible = (header.magic == API_TRACE_MAGIC && header.version == API_TRACE_VERSION);
+	}
+	for (uint32_t i = 0; compatible && i < _countof(kTraceMaxBindings); i++)
+	{
+		// shaders are compiled again against this build's binding layout, it only has to have room for the recorded one
+		compatible = (header.maxBindings[i] <= kTraceMaxBindings[i]);
+	}
+	if (!compatible)
+	{
+		freeMem(ReplayData);
+		return false;
+	}
+
+	makeDirectory(shaderDirectory);
+	ReplayShaderDir = shaderDirectory;
+	ReplayCursor = ReplayData + sizeof(header);
+	ReplayEnd = ReplayData + bytes;
+
+	requestHeadlessSwapchain(header.width, header.height);
+	requestDefaultCommandQueue(header.commandBuffers[eDeviceQueue_Universal], header.presentQueue == eDeviceQueue_Universal);
+	requestTransferCommandQueue(header.commandBuffers[eDeviceQueue_Transfer]);
+	requestComputeCommandQueue(header.commandBuffers[eDeviceQueue_Compute]);
+	requestSwapchainColorTarget((VkFormat)header.colorFormat);
+	requestSwapchainDepthBuffer((VkFormat)header.depthFormat);
+	requestSwapchainImageCount(header.swapchainImages);
+	requestSwapchainPreserve(header.preserve);
+	requestSwapchainClear(header.clear);
+	requestTransientMemory((size_t)header.transientBytes);
+	requestStagingMemory((size_t)header.stagingBytes);
+	requestRecordingContexts(header.recordingContexts);
+	requestDescriptorPoolSets(header.descriptorPoolSets);
+	requestPushDescriptors(header.pushDescriptors != 0);
+	requestGpuTimestamps(header.gpuTimestamps != 0);
+	return true;
+}
+
+bool replayApiTraceFrame(void)
+{
+	bool presented = false;
+	while (!presented && ReplayCursor && ReplayCursor < ReplayEnd)
+	{
+		struct TraceRecord record;
+		const uint8_t* next = readTraceRecord(ReplayCursor, ReplayEnd, &record);
+		if (!next)
+		{
+			debugPrint("api trace is truncated at byte %zu\n", (size_t)(ReplayCursor - ReplayData));
+		}
+		else if (record.op == eTraceOp_BeginRecordingContext)
+		{
+			next = startReplayBlock(ReplayCursor);
+		}
+		else
+		{
+			waitReplayBlocks();
+			replayTraceRecord(&record);
+			presented = (record.op == eTraceOp_PresentImageToWindow);
+		}
+		ReplayCursor = next;
+	}
+	waitReplayBlocks();
+	return presented;
+}
+
+void unloadApiTrace(void)
+{
+	waitReplayBlocks();
+	for (uint64_t i = TRACE_FIRST_OBJECT; i < NumReplayObjects; i++)
+	{
+		// whatever the app still held when the trace stopped
+		struct ReplayObject* object = &ReplayObjects[i];
+		switch (object->op)
+		{
+		case eTraceOp_CreateVertexArray:
+		case eTraceOp_CreateUniformBuffer:
+		case eTraceOp_CreateStorageBuffer:
+		case eTraceOp_CreateUploadBuffer:
+			destroyBuffer(object->pointer);
+			break;
+		case eTraceOp_CreateRenderTargetImage:
+		case eTraceOp_CreateSampledImage:
+		case eTraceOp_CreateStorageImage:
+		case eTraceOp_CreateTransientImage:
+			destroyImage(object->pointer);
+			break;
+		case eTraceOp_CreateSamplerState:
+			destroySamplerState(object->sampler);
+			break;
+		case eTraceOp_CreateRenderPass:
+			destroyRenderPass(object->pointer);
+			break;
+		case eTraceOp_CreateFramebuffer:
+			destroyFramebuffer(object->pointer);
+			break;
+		case eTraceOp_CreateGraphicsPipeline:
+		case eTraceOp_CreateComputePipeline:
+			destroyPipeline(object->pointer);
+			break;
+		case eTraceOp_CreateCommandBundle:
+			destroyCommandBundle(object->pointer);
+			break;
+		default:
+			break;
+		}
+	}
+	freeMem(ReplayObjects);
+	freeMem(ReplayData);
+	NumReplayObjects = 0;
+	ReplayCursor = ReplayEnd = NULL;
+}
+
+#else
+
+#define startApiTrace()
+#define stopApiTrace()
+
+#endif
@@ -1,9 +1,13 @@
 #include "vkk.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <Volk/volk.c>
+#include <SDL2/SDL.h>
 #include <SDL2/SDL_syswm.h>
+#include <SDL2/SDL_vulkan.h>
 
+#ifdef _MSC_VER
 #pragma comment(lib, "SDL2")
 
 #if _DEBUG
@@ -25,18 +29,43 @@
 #pragma comment(lib, "spirv-cross-reflect")
 #pragma comment(lib, "shaderc_combined")
 #endif
+#endif
 
 static VkAllocationCallbacks* Alloc = NULL;
 static VkInstance Instance = VK_NULL_HANDLE;
 static VkDevice Device = VK_NULL_HANDLE;
 static VkSurfaceKHR Surface = VK_NULL_HANDLE;
 static VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+static VkPhysicalDeviceProperties DeviceProperties;
 static VkDescriptorSetLayout DescriptorSetLayout = VK_NULL_HANDLE;
 static VkPipelineLayout PipelineLayout = VK_NULL_HANDLE;
+static VkPipelineCache PipelineCache = VK_NULL_HANDLE;
+static const char* PipelineCacheFile = NULL;
+static uint32_t NumCompilerThreads = 0;
+static size_t TransientBytes = TRANSIENT_MEMORY_BYTES;
+static size_t StagingBytes = STAGING_MEMORY_BYTES;
+static bool PushDescriptors = false;
+static bool DrawIndirectCount = false;
+static bool MultiDrawIndirect = false;
+static bool Synchronization2 = false;
+static bool GpuTimestamps = false;
+static bool SoftwareDevice = false;
+static bool NullBackend = false;
+static const char* TraceFileName = NULL;
+static bool CalibratedTimestamps = false;
+static VkTimeDomainEXT HostTimeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+static uint32_t DescriptorPoolSets = DESCRIPTOR_POOL_SETS;
+static VkDescriptorPoolSize DescriptorPoolSizes[8];
+static uint32_t NumDescriptorPoolSizes = 0;
 
-static VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
-static VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+static threadLocal VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+static threadLocal struct RecordContext* Recorder = NULL;
+static threadLocal struct SecondaryContext* Secondary = NULL;
+static threadLocal bool SkipDrawCalls = false;
+static threadLocal bool SkipDispatches = false;
 static DeviceQueue ActiveQueue = eDeviceQueue_Invalid;
+static uint32_t NumRecordingContexts = 0;
+static SDL_atomic_t ResourceGeneration;
 
 static struct SDL_Window* Window = NULL;
 static DeviceQueue PresentQueue = eDeviceQueue_Invalid;
@@ -57,13 +86,17 @@ static uint32_t SwapchainCurrentIndex = 0;
 static VkSemaphore* SwapchainUpdateSubmit;
 static Image SwapchainCurrentImage = NULL;
 static uint32_t SwapchainLength = 0;
+static VkExtent2D HeadlessExtent = { 0, 0 };
 
 static const char* kShaderMain = "main";
+static const char kInstanceInputPrefix[] = "instance_";
+static const uint64_t kHashSeed = 0xcbf29ce484222325ull;
+static const char* ShaderCacheDir = NULL;
 
 static const char* InstanceExt[MAX_INSTANCE_EXTENSIONS];
 static uint32_t NumInstanceExt = 0;
 
-static const char* DeviceExt[MAX_INSTANCE_EXTENSIONS];
+static const char* DeviceExt[MAX_DEVICE_EXTENSIONS];
 static uint32_t NumDeviceExt = 0;
 
 struct ShaderMacro
@@ -77,10 +110,33 @@ struct ShaderMacro
 static struct ShaderMacro ShaderMacros[MAX_SHADER_BINDINGS];
 static uint32_t NumShaderMacros = 0;
 
-struct DeviceQueueContext
+struct PendingCopy
+{
+	VkBuffer src;
+	VkBuffer dstBuffer;
+	VkImage dstImage;
+	VkBufferCopy bufferRegion;
+	VkBufferImageCopy imageRegion;
+};
+
+struct StagingFrame
+{
+	Buffer* tempBuffers;
+	uint32_t numTempBuffers;
+	uint64_t ringEnd;
+};
+
+struct TimestampFrame
+{
+	const char* names[MAX_TIMESTAMP_SCOPES];
+	uint32_t depths[MAX_TIMESTAMP_SCOPES];
+	VkQueryPool pool;
+	uint32_t numScopes;
+};
+
+// shadow of everything bound to the descriptor set, unbound slots stay zeroed so tuples compare bytewise
+struct DescriptorTuple
 {
-	VkImageMemoryBarrier imageBarriers[MAX_RESOURCE_BARRIERS];
-	VkBufferMemoryBarrier bufferBarriers[MAX_RESOURCE_BARRIERS];
 #if MAX_SAMPLER_STATES
 	VkDescriptorImageInfo samplerStates[MAX_SAMPLER_STATES];
 #endif
@@ -90,29 +146,240 @@ struct DeviceQueueContext
 #if MAX_SAMPLED_IMAGES
 	VkDescriptorImageInfo sampledImages[MAX_SAMPLED_IMAGES];
 #endif
-#if MAX_SHADER_BINDINGS
-	VkWriteDescriptorSet descriptorWrites[MAX_SHADER_BINDINGS];
-#else
-	VkWriteDescriptorSet* descriptorWrites;
+#if MAX_STORAGE_BUFFERS
+	VkDescriptorBufferInfo storageBuffers[MAX_STORAGE_BUFFERS];
+#endif
+#if MAX_STORAGE_IMAGES
+	VkDescriptorImageInfo storageImages[MAX_STORAGE_IMAGES];
+#endif
+	uint64_t bound;
+};
+
+struct DescriptorCacheEntry
+{
+	struct DescriptorTuple tuple;
+	uint64_t key;
+	VkDescriptorSet set;
+};
+
+struct DescriptorCache
+{
+	struct DescriptorCacheEntry* entries;
+	uint32_t* slots;
+	uint32_t numEntries;
+	uint32_t maxEntries;
+	uint32_t numSlots;
+};
+
+// pools are appended when the active one runs dry and are all reset together with their command buffer
+struct DescriptorPoolChain
+{
+	VkDescriptorPool* pools;
+	uint32_t numPools;
+	uint32_t activePool;
+	uint32_t numSets;
+};
+
+// binding state of one command buffer being recorded, the primary or a secondary on a worker thread
+struct RecordContext
+{
+	struct DescriptorTuple descriptors;
+#if MAX_UNIFORM_BUFFERS
+	uint32_t uniformOffsets[MAX_UNIFORM_BUFFERS];
 #endif
+	VkBuffer vertexBuffers[MAX_VERTEX_BUFFERS];
+	VkDeviceSize vertexOffsets[MAX_VERTEX_BUFFERS];
+	VkPipeline pipelines[2];
+	struct CommandStats stats;
+	struct DescriptorPoolChain* descriptorPools;
+	struct DescriptorCache* descriptorCache;
+	VkDescriptorSet descriptorSet;
+	VkBuffer indexBuffer;
+	VkDeviceSize indexOffset;
+	VkIndexType indexType;
+	uint32_t boundVertexBuffers;
+	uint32_t boundPoints;
+	bool descriptorsDirty;
+	bool offsetsDirty;
+	bool persistent;
+	bool incomplete;
+};
+
+struct SecondaryFrame
+{
+	VkCommandBuffer* cbHandle;
+	struct DescriptorPoolChain descriptorPools;
+	struct DescriptorCache descriptorCache;
+	uint32_t numHandles;
+	uint32_t numUsed;
+};
+
+// one per recording thread, owns its command pool so slots can record concurrently
+struct SecondaryContext
+{
+	struct RecordContext recorder;
+	VkCommandPool cmdPool;
+	struct SecondaryFrame* frames;
+	VkCommandBuffer pending;
+};
+
+struct OwnershipRelease
+{
+	VkBufferMemoryBarrier bufferBarriers[MAX_RESOURCE_BARRIERS];
+	VkImageMemoryBarrier imageBarriers[MAX_RESOURCE_BARRIERS];
+	VkCommandBuffer* cbHandle;
+	VkSemaphore* cbSemaphore;
+	uint32_t numBufferBarriers;
+	uint32_t numImageBarriers;
+};
+
+// what a buffer or image mip was last used for, useBuffer/useImage derive their barriers from it
+struct ResourceState
+{
+	VkPipelineStageFlags writeStages;
+	VkAccessFlags writeAccess;
+	VkPipelineStageFlags readStages;
+	VkPipelineStageFlags visibleStages;
+	VkAccessFlags visibleAccess;
+	VkImageLayout layout;
+};
+
+struct DeviceQueueContext
+{
+	struct PendingCopy pendingCopies[MAX_PENDING_COPIES];
+	struct OwnershipRelease releases[eDeviceQueue_EnumMax];
+	VkImageMemoryBarrier imageBarriers[MAX_RESOURCE_BARRIERS];
+	VkBufferMemoryBarrier bufferBarriers[MAX_RESOURCE_BARRIERS];
+	VkImageMemoryBarrier2KHR trackedImageBarriers[MAX_RESOURCE_BARRIERS];
+	VkBufferMemoryBarrier2KHR trackedBufferBarriers[MAX_RESOURCE_BARRIERS];
+	RenderPass passRenderPass;
+	Framebuffer passFramebuffer;
+	struct RecordContext recorder;
+	VkCommandBufferInheritanceInfo inheritance;
+	VkViewport passViewport;
+	VkRect2D passScissor;
 	VkQueueFlags requiredFlags;
 	VkQueueFlags excludedFlags;
 	VkCommandPool cmdPool;
 	VkCommandBuffer cmdBuffer;
 	VkCommandBuffer* cbHandle;
 	VkSemaphore* cbSemaphore;
-	VkDescriptorPool* cbDesc;
+	struct DescriptorPoolChain* cbDesc;
+	struct DescriptorCache* cbDescCache;
 	VkFence* cbFence;
 	VkSemaphore lastSubmit;
 	VkQueue queueHandle;
+	struct SecondaryContext* secondaries;
+	struct TimestampFrame* cbTimestamps;
+	struct GpuTiming timings[MAX_TIMESTAMP_SCOPES];
+	uint32_t openScopes[MAX_TIMESTAMP_SCOPES];
+	uint64_t timestampMask;
+	uint32_t numTimings;
+	uint32_t numOpenScopes;
+	Buffer transientRing;
+	SDL_atomic_t transientHead;
+	Buffer stagingRing;
+	struct StagingFrame* cbStaging;
+	uint64_t stagingHead;
+	uint64_t stagingTail;
+	uint32_t numPendingCopies;
+	bool parallelPass;
 	uint32_t numBufferBarriers;
 	uint32_t numImageBarriers;
-	uint32_t numDescriptorWrites;
+	uint32_t numTrackedBufferBarriers;
+	uint32_t numTrackedImageBarriers;
 	uint32_t numCommandBuffers;
 	uint32_t currentIndex;
 	uint32_t queueFamily;
+	uint32_t queueIndex;
+	uint32_t queueOwner;
+	SDL_mutex* queueLock;
 };
 
+#if WITH_TRACE
+// recorded vulkan-kit calls, appending keeps older traces replayable
+enum TraceOp
+{
+	eTraceOp_CreateVertexArray,
+	eTraceOp_CreateUniformBuffer,
+	eTraceOp_CreateStorageBuffer,
+	eTraceOp_CreateUploadBuffer,
+	eTraceOp_BufferContents,
+	eTraceOp_DestroyBuffer,
+	eTraceOp_CreateRenderTargetImage,
+	eTraceOp_CreateSampledImage,
+	eTraceOp_CreateStorageImage,
+	eTraceOp_DestroyImage,
+	eTraceOp_CreateSamplerState,
+	eTraceOp_DestroySamplerState,
+	eTraceOp_CreateRenderPass,
+	eTraceOp_SetRenderPassClearColor,
+	eTraceOp_SetRenderPassClearDepth,
+	eTraceOp_RenderPassColorTarget,
+	eTraceOp_RenderPassDepthStencilTarget,
+	eTraceOp_DestroyRenderPass,
+	eTraceOp_CreateFramebuffer,
+	eTraceOp_DestroyFramebuffer,
+	eTraceOp_ShaderSource,
+	eTraceOp_CreateGraphicsPipeline,
+	eTraceOp_CreateComputePipeline,
+	eTraceOp_SetGraphicsPipelineDepthTest,
+	eTraceOp_SetGraphicsPipelineFaceCulling,
+	eTraceOp_SetGraphicsPipelineVertexInput,
+	eTraceOp_SetGraphicsPipelineVertexFormat,
+	eTraceOp_SetPipelineFallback,
+	eTraceOp_CompilePipelineAsync,
+	eTraceOp_DestroyPipeline,
+	eTraceOp_BeginCommandBuffer,
+	eTraceOp_SubmitCommandBuffer,
+	eTraceOp_BufferMemoryBarrier,
+	eTraceOp_ImageMemoryBarrier,
+	eTraceOp_PipelineBarrier,
+	eTraceOp_UpdateBuffer,
+	eTraceOp_UpdateImageMipLevel,
+	eTraceOp_UploadImage,
+	eTraceOp_Blit,
+	eTraceOp_BeginRenderPass,
+	eTraceOp_BeginParallelRenderPass,
+	eTraceOp_EndRenderPass,
+	eTraceOp_BindSamplerState,
+	eTraceOp_BindUniformBuffer,
+	eTraceOp_BindUniformData,
+	eTraceOp_BindSampledImage,
+	eTraceOp_BindStorageBuffer,
+	eTraceOp_BindStorageImage,
+	eTraceOp_BindVertexBufferRange,
+	eTraceOp_BindIndexBufferRange,
+	eTraceOp_BindVertexData,
+	eTraceOp_BindIndexData,
+	eTraceOp_BindGraphicsPipeline,
+	eTraceOp_BindComputePipeline,
+	eTraceOp_DrawIndexed,
+	eTraceOp_DrawIndexedIndirect,
+	eTraceOp_DrawIndexedIndirectCount,
+	eTraceOp_DrawIndexedMulti,
+	eTraceOp_Dispatch,
+	eTraceOp_DispatchIndirect,
+	eTraceOp_BeginRecordingContext,
+	eTraceOp_EndRecordingContext,
+	eTraceOp_BeginGpuScope,
+	eTraceOp_EndGpuScope,
+	eTraceOp_CreateCommandBundle,
+	eTraceOp_BeginCommandBundle,
+	eTraceOp_EndCommandBundle,
+	eTraceOp_InvalidateCommandBundle,
+	eTraceOp_DestroyCommandBundle,
+	eTraceOp_PresentImageToWindow,
+	eTraceOp_UseBuffer,
+	eTraceOp_UseImage,
+	eTraceOp_CreateTransientImage,
+	eTraceOp_EnumMax
+};
+
+static FILE* TraceFile = NULL;
+static threadLocal uint32_t TraceSuspended = 0;
+#endif
+
 static struct DeviceQueueContext QueueContext[eDeviceQueue_EnumMax] = {
 	{.requiredFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT },
 	{.requiredFlags = VK_QUEUE_TRANSFER_BIT,.excludedFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT },
@@ -121,13 +388,32 @@ static struct DeviceQueueContext QueueContext[eDeviceQueue_EnumMax] = {
 
 static void initImage(Image, VkFormat, const VkExtent3D*, uint32_t, bool, bool);
 static uint32_t findMemoryType(const VkMemoryRequirements*, VkMemoryPropertyFlags, VkMemoryPropertyFlags, VkMemoryPropertyFlags);
-static VkShaderModule compileShader(VkShaderStageFlags, const char*, VkVertexInputAttributeDescription**, uint32_t*, uint32_t*);
+static uint64_t hashBytes(const void*, size_t, uint64_t);
+static VkShaderModule compileShader(VkShaderStageFlags, const char*, uint64_t*, VkVertexInputAttributeDescription**, uint32_t*);
 static const VkClearValue* getRenderPassClearValues(RenderPass, uint32_t*);
 static VkRenderPass getRenderPassHandle(RenderPass);
 static VkPipeline getPipelineHandle(Pipeline);
+static void loadPipelineCache(void);
+static void savePipelineCache(void);
+static void startPipelineCompiler(void);
+static void stopPipelineCompiler(void);
 static VkBuffer getBufferHandle(Buffer);
 static void destroySwapchain(bool);
+static void flushResourceBarriers(struct DeviceQueueContext*);
+static void beginTrackedRenderPass(struct DeviceQueueContext*, RenderPass, Framebuffer);
+static void endTrackedRenderPass(struct DeviceQueueContext*);
+#if WITH_TRACE
+static void writeTraceRecord(enum TraceOp, uint64_t, const uint64_t*, uint32_t, const void*, size_t);
+static void writeTraceDestroy(enum TraceOp, uint64_t);
+static void setTracePending(enum TraceOp, const uint64_t*, uint32_t, const void*, size_t);
+static void addTraceMappedBuffer(uint64_t, const void*, size_t);
+static uint64_t getTraceObject(uint64_t);
+static void writeTraceFramebuffer(uint64_t, RenderPass, const Image*, uint32_t);
+static void writeTracePipeline(enum TraceOp, uint64_t, const char*, VkShaderStageFlags, RenderPass);
+#endif
 
+#include "nullbackend.inl"
+#include "memory.inl"
 #include "buffer.inl"
 #include "image.inl"
 #include "sampler.inl"
@@ -137,55 +423,82 @@ static void destroySwapchain(bool);
 #include "swapchain.inl"
 #include "framebuff.inl"
 #include "pipeline.inl"
+#include "staging.inl"
+#include "descriptor.inl"
+#include "timestamps.inl"
+#include "profiler.inl"
 #include "cmdbuff.inl"
+#include "barriers.inl"
+#include "bundle.inl"
+#include "renderqueue.inl"
+#include "framegraph.inl"
+#include "trace.inl"
 
+// exclusions are only a preference, software devices expose a single type that has every flag
 uint32_t findMemoryType(const VkMemoryRequirements* reqs, VkMemoryPropertyFlags flags, VkMemoryPropertyFlags exclude, VkMemoryPropertyFlags maybe)
 {
-	VkPhysicalDeviceMemoryProperties props;
-	vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &props);
-	uint32_t retval = props.memoryTypeCount, fallback = retval;
+	const VkPhysicalDeviceMemoryProperties props = MemoryProperties;
+	uint32_t preferred = props.memoryTypeCount, allowed = preferred, fallback = preferred;
 	for (uint32_t i = 0; i < props.memoryTypeCount; i++)
 	{
 		const VkMemoryPropertyFlags typeFlags = props.memoryTypes[i].propertyFlags;
-		if ((reqs->memoryTypeBits & (1 << i)) && (typeFlags & flags) && !(typeFlags & exclude))
+		if (!(reqs->memoryTypeBits & (1u << i)) || (typeFlags & flags) != flags)
+		{
+			continue;
+		}
+		fallback = (fallback == props.memoryTypeCount) ? i : fallback;
+		if (!(typeFlags & exclude))
 		{
+			allowed = (allowed == props.memoryTypeCount) ? i : allowed;
 			if (typeFlags & maybe)
 			{
-				retval = fallback = i;
+				preferred = i;
 				break;
 			}
-			else if (fallback == props.memoryTypeCount)
-			{
-				fallback = i;
-			}
 		}
 	}
-	if (retval == props.memoryTypeCount)
-	{
-		retval = fallback;
-	}
+	const uint32_t retval = (preferred < props.memoryTypeCount) ? preferred : (allowed < props.memoryTypeCount) ? allowed : fallback;
 	breakIfNot(retval < props.memoryTypeCount);
 	return retval;
 }
 
+uint64_t hashBytes(const void* data, size_t bytes, uint64_t hash)
+{
+	const uint8_t* ptr = (const uint8_t*)data;
+	for (size_t i = 0; i < bytes; i++)
+	{
+		hash ^= ptr[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
 void requestWindowSurface(struct SDL_Window* window)
 {
 	Window = window;
-	InstanceExt[NumInstanceExt++] = VK_KHR_SURFACE_EXTENSION_NAME;
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
+	InstanceExt[NumInstanceExt++] = VK_KHR_SURFACE_EXTENSION_NAME;
 	InstanceExt[NumInstanceExt++] = VK_KHR_WIN32_SURFACE_EXTENSION_NAME;
 #else
-#error This platform is not supported yet
+	unsigned int numWindowExt = MAX_INSTANCE_EXTENSIONS - NumInstanceExt;
+	breakIfNot(SDL_Vulkan_GetInstanceExtensions(window, &numWindowExt, &InstanceExt[NumInstanceExt]));
+	NumInstanceExt += numWindowExt;
 #endif
 	DeviceExt[NumDeviceExt++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
 }
 
+void requestHeadlessSwapchain(uint32_t width, uint32_t height)
+{
+	// only the window surface adds extensions before createDevice, a display-less ICD may not have them
+	Window = NULL;
+	NumInstanceExt = 0;
+	NumDeviceExt = 0;
+	HeadlessExtent.width = width;
+	HeadlessExtent.height = height;
+}
+
 static void requestDeviceQueue(DeviceQueue queue, uint32_t numCommandBuffers, bool present)
 {
-	QueueContext[queue].cbDesc = calloc(numCommandBuffers, sizeof(VkDescriptorPool));
-	QueueContext[queue].cbHandle = calloc(numCommandBuffers, sizeof(VkCommandBuffer));
-	QueueContext[queue].cbSemaphore = calloc(numCommandBuffers, sizeof(VkSemaphore));
-	QueueContext[queue].cbFence = calloc(numCommandBuffers, sizeof(VkFence));
 	QueueContext[queue].numCommandBuffers = numCommandBuffers;
 	if (present)
 	{
@@ -198,6 +511,81 @@ void requestDefaultCommandQueue(uint32_t numCommandBuffers, bool present)
 	requestDeviceQueue(eDeviceQueue_Universal, numCommandBuffers, present);
 }
 
+void requestTransferCommandQueue(uint32_t numCommandBuffers)
+{
+	requestDeviceQueue(eDeviceQueue_Transfer, numCommandBuffers, false);
+}
+
+void requestComputeCommandQueue(uint32_t numCommandBuffers)
+{
+	requestDeviceQueue(eDeviceQueue_Compute, numCommandBuffers, false);
+}
+
+void requestShaderCache(const char* directory)
+{
+	ShaderCacheDir = directory;
+}
+
+void requestPipelineCache(const char* fileName)
+{
+	PipelineCacheFile = fileName;
+}
+
+void requestPipelineCompilerThreads(uint32_t numThreads)
+{
+	NumCompilerThreads = numThreads;
+}
+
+void requestPushDescriptors(bool enable)
+{
+	PushDescriptors = enable;
+}
+
+void requestDescriptorPoolSets(uint32_t setsPerPool)
+{
+	DescriptorPoolSets = setsPerPool;
+}
+
+void requestRecordingContexts(uint32_t numContexts)
+{
+	breakIfNot(numContexts <= MAX_RECORDING_CONTEXTS);
+	NumRecordingContexts = (numContexts < MAX_RECORDING_CONTEXTS) ? numContexts : MAX_RECORDING_CONTEXTS;
+}
+
+void requestGpuTimestamps(bool enable)
+{
+	GpuTimestamps = enable;
+}
+
+void requestSoftwareDevice(bool enable)
+{
+	SoftwareDevice = enable;
+}
+
+#if WITH_NULL_BACKEND
+void requestNullBackend(bool enable)
+{
+	NullBackend = enable;
+}
+#endif
+
+#if WITH_TRACE
+void requestApiTrace(const char* fileName)
+{
+	TraceFileName = fileName;
+}
+#endif
+
+void requestTransientMemory(size_t bytesPerFrame)
+{
+	TransientBytes = bytesPerFrame;
+}
+
+void requestStagingMemory(size_t bytes)
+{
+	StagingBytes = bytes;
+}
+
 void requestSwapchainColorTarget(VkFormat format)
 {
 	SwapchainColorTarget = format;
@@ -237,7 +625,7 @@ static int findQueueFamily(VkPhysicalDevice phd, const VkQueueFamilyProperties*
 			&& (qfs[i].queueFlags & ctx->requiredFlags) == ctx->requiredFlags
 			&& (qfs[i].queueFlags & ctx->excludedFlags) == 0)
 		{
-			if (present)
+			if (present && Surface != VK_NULL_HANDLE)
 			{
 				VkBool32 canPresent = VK_FALSE;
 				breakIfFailed(vkGetPhysicalDeviceSurfaceSupportKHR(phd, (uint32_t)i, Surface, &canPresent));
@@ -259,7 +647,7 @@ static int findQueueFamily(VkPhysicalDevice phd, const VkQueueFamilyProperties*
 
 void createDevice(void)
 {
-	breakIfFailed(volkInitialize());
+	breakIfFailed(initializeLoader());
 
 	const VkApplicationInfo app = {
 		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -287,7 +675,7 @@ void createDevice(void)
 		};
 		breakIfFailed(vkCreateWin32SurfaceKHR(Instance, &sci, Alloc, &Surface));
 #else
-#error Unsupported platform
+		breakIfNot(SDL_Vulkan_CreateSurface(Window, Instance, &Surface));
 #endif
 	}
 
@@ -296,8 +684,8 @@ void createDevice(void)
 	VkPhysicalDevice* physicalDevices = malloc(numPhysicalDevices * sizeof(VkPhysicalDevice));
 	breakIfFailed(vkEnumeratePhysicalDevices(Instance, &numPhysicalDevices, physicalDevices));
 
-	int discreet = -1, integrated = -1;
-	uint32_t qfDiscreet[eDeviceQueue_EnumMax], qfIntegrated[eDeviceQueue_EnumMax];
+	int discreet = -1, integrated = -1, software = -1;
+	uint32_t qfDiscreet[eDeviceQueue_EnumMax], qfIntegrated[eDeviceQueue_EnumMax], qfSoftware[eDeviceQueue_EnumMax];
 	for (uint32_t i = 0; i < numPhysicalDevices; i++)
 	{
 		int* storedIndex = NULL;
@@ -315,6 +703,11 @@ void createDevice(void)
 			storedQueues = qfDiscreet;
 			storedIndex = &discreet;
 		}
+		else if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU && software == -1)
+		{
+			storedQueues = qfSoftware;
+			storedIndex = &software;
+		}
 		else
 		{
 			continue;
@@ -338,6 +731,12 @@ void createDevice(void)
 			{
 				const bool present = (PresentQueue == i);
 				int familyIndex = findQueueFamily(physicalDevice, queueFamilies, numQueueFamilies, queueContext, present);
+				if (familyIndex == -1 && queueContext->excludedFlags)
+				{
+					// no dedicated family, share the first one that has the required capabilities
+					struct DeviceQueueContext shared = { .requiredFlags = queueContext->requiredFlags };
+					familyIndex = findQueueFamily(physicalDevice, queueFamilies, numQueueFamilies, &shared, present);
+				}
 				if (familyIndex > -1)
 				{
 					storedQueues[i] = (uint32_t)familyIndex;
@@ -353,12 +752,17 @@ void createDevice(void)
 		freeMem(queueFamilies);
 	}
 
-	static const float prio = 1.f;
+	static const float prio[eDeviceQueue_EnumMax] = { 1.f, 1.f, 1.f };
 	uint32_t numDqci = 0, *queueFamilyIndices = NULL;
 	VkDeviceQueueCreateInfo dqci[eDeviceQueue_EnumMax] = { 0 };
-	if (discreet == -1)
+	if ((discreet == -1 && integrated == -1) || (SoftwareDevice && software != -1))
+	{
+		breakIfNot(software != -1);
+		PhysicalDevice = physicalDevices[software];
+		queueFamilyIndices = qfSoftware;
+	}
+	else if (discreet == -1)
 	{
-		breakIfNot(integrated != -1);
 		PhysicalDevice = physicalDevices[integrated];
 		queueFamilyIndices = qfIntegrated;
 	}
@@ -370,34 +774,136 @@ void createDevice(void)
 
 	freeMem(physicalDevices);
 
-	for (uint32_t i = 0, j = 0; i < eDeviceQueue_EnumMax; i++)
+	uint32_t numQueueFamilies = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &numQueueFamilies, NULL);
+	VkQueueFamilyProperties* queueFamilies = calloc(numQueueFamilies, sizeof(VkQueueFamilyProperties));
+	breakIfNot(queueFamilies);
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &numQueueFamilies, queueFamilies);
+
+	// contexts sharing a family get their own queue while it has spare ones, otherwise they share a queue and its lock
+	uint32_t dqciOwner[eDeviceQueue_EnumMax];
+	for (uint32_t i = 0; i < eDeviceQueue_EnumMax; i++)
 	{
 		struct DeviceQueueContext* queueContext = &QueueContext[i];
 		if (queueContext->numCommandBuffers > 0)
 		{
-			VkDeviceQueueCreateInfo* info = &dqci[numDqci++];
-			info->sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-			info->queueFamilyIndex = queueFamilyIndices[j++];
-			info->queueCount = 1;
-			info->pQueuePriorities = &prio;
-			queueContext->queueFamily = info->queueFamilyIndex;
+			VkDeviceQueueCreateInfo* info = NULL;
+			queueContext->queueFamily = queueFamilyIndices[i];
+			queueContext->queueIndex = 0;
+			queueContext->queueOwner = i;
+			for (uint32_t j = 0; j < numDqci; j++)
+			{
+				info = (dqci[j].queueFamilyIndex == queueContext->queueFamily) ? &dqci[j] : info;
+			}
+			if (!info)
+			{
+				dqciOwner[numDqci] = i;
+				info = &dqci[numDqci++];
+				info->sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+				info->queueFamilyIndex = queueContext->queueFamily;
+				info->queueCount = 1;
+				info->pQueuePriorities = prio;
+			}
+			else if (info->queueCount < queueFamilies[queueContext->queueFamily].queueCount)
+			{
+				queueContext->queueIndex = info->queueCount++;
+			}
+			else
+			{
+				queueContext->queueOwner = dqciOwner[info - dqci];
+			}
+		}
+	}
+	freeMem(queueFamilies);
+
+	bool pushDescriptorsSupported = false;
+	bool synchronization2Supported = false;
+	uint32_t numExtensions = 0;
+	breakIfFailed(vkEnumerateDeviceExtensionProperties(PhysicalDevice, NULL, &numExtensions, NULL));
+	VkExtensionProperties* extensions = calloc(numExtensions, sizeof(VkExtensionProperties));
+	breakIfFailed(vkEnumerateDeviceExtensionProperties(PhysicalDevice, NULL, &numExtensions, extensions));
+	for (uint32_t i = 0; i < numExtensions; i++)
+	{
+		if (strcmp(extensions[i].extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0)
+		{
+			DrawIndirectCount = true;
+			DeviceExt[NumDeviceExt++] = VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME;
+		}
+		else if (strcmp(extensions[i].extensionName, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME) == 0)
+		{
+			pushDescriptorsSupported = true;
+		}
+		else if (strcmp(extensions[i].extensionName, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME) == 0)
+		{
+			synchronization2Supported = true;
+		}
+		else if (strcmp(extensions[i].extensionName, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) == 0 && GpuTimestamps && findHostTimeDomain())
+		{
+			CalibratedTimestamps = true;
+			DeviceExt[NumDeviceExt++] = VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME;
+		}
+	}
+	freeMem(extensions);
+
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(PhysicalDevice, &supportedFeatures);
+	const VkPhysicalDeviceFeatures features = {
+		.multiDrawIndirect = supportedFeatures.multiDrawIndirect,
+		.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance
+	};
+	MultiDrawIndirect = supportedFeatures.multiDrawIndirect;
+
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2 = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR };
+	if (synchronization2Supported)
+	{
+		VkPhysicalDeviceFeatures2 supportedFeatures2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &synchronization2
+		};
+		vkGetPhysicalDeviceFeatures2(PhysicalDevice, &supportedFeatures2);
+		Synchronization2 = synchronization2.synchronization2;
+	}
+	if (Synchronization2)
+	{
+		DeviceExt[NumDeviceExt++] = VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME;
+	}
+
+	PushDescriptors = PushDescriptors && pushDescriptorsSupported;
+	if (PushDescriptors)
+	{
+		VkPhysicalDevicePushDescriptorPropertiesKHR pushProperties = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR };
+		VkPhysicalDeviceProperties2 properties = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+			.pNext = &pushProperties
+		};
+		vkGetPhysicalDeviceProperties2(PhysicalDevice, &properties);
+		PushDescriptors = (pushProperties.maxPushDescriptors >= MAX_SHADER_BINDINGS);
+		if (PushDescriptors)
+		{
+			DeviceExt[NumDeviceExt++] = VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME;
 		}
 	}
 
 	VkDeviceCreateInfo dci = {
 		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = (Synchronization2) ? &synchronization2 : NULL,
 		.queueCreateInfoCount = numDqci,
 		.pQueueCreateInfos = dqci,
 		.enabledExtensionCount = NumDeviceExt,
-		.ppEnabledExtensionNames = DeviceExt
+		.ppEnabledExtensionNames = DeviceExt,
+		.pEnabledFeatures = &features
 	};
 	breakIfFailed(vkCreateDevice(PhysicalDevice, &dci, Alloc, &Device));
 	volkLoadDevice(Device);
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &DeviceProperties);
+	initMemoryAllocator();
+	loadPipelineCache();
+	startPipelineCompiler();
 
 	SwapchainRenderPass = createRenderPass(1, (SwapchainDepthBuffer != VK_FORMAT_UNDEFINED) ? 1 : 0);
 
 	getRenderPassColorTarget(SwapchainRenderPass, 0)->format = SwapchainColorTarget;
-	getRenderPassColorTarget(SwapchainRenderPass, 0)->finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	getRenderPassColorTarget(SwapchainRenderPass, 0)->finalLayout = (Surface != VK_NULL_HANDLE) ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 	if (SwapchainPreserve & VK_IMAGE_ASPECT_COLOR_BIT)
 	{
 		getRenderPassColorTarget(SwapchainRenderPass, 0)->loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
@@ -454,7 +960,7 @@ void createDevice(void)
 		macro->valLength = snprintf(macro->val, sizeof(macro->val), "%u", bindIndex);
 		VkDescriptorSetLayoutBinding* info = &bindings[bindIndex];
 		info->binding = bindIndex;
-		info->descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		info->descriptorType = (PushDescriptors) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		info->descriptorCount = 1;
 		info->stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 		++bindIndex;
@@ -473,9 +979,38 @@ void createDevice(void)
 		info->stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 		++bindIndex;
 	}
+#endif
+#if MAX_STORAGE_BUFFERS
+	for (uint32_t i = 0; i < MAX_STORAGE_BUFFERS; i++)
+	{
+		struct ShaderMacro* macro = &ShaderMacros[NumShaderMacros++];
+		macro->nameLength = snprintf(macro->name, sizeof(macro->name), "storage_buffer_%u", i);
+		macro->valLength = snprintf(macro->val, sizeof(macro->val), "%u", bindIndex);
+		VkDescriptorSetLayoutBinding* info = &bindings[bindIndex];
+		info->binding = bindIndex;
+		info->descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		info->descriptorCount = 1;
+		info->stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		++bindIndex;
+	}
+#endif
+#if MAX_STORAGE_IMAGES
+	for (uint32_t i = 0; i < MAX_STORAGE_IMAGES; i++)
+	{
+		struct ShaderMacro* macro = &ShaderMacros[NumShaderMacros++];
+		macro->nameLength = snprintf(macro->name, sizeof(macro->name), "storage_image_%u", i);
+		macro->valLength = snprintf(macro->val, sizeof(macro->val), "%u", bindIndex);
+		VkDescriptorSetLayoutBinding* info = &bindings[bindIndex];
+		info->binding = bindIndex;
+		info->descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		info->descriptorCount = 1;
+		info->stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		++bindIndex;
+	}
 #endif
 	VkDescriptorSetLayoutCreateInfo dslci = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.flags = (PushDescriptors) ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0,
 		.bindingCount = bindIndex,
 		.pBindings = bindings
 	};
@@ -495,34 +1030,43 @@ void createDevice(void)
 	breakIfFailed(vkCreatePipelineLayout(Device, &plci, Alloc, &PipelineLayout));
 
 	uint32_t numPoolSizes = 0;
-	VkDescriptorPoolSize poolSizes[16];
+	VkDescriptorPoolSize* poolSizes = DescriptorPoolSizes;
 #if MAX_SAMPLER_STATES
 	{
 		VkDescriptorPoolSize* ps = &poolSizes[numPoolSizes++];
 		ps->type = VK_DESCRIPTOR_TYPE_SAMPLER;
-		ps->descriptorCount = MAX_SAMPLER_STATES * MAX_DRAW_CALLS;
+		ps->descriptorCount = MAX_SAMPLER_STATES;
 	}
 #endif
 #if MAX_UNIFORM_BUFFERS
 	{
 		VkDescriptorPoolSize* ps = &poolSizes[numPoolSizes++];
-		ps->type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		ps->descriptorCount = MAX_UNIFORM_BUFFERS * MAX_DRAW_CALLS;
+		ps->type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		ps->descriptorCount = MAX_UNIFORM_BUFFERS;
 	}
 #endif
 #if MAX_SAMPLED_IMAGES
 	{
 		VkDescriptorPoolSize* ps = &poolSizes[numPoolSizes++];
 		ps->type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-		ps->descriptorCount = MAX_SAMPLED_IMAGES * MAX_DRAW_CALLS;
+		ps->descriptorCount = MAX_SAMPLED_IMAGES;
 	}
 #endif
-	VkDescriptorPoolCreateInfo dpci = {
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-		.maxSets = MAX_DRAW_CALLS,
-		.poolSizeCount = numPoolSizes,
-		.pPoolSizes = poolSizes
-	};
+#if MAX_STORAGE_BUFFERS
+	{
+		VkDescriptorPoolSize* ps = &poolSizes[numPoolSizes++];
+		ps->type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		ps->descriptorCount = MAX_STORAGE_BUFFERS;
+	}
+#endif
+#if MAX_STORAGE_IMAGES
+	{
+		VkDescriptorPoolSize* ps = &poolSizes[numPoolSizes++];
+		ps->type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		ps->descriptorCount = MAX_STORAGE_IMAGES;
+	}
+#endif
+	NumDescriptorPoolSizes = numPoolSizes;
 
 	for (int i = 0; i < eDeviceQueue_EnumMax; i++)
 	{
@@ -535,7 +1079,8 @@ void createDevice(void)
 				.queueFamilyIndex = queueContext->queueFamily
 			};
 			breakIfFailed(vkCreateCommandPool(Device, &cpci, Alloc, &queueContext->cmdPool));
-			queueContext->cbDesc = calloc(queueContext->numCommandBuffers, sizeof(VkDescriptorPool));
+			queueContext->cbDesc = calloc(queueContext->numCommandBuffers, sizeof(struct DescriptorPoolChain));
+			queueContext->cbDescCache = calloc(queueContext->numCommandBuffers, sizeof(struct DescriptorCache));
 			queueContext->cbHandle = calloc(queueContext->numCommandBuffers, sizeof(VkCommandBuffer));
 			queueContext->cbSemaphore = calloc(queueContext->numCommandBuffers, sizeof(VkSemaphore));
 			queueContext->cbFence = calloc(queueContext->numCommandBuffers, sizeof(VkFence));
@@ -546,7 +1091,12 @@ void createDevice(void)
 				.commandBufferCount = queueContext->numCommandBuffers
 			};
 			breakIfFailed(vkAllocateCommandBuffers(Device, &cbai, queueContext->cbHandle));
-			vkGetDeviceQueue(Device, queueContext->queueFamily, 0, &queueContext->queueHandle);
+			vkGetDeviceQueue(Device, queueContext->queueFamily, queueContext->queueIndex, &queueContext->queueHandle);
+			if (queueContext->queueOwner == (uint32_t)i)
+			{
+				queueContext->queueLock = SDL_CreateMutex();
+				breakIfNot(queueContext->queueLock);
+			}
 			for (uint32_t j = 0; j < queueContext->numCommandBuffers; j++)
 			{
 				VkFenceCreateInfo fci = {
@@ -556,13 +1106,46 @@ void createDevice(void)
 				VkSemaphoreCreateInfo sci = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
 				breakIfFailed(vkCreateSemaphore(Device, &sci, Alloc, &queueContext->cbSemaphore[j]));
 				breakIfFailed(vkCreateFence(Device, &fci, Alloc, &queueContext->cbFence[j]));
-				if ((queueContext->requiredFlags & VK_QUEUE_GRAPHICS_BIT) || (queueContext->requiredFlags & VK_QUEUE_COMPUTE_BIT))
+				if (((queueContext->requiredFlags & VK_QUEUE_GRAPHICS_BIT) || (queueContext->requiredFlags & VK_QUEUE_COMPUTE_BIT)) && !PushDescriptors)
 				{
-					breakIfFailed(vkCreateDescriptorPool(Device, &dpci, Alloc, &queueContext->cbDesc[j]));
+					addDescriptorPool(&queueContext->cbDesc[j]);
 				}
 			}
+			if (((queueContext->requiredFlags & VK_QUEUE_GRAPHICS_BIT) || (queueContext->requiredFlags & VK_QUEUE_COMPUTE_BIT)) && TransientBytes)
+			{
+				const VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+				queueContext->transientRing = createBuffer(TransientBytes, usage, (DeviceQueue)i, true);
+			}
+			if (GpuTimestamps)
+			{
+				createTimestampQueries(queueContext);
+			}
+			if ((queueContext->requiredFlags & VK_QUEUE_GRAPHICS_BIT) && NumRecordingContexts)
+			{
+				queueContext->secondaries = calloc(NumRecordingContexts, sizeof(struct SecondaryContext));
+				breakIfNot(queueContext->secondaries);
+				for (uint32_t j = 0; j < NumRecordingContexts; j++)
+				{
+					struct SecondaryContext* secondary = &queueContext->secondaries[j];
+					breakIfFailed(vkCreateCommandPool(Device, &cpci, Alloc, &secondary->cmdPool));
+					secondary->frames = calloc(queueContext->numCommandBuffers, sizeof(struct SecondaryFrame));
+					breakIfNot(secondary->frames);
+				}
+			}
+			queueContext->cbStaging = calloc(queueContext->numCommandBuffers, sizeof(struct StagingFrame));
+			breakIfNot(queueContext->cbStaging);
+			if (StagingBytes)
+			{
+				queueContext->stagingRing = createBuffer(StagingBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, eDeviceQueue_Invalid, true);
+			}
 		}
 	}
+	startApiTrace();
+}
+
+void getDeviceProperties(VkPhysicalDeviceProperties* properties)
+{
+	vkGetPhysicalDeviceProperties(PhysicalDevice, properties);
 }
 
 void deviceWaitIdle(void)
@@ -572,6 +1155,10 @@ void deviceWaitIdle(void)
 
 void destroyDevice(void)
 {
+	stopApiTrace();
+	releaseShaderCompiler();
+	stopPipelineCompiler();
+	savePipelineCache();
 	destroySwapchain(false);
 	destroyRenderPass(SwapchainRenderPass);
 	vkDestroyPipelineLayout(Device, PipelineLayout, Alloc);
@@ -581,12 +1168,51 @@ void destroyDevice(void)
 		struct DeviceQueueContext* queueContext = &QueueContext[i];
 		if (queueContext->numCommandBuffers > 0)
 		{
+			if (queueContext->transientRing)
+			{
+				destroyBuffer(queueContext->transientRing);
+				queueContext->transientRing = NULL;
+			}
+			releaseStaging(queueContext);
+			releaseTimestampQueries(queueContext);
+			for (uint32_t j = 0; queueContext->secondaries && j < NumRecordingContexts; j++)
+			{
+				struct SecondaryContext* secondary = &queueContext->secondaries[j];
+				for (uint32_t k = 0; k < queueContext->numCommandBuffers; k++)
+				{
+					releaseDescriptorPools(&secondary->frames[k].descriptorPools);
+					releaseDescriptorCache(&secondary->frames[k].descriptorCache);
+					freeMem(secondary->frames[k].cbHandle);
+				}
+				vkDestroyCommandPool(Device, secondary->cmdPool, Alloc);
+				freeMem(secondary->frames);
+			}
+			freeMem(queueContext->secondaries);
+			for (int j = 0; j < eDeviceQueue_EnumMax; j++)
+			{
+				struct OwnershipRelease* release = &queueContext->releases[j];
+				for (uint32_t k = 0; release->cbSemaphore && k < queueContext->numCommandBuffers; k++)
+				{
+					vkDestroySemaphore(Device, release->cbSemaphore[k], Alloc);
+				}
+				freeMem(release->cbSemaphore);
+				freeMem(release->cbHandle);
+			}
 			vkDestroyCommandPool(Device, queueContext->cmdPool, Alloc);
+			if (queueContext->queueLock)
+			{
+				SDL_DestroyMutex(queueContext->queueLock);
+				queueContext->queueLock = NULL;
+			}
 			for (uint32_t j = 0; j < queueContext->numCommandBuffers; j++)
 			{
 				if (queueContext->cbDesc)
 				{
-					vkDestroyDescriptorPool(Device, queueContext->cbDesc[j], Alloc);
+					releaseDescriptorPools(&queueContext->cbDesc[j]);
+				}
+				if (queueContext->cbDescCache)
+				{
+					releaseDescriptorCache(&queueContext->cbDescCache[j]);
 				}
 				if (queueContext->cbSemaphore)
 				{
@@ -598,11 +1224,14 @@ void destroyDevice(void)
 				}
 			}
 			freeMem(queueContext->cbDesc);
+			freeMem(queueContext->cbDescCache);
 			freeMem(queueContext->cbHandle);
 			freeMem(queueContext->cbSemaphore);
 			freeMem(queueContext->cbFence);
 		}
 	}
+	releaseMemoryAllocator();
+	releaseProfiler();
 	vkDestroyDevice(Device, Alloc);
 	if (Surface)
 	{
@@ -24,6 +24,23 @@ enum DeviceQueueT
 	eDeviceQueue_EnumMax
 };
 
+enum ResourceUsageT
+{
+	eResourceUsage_TransferSrc,
+	eResourceUsage_TransferDst,
+	eResourceUsage_VertexBuffer,
+	eResourceUsage_IndexBuffer,
+	eResourceUsage_IndirectBuffer,
+	eResourceUsage_UniformBuffer,
+	eResourceUsage_VertexShaderRead,
+	eResourceUsage_FragmentShaderRead,
+	eResourceUsage_ComputeShaderRead,
+	eResourceUsage_ComputeShaderWrite,
+	eResourceUsage_ColorTarget,
+	eResourceUsage_DepthStencilTarget,
+	eResourceUsage_EnumMax
+};
+
 struct SDL_Window;
 
 typedef VkSampler SamplerState;
@@ -32,10 +49,102 @@ typedef struct BufferT* Buffer;
 typedef struct PipelineT* Pipeline;
 typedef struct RenderPassT* RenderPass;
 typedef struct FramebufferT* Framebuffer;
+typedef struct RenderQueueT* RenderQueue;
+typedef struct CommandBundleT* CommandBundle;
+typedef struct FrameGraphT* FrameGraph;
 typedef enum DeviceQueueT DeviceQueue;
+typedef enum ResourceUsageT ResourceUsage;
+
+struct MemoryStats
+{
+	uint64_t blockBytes;
+	uint64_t usedBytes;
+	uint64_t dedicatedBytes;
+	uint32_t numBlocks;
+	uint32_t numAllocations;
+	uint32_t numDedicated;
+};
+
+struct CommandStats
+{
+	uint64_t pipelineBinds;
+	uint64_t skippedPipelineBinds;
+	uint64_t vertexBufferBinds;
+	uint64_t skippedVertexBufferBinds;
+	uint64_t indexBufferBinds;
+	uint64_t skippedIndexBufferBinds;
+	uint64_t descriptorBinds;
+	uint64_t skippedDescriptorBinds;
+	uint64_t descriptorSetBinds;
+	uint64_t draws;
+	uint64_t indirectDraws;
+	uint64_t dispatches;
+	uint64_t fenceWaits;
+	uint64_t fenceWaitUs;
+};
+
+struct DrawPacket
+{
+	Pipeline pipeline;
+	const void* material;
+	Buffer vertexBuffers[MAX_VERTEX_BUFFERS];
+	size_t vertexOffsets[MAX_VERTEX_BUFFERS];
+	Buffer indexBuffer;
+	size_t indexOffset;
+	VkIndexType indexType;
+	uint32_t numIndices;
+	uint32_t numInstances;
+	uint32_t firstIndex;
+	uint32_t firstVertex;
+	uint32_t firstInstance;
+	uint32_t layer;
+	float depth;
+};
+
+struct GpuTiming
+{
+	const char* name;
+	double beginMs;
+	double durationMs;
+	DeviceQueue queue;
+	uint32_t depth;
+};
+
+struct DescriptorStats
+{
+	uint32_t numPools;
+	uint32_t setsPerPool;
+	uint32_t lastFrameSets;
+	uint32_t peakFrameSets;
+	uint32_t numGrowths;
+};
+
+struct FrameGraphStats
+{
+	uint64_t transientBytes;
+	uint64_t unaliasedBytes;
+	uint32_t numPasses;
+	uint32_t numCulledPasses;
+	uint32_t numTransients;
+	uint32_t numMemorySlots;
+	uint32_t numBuilds;
+};
 
 void requestWindowSurface(struct SDL_Window* window);
+void requestHeadlessSwapchain(uint32_t width, uint32_t height);
 void requestDefaultCommandQueue(uint32_t numCommandBuffers, bool present);
+void requestTransferCommandQueue(uint32_t numCommandBuffers);
+void requestComputeCommandQueue(uint32_t numCommandBuffers);
+void requestShaderCache(const char* directory);
+void requestPipelineCache(const char* fileName);
+void requestPipelineCompilerThreads(uint32_t numThreads);
+void requestPushDescriptors(bool enable);
+void requestDescriptorPoolSets(uint32_t setsPerPool);
+void requestRecordingContexts(uint32_t numContexts);
+void requestGpuTimestamps(bool enable);
+void requestSoftwareDevice(bool enable);
+void requestTransientMemory(size_t bytesPerFrame);
+void requestStagingMemory(size_t bytes);
 void requestSwapchainColorTarget(VkFormat format);
 void requestSwapchainDepthBuffer(VkFormat format);
 void requestPresentMode(VkPresentModeKHR presentMode);
@@ -47,6 +156,13 @@ void createDevice(void);
 void resetSwapchain(void);
 void deviceWaitIdle(void);
 void destroyDevice(void);
+void getMemoryStats(struct MemoryStats* stats);
+void getDeviceProperties(VkPhysicalDeviceProperties* properties);
+void getDescriptorStats(struct DescriptorStats* stats);
+void getCommandStats(struct CommandStats* stats);
+uint32_t getGpuTimings(DeviceQueue queue, struct GpuTiming* timings, uint32_t maxTimings);
+void startGpuTrace(void);
+void stopGpuTrace(const char* fileName);
 
 RenderPass createRenderPass(uint32_t numColor, uint32_t numDepth);
 void setRenderPassClearColor(RenderPass renderPass, uint32_t colorTarget, const float value[4]);
@@ -62,17 +178,25 @@ Framebuffer getSwapchainFramebuffer(void);
 
 Buffer createVertexArray(size_t bytes, DeviceQueue queue);
 Buffer createUniformBuffer(size_t bytes, DeviceQueue queue);
+Buffer createStorageBuffer(size_t bytes, DeviceQueue queue);
 Buffer createUploadBuffer(size_t bytes, DeviceQueue queue);
 void* getBufferMappedPtr(Buffer buffer);
 void destroyBuffer(Buffer buffer);
 
 Image createRenderTargetImage(VkFormat format, const VkExtent3D* size);
 Image createSampledImage(VkFormat format, const VkExtent3D* size, uint32_t numMips);
+Image createStorageImage(VkFormat format, const VkExtent3D* size, uint32_t numMips);
 void destroyImage(Image image);
 
 Pipeline createGraphicsPipeline(const char* shaderFile, VkShaderStageFlags stageFlags, RenderPass renderPass);
+Pipeline createComputePipeline(const char* shaderFile);
 void setGraphicsPipelineDepthTest(Pipeline pipeline, bool write, bool test, VkCompareOp compareOp);
 void setGraphicsPipelineFaceCulling(Pipeline pipeline, VkCullModeFlags mode);
+void setGraphicsPipelineVertexInput(Pipeline pipeline, uint32_t location, uint32_t binding, VkVertexInputRate rate);
+void setGraphicsPipelineVertexFormat(Pipeline pipeline, uint32_t location, VkFormat format);
+void setPipelineFallback(Pipeline pipeline, Pipeline fallback);
+void compilePipelineAsync(Pipeline pipeline);
+bool isPipelineReady(Pipeline pipeline);
 void destroyPipeline(Pipeline pipeline);
 
 SamplerState createSamplerState(VkFilter minMag, VkSamplerMipmapMode mipMode, VkSamplerAddressMode addressMode);
@@ -83,21 +207,85 @@ void submitCommandBuffer(DeviceQueue queue, bool useSwapchainImage);
 void bufferMemoryBarrier(Buffer buffer, VkAccessFlags from, VkAccessFlags to);
 void imageMemoryBarrier(Image image, VkImageLayout fromLayout, VkAccessFlags fromAccess, VkImageLayout toLayout, VkAccessFlags toAccess, ImageSubset subset);
 void pipelineBarrier(VkPipelineStageFlags from, VkPipelineStageFlags to);
+void useBuffer(Buffer buffer, ResourceUsage usage);
+void useImage(Image image, ResourceUsage usage, ImageSubset subset);
 void updateBuffer(Buffer buffer, const void* data, size_t dstOffset, size_t bytes);
 void updateImageMipLevel(Buffer src, Image dst, uint32_t mipLevel);
+void uploadImage(Image dst, uint32_t mipLevel, const void* data, size_t bytes);
 void blit(Image src, Image dst, ImageSubset srcSubset, ImageSubset dstSubset);
 void beginRenderPass(RenderPass renderPass, Framebuffer framebuffer);
+void beginParallelRenderPass(RenderPass renderPass, Framebuffer framebuffer);
 void bindSamplerState(uint32_t binding, SamplerState sampler);
 void bindUniformBuffer(uint32_t binding, Buffer buffer);
+void* bindUniformData(uint32_t binding, size_t bytes);
 void bindSampledImage(uint32_t binding, Image image);
+void bindStorageBuffer(uint32_t binding, Buffer buffer);
+void bindStorageImage(uint32_t binding, Image image);
 void bindVertexBufferRange(uint32_t binding, Buffer buffer, size_t offset);
 void bindIndexBufferRange(VkIndexType indexType, Buffer buffer, size_t offset);
+void* bindVertexData(uint32_t binding, size_t bytes);
+void* bindIndexData(VkIndexType indexType, size_t bytes);
 void bindGraphicsPipeline(Pipeline pipeline);
 void drawIndexed(uint32_t numIndices, uint32_t numInstances, uint32_t firstIndex, uint32_t firstVertex, uint32_t firstInstance);
+void drawIndexedIndirect(Buffer buffer, size_t offset, uint32_t numDraws);
+void drawIndexedIndirectCount(Buffer buffer, size_t offset, Buffer countBuffer, size_t countOffset, uint32_t maxDraws);
+void drawIndexedMulti(const VkDrawIndexedIndirectCommand* draws, uint32_t numDraws);
+void bindComputePipeline(Pipeline pipeline);
+void dispatch(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ);
+void dispatchIndirect(Buffer buffer, size_t offset);
 void endRenderPass(void);
+void beginRecordingContext(uint32_t context);
+void endRecordingContext(void);
+void beginGpuScope(const char* name);
+void endGpuScope(void);
+CommandBundle createCommandBundle(DeviceQueue queue);
+bool beginCommandBundle(CommandBundle bundle);
+void endCommandBundle(CommandBundle bundle);
+void invalidateCommandBundle(CommandBundle bundle);
+void destroyCommandBundle(CommandBundle bundle);
+
+RenderQueue createRenderQueue(void (*bindMaterial)(const void* material));
+void setRenderQueueLayerOrder(RenderQueue queue, uint32_t layer, bool backToFront);
+void addDrawPacket(RenderQueue queue, const struct DrawPacket* packet);
+void submitRenderQueue(RenderQueue queue);
+void destroyRenderQueue(RenderQueue queue);
+
+FrameGraph createFrameGraph(void);
+uint32_t addFrameGraphTarget(FrameGraph graph, VkFormat format, const VkExtent3D* size);
+uint32_t importFrameGraphImage(FrameGraph graph, Image image);
+uint32_t importFrameGraphSwapchain(FrameGraph graph);
+void setFrameGraphClearColor(FrameGraph graph, uint32_t target, const float value[4]);
+void setFrameGraphClearDepth(FrameGraph graph, uint32_t target, float value);
+void setFrameGraphOutput(FrameGraph graph, uint32_t target);
+uint32_t addFrameGraphPass(FrameGraph graph, const char* name, void (*execute)(void* userData), void* userData);
+void useFrameGraphTarget(FrameGraph graph, uint32_t pass, uint32_t target, ResourceUsage usage);
+void enableFrameGraphPass(FrameGraph graph, uint32_t pass, bool enable);
+RenderPass getFrameGraphRenderPass(FrameGraph graph, uint32_t pass);
+Image getFrameGraphImage(FrameGraph graph, uint32_t target);
+void executeFrameGraph(FrameGraph graph);
+void getFrameGraphStats(FrameGraph graph, struct FrameGraphStats* stats);
+void destroyFrameGraph(FrameGraph graph);
 
 void presentImageToWindow(void);
 
+#if WITH_NULL_BACKEND
+void requestNullBackend(bool enable);
+#endif
+
+#if WITH_PROFILER
+void beginProfileZone(const char* name);
+void endProfileZone(void);
+void startProfilerCapture(void);
+void stopProfilerCapture(const char* fileName);
+#endif
+
+#if WITH_TRACE
+void requestApiTrace(const char* fileName);
+bool loadApiTrace(const char* fileName, const char* shaderDirectory);
+bool replayApiTraceFrame(void);
+void unloadApiTrace(void);
+#endif
+
 #if WITH_RENDERDOC
 void renderDocStartCapture(void);
 void renderDocEndCapture(void);
@@ -0,0 +1,43 @@
+#version 460
+
+#ifdef VERTEX
+
+layout(location=0) in vec3 aPosition;
+
+layout(location=0) out vec3 vNormal;
+
+layout(binding=uniform_buffer_0) uniform Camera
+{
+	mat4 uViewProj;
+	vec4 uGrid; // size, spacing, radius
+};
+
+void main()
+{
+	int size = int(uGrid.x);
+	vec3 cell = vec3(gl_InstanceIndex % size, 0., gl_InstanceIndex / size) - vec3(size - 1, 0., size - 1) * 0.5;
+	vNormal = aPosition;
+	gl_Position = uViewProj * vec4(aPosition * uGrid.z + cell * uGrid.y, 1.);
+	gl_Position.y = -gl_Position.y;
+}
+
+#endif
+
+#ifdef FRAGMENT
+
+layout(location=0) in vec3 vNormal;
+
+layout(location=0) out vec4 oColor;
+
+layout(binding=uniform_buffer_1) uniform Material
+{
+	vec4 uColor;
+};
+
+void main()
+{
+	float light = max(dot(normalize(vNormal), normalize(vec3(1., 2., 1.))), 0.);
+	oColor = vec4(uColor.rgb * (light * 0.8 + 0.2), 1.);
+}
+
+#endif
@@ -0,0 +1,493 @@
+#define HAVE_M_PI
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+#include <vulkan-kit/vkk.h>
+#include <shared/geometry.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+usage: benchmark [options]
+	--frames N        measured frames per scene (500)
+	--warmup N        frames rendered before measuring each scene (30)
+	--scene name      run only this scene
+	--output file     write the results there instead of stdout
+	--baseline file   compare with an earlier output, exits with 1 on regression
+	--tolerance x     relative slowdown of p50/p95 times that counts as a regression (0.1)
+
+Scenes render headless and prefer the software device, point VK_ICD_FILENAMES
+at a single ICD (lavapipe, swiftshader) to get the same device on every machine.
+Results name the device they ran on, a baseline from another device is refused.
+*/
+
+#define GRID_SIZE 16
+#define NUM_OBJECTS (GRID_SIZE * GRID_SIZE)
+#define NUM_MATERIALS 8
+
+enum MetricT
+{
+	eMetric_CpuMs,
+	eMetric_GpuMs,
+	eMetric_FenceWaitMs,
+	eMetric_Draws,
+	eMetric_DescriptorBinds,
+	eMetric_EnumMax
+};
+
+static const char* kMetricNames[eMetric_EnumMax] = {
+	"cpuMs",
+	"gpuMs",
+	"fenceWaitMs",
+	"draws",
+	"descriptorBinds"
+};
+
+static const double kPercentiles[] = { 0.5, 0.95, 0.99 };
+static const char* kPercentileNames[] = { "p50", "p95", "p99" };
+
+// timings closer than this to the baseline are noise, not a regression
+static const double kMinRegressionMs = 0.05;
+
+static const float kMaterials[NUM_MATERIALS][4] = {
+	{ 0.9f, 0.2f, 0.2f, 1.f },
+	{ 0.2f, 0.9f, 0.2f, 1.f },
+	{ 0.2f, 0.2f, 0.9f, 1.f },
+	{ 0.9f, 0.9f, 0.2f, 1.f },
+	{ 0.9f, 0.2f, 0.9f, 1.f },
+	{ 0.2f, 0.9f, 0.9f, 1.f },
+	{ 0.9f, 0.9f, 0.9f, 1.f },
+	{ 0.5f, 0.5f, 0.5f, 1.f }
+};
+
+struct CameraData
+{
+	mat4 viewProj;
+	vec4 grid;
+};
+
+struct Scene
+{
+	const char* name;
+	void (*draw)(void);
+};
+
+struct SceneResult
+{
+	double values[eMetric_EnumMax][_countof(kPercentiles)];
+};
+
+static RenderPass ScenePass = NULL;
+static Pipeline ScenePipeline = NULL;
+static RenderQueue SceneQueue = NULL;
+static Buffer SphereData = NULL;
+static Mesh Sphere = NULL;
+static struct CameraData Camera;
+
+static void bindCamera(void)
+{
+	memcpy(bindUniformData(0, sizeof(Camera)), &Camera, sizeof(Camera));
+}
+
+static void bindSphere(void)
+{
+	bindVertexBufferRange(0, SphereData, 0);
+	bindIndexBufferRange(Sphere->indexType, SphereData, Sphere->indexDataOffset);
+}
+
+static void bindMaterial(const void* material)
+{
+	memcpy(bindUniformData(1, sizeof(kMaterials[0])), material, sizeof(kMaterials[0]));
+}
+
+static void drawClear(void)
+{
+}
+
+// one draw and one material per object, materials change on every draw
+static void drawSpheres(void)
+{
+	bindGraphicsPipeline(ScenePipeline);
+	bindCamera();
+	bindSphere();
+	for (uint32_t i = 0; i < NUM_OBJECTS; i++)
+	{
+		bindMaterial(kMaterials[i % NUM_MATERIALS]);
+		drawIndexed(Sphere->indexCount, 1, 0, 0, i);
+	}
+}
+
+// the same draws sorted by the render queue, materials change once per material
+static void drawRenderQueue(void)
+{
+	bindCamera();
+	for (uint32_t i = 0; i < NUM_OBJECTS; i++)
+	{
+		const struct DrawPacket packet = {
+			.pipeline = ScenePipeline,
+			.material = kMaterials[i % NUM_MATERIALS],
+			.vertexBuffers = { SphereData },
+			.indexBuffer = SphereData,
+			.indexOffset = Sphere->indexDataOffset,
+			.indexType = Sphere->indexType,
+			.numIndices = Sphere->indexCount,
+			.numInstances = 1,
+			.firstInstance = i,
+			.depth = (float)(NUM_OBJECTS - i)
+		};
+		addDrawPacket(SceneQueue, &packet);
+	}
+	submitRenderQueue(SceneQueue);
+}
+
+static void drawInstanced(void)
+{
+	bindGraphicsPipeline(ScenePipeline);
+	bindCamera();
+	bindSphere();
+	bindMaterial(kMaterials[0]);
+	drawIndexed(Sphere->indexCount, NUM_OBJECTS, 0, 0, 0);
+}
+
+static const struct Scene kScenes[] = {
+	{ "clear", drawClear },
+	{ "spheres", drawSpheres },
+	{ "render-queue", drawRenderQueue },
+	{ "instanced", drawInstanced }
+};
+
+static double getElapsedMs(uint64_t start, uint64_t end)
+{
+	return (double)(end - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+// cpu time excludes the fence wait, gpu time lags behind by the number of frames in flight
+static void runFrame(const struct Scene* scene, double* sample)
+{
+	struct CommandStats before, after;
+	struct GpuTiming timing = { .durationMs = 0.0 };
+	getCommandStats(&before);
+	const uint64_t start = SDL_GetPerformanceCounter();
+
+	beginCommandBuffer(eDeviceQueue_Universal);
+	getGpuTimings(eDeviceQueue_Universal, &timing, 1);
+	beginGpuScope(scene->name);
+	beginRenderPass(ScenePass, getSwapchainFramebuffer());
+	scene->draw();
+	endRenderPass();
+	endGpuScope();
+	submitCommandBuffer(eDeviceQueue_Universal, true);
+	presentImageToWindow();
+
+	const uint64_t end = SDL_GetPerformanceCounter();
+	getCommandStats(&after);
+	const double fenceWaitMs = (double)(after.fenceWaitUs - before.fenceWaitUs) * 1e-3;
+	sample[eMetric_CpuMs] = getElapsedMs(start, end) - fenceWaitMs;
+	sample[eMetric_GpuMs] = timing.durationMs;
+	sample[eMetric_FenceWaitMs] = fenceWaitMs;
+	sample[eMetric_Draws] = (double)(after.draws - before.draws);
+	sample[eMetric_DescriptorBinds] = (double)(after.descriptorBinds - before.descriptorBinds);
+}
+
+static int compareDoubles(const void* a, const void* b)
+{
+	const double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+static void runScene(const struct Scene* scene, uint32_t numWarmup, uint32_t numFrames, double* samples, struct SceneResult* result)
+{
+	double sample[eMetric_EnumMax];
+	for (uint32_t i = 0; i < numWarmup; i++)
+	{
+		runFrame(scene, sample);
+	}
+	for (uint32_t i = 0; i < numFrames; i++)
+	{
+		runFrame(scene, sample);
+		for (uint32_t j = 0; j < eMetric_EnumMax; j++)
+		{
+			samples[j * numFrames + i] = sample[j];
+		}
+	}
+
+	// nearest rank
+	for (uint32_t j = 0; j < eMetric_EnumMax; j++)
+	{
+		double* values = samples + j * numFrames;
+		qsort(values, numFrames, sizeof(double), compareDoubles);
+		for (uint32_t k = 0; k < _countof(kPercentiles); k++)
+		{
+			uint32_t rank = (uint32_t)SDL_ceil(kPercentiles[k] * (double)numFrames);
+			result->values[j][k] = values[(rank > 0) ? rank - 1 : 0];
+		}
+	}
+}
+
+static void writeResults(FILE* file, const char* device, const struct SceneResult* results, const bool* selected, uint32_t numFrames)
+{
+	bool first = true;
+	fprintf(file, "{\n\t\"device\": \"%s\",\n\t\"frames\": %u,\n\t\"scenes\": {", device, numFrames);
+	for (uint32_t i = 0; i < _countof(kScenes); i++)
+	{
+		if (!selected[i])
+		{
+			continue;
+		}
+		fprintf(file, "%s\n\t\t\"%s\": {", first ? "" : ",", kScenes[i].name);
+		for (uint32_t j = 0; j < eMetric_EnumMax; j++)
+		{
+			fprintf(file, "%s\n\t\t\t\"%s\": { ", j ? "," : "", kMetricNames[j]);
+			for (uint32_t k = 0; k < _countof(kPercentiles); k++)
+			{
+				fprintf(file, "%s\"%s\": %.4f", k ? ", " : "", kPercentileNames[k], results[i].values[j][k]);
+			}
+			fprintf(file, " }");
+		}
+		fprintf(file, "\n\t\t}");
+		first = false;
+	}
+	fprintf(file, "\n\t}\n}\n");
+}
+
+static char* readTextFile(const char* fileName)
+{
+	FILE* file = fopen(fileName, "rb");
+	if (!file)
+	{
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* retval = (size > 0) ? malloc((size_t)size + 1) : NULL;
+	if (retval)
+	{
+		const size_t bytes = fread(retval, 1, (size_t)size, file);
+		retval[bytes] = '\0';
+	}
+	fclose(file);
+	return retval;
+}
+
+// the baseline is an earlier output of writeResults, so keys appear in a known order
+static bool findBaselineValue(const char* text, const char* scene, uint32_t metric, uint32_t percentile, double* value)
+{
+	char key[64];
+	snprintf(key, sizeof(key), "\"%s\":", scene);
+	const char* pos = strstr(text, key);
+	snprintf(key, sizeof(key), "\"%s\":", kMetricNames[metric]);
+	pos = (pos) ? strstr(pos, key) : NULL;
+	snprintf(key, sizeof(key), "\"%s\":", kPercentileNames[percentile]);
+	pos = (pos) ? strstr(pos, key) : NULL;
+	return pos && sscanf(pos + strlen(key), "%lf", value) == 1;
+}
+
+// timings from another device say nothing about a regression
+static bool isSameDevice(const char* text, const char* device)
+{
+	char key[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE + 16];
+	snprintf(key, sizeof(key), "\"device\": \"%s\"", device);
+	return strstr(text, key) != NULL;
+}
+
+static uint32_t compareWithBaseline(const char* text, const struct SceneResult* results, const bool* selected, double tolerance)
+{
+	uint32_t retval = 0;
+	for (uint32_t i = 0; i < _countof(kScenes); i++)
+	{
+		for (uint32_t j = 0; selected[i] && j < eMetric_EnumMax; j++)
+		{
+			// fence waits follow the gpu time and only add noise
+			if (j == eMetric_FenceWaitMs)
+			{
+				continue;
+			}
+			const bool timing = (j == eMetric_CpuMs || j == eMetric_GpuMs);
+			for (uint32_t k = 0; k < (timing ? 2u : 1u); k++)
+			{
+				double base = 0.0;
+				const double current = results[i].values[j][k];
+				if (!findBaselineValue(text, kScenes[i].name, j, k, &base))
+				{
+					continue;
+				}
+				const bool regressed = (timing)
+					? (current > base * (1.0 + tolerance) && current - base > kMinRegressionMs)
+					: (current > base);
+				if (regressed)
+				{
+					fprintf(stderr, "regression: %s %s %s %.4f -> %.4f (%+.1f%%)\n", kScenes[i].name, kMetricNames[j], kPercentileNames[k],
+						base, current, (base > 0.0) ? (current / base - 1.0) * 100.0 : 100.0);
+					retval++;
+				}
+			}
+		}
+	}
+	return retval;
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t numFrames = 500, numWarmup = 30;
+	const char* sceneName = NULL;
+	const char* outputFile = NULL;
+	const char* baselineFile = NULL;
+	double tolerance = 0.1;
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = (i + 1 < argc);
+		if (strcmp(argv[i], "--frames") == 0 && hasValue)
+		{
+			numFrames = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0 && hasValue)
+		{
+			numWarmup = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--scene") == 0 && hasValue)
+		{
+			sceneName = argv[++i];
+		}
+		else if (strcmp(argv[i], "--output") == 0 && hasValue)
+		{
+			outputFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--baseline") == 0 && hasValue)
+		{
+			baselineFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--tolerance") == 0 && hasValue)
+		{
+			tolerance = strtod(argv[++i], NULL);
+		}
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+	numFrames = (numFrames > 0) ? numFrames : 1;
+
+	bool selected[_countof(kScenes)];
+	uint32_t numSelected = 0;
+	for (uint32_t i = 0; i < _countof(kScenes); i++)
+	{
+		selected[i] = !sceneName || strcmp(sceneName, kScenes[i].name) == 0;
+		numSelected += selected[i] ? 1 : 0;
+	}
+	if (numSelected == 0)
+	{
+		fprintf(stderr, "unknown scene %s\n", sceneName);
+		return 2;
+	}
+
+	SDL_Init(SDL_INIT_TIMER);
+	requestHeadlessSwapchain(1280, 720);
+	requestSoftwareDevice(true);
+	requestDefaultCommandQueue(3, true);
+	requestSwapchainColorTarget(VK_FORMAT_B8G8R8A8_UNORM);
+	requestSwapchainDepthBuffer(VK_FORMAT_D32_SFLOAT);
+	requestSwapchainClear(VK_IMAGE_ASPECT_COLOR_BIT | VK_IMAGE_ASPECT_DEPTH_BIT);
+	requestSwapchainImageCount(3);
+	requestShaderCache("shader-cache");
+	requestGpuTimestamps(true);
+	createDevice();
+
+	ScenePass = getSwapchainRenderPass();
+	const float clearColor[] = { 0.1f, 0.1f, 0.1f, 1.f };
+	setRenderPassClearColor(ScenePass, 0, clearColor);
+	setRenderPassClearDepth(ScenePass, 1.f);
+
+	ScenePipeline = createGraphicsPipeline("bench.glsl", VK_SHADER_STAGE_ALL, ScenePass);
+	setGraphicsPipelineDepthTest(ScenePipeline, true, true, VK_COMPARE_OP_LESS);
+	setGraphicsPipelineFaceCulling(ScenePipeline, VK_CULL_MODE_BACK_BIT);
+	compilePipelineAsync(ScenePipeline);
+	SceneQueue = createRenderQueue(bindMaterial);
+
+	mat4 view, proj;
+	glm_perspective(glm_rad(60.f), 1280.f / 720.f, 0.1f, 100.f, proj);
+	glm_lookat((vec3){ 0.f, 12.f, 18.f }, (vec3){ 0.f, 0.f, 0.f }, (vec3){ 0.f, 1.f, 0.f }, view);
+	glm_mul(proj, view, Camera.viewProj);
+	glm_vec4_copy((vec4){ (float)GRID_SIZE, 1.25f, 0.5f, 0.f }, Camera.grid);
+
+	Sphere = getSphereMesh();
+	SphereData = createVertexArray(Sphere->meshDataSize, eDeviceQueue_Invalid);
+	beginCommandBuffer(eDeviceQueue_Universal);
+	bufferMemoryBarrier(SphereData, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	pipelineBarrier(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	updateBuffer(SphereData, Sphere->meshData, 0, Sphere->meshDataSize);
+	bufferMemoryBarrier(SphereData, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+	pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+	submitCommandBuffer(eDeviceQueue_Universal, false);
+
+	VkPhysicalDeviceProperties device;
+	getDeviceProperties(&device);
+	if (device.deviceType != VK_PHYSICAL_DEVICE_TYPE_CPU)
+	{
+		fprintf(stderr, "warning: %s is not a software device, timings won't match other machines\n", device.deviceName);
+	}
+
+	// measured frames must not draw with a pipeline that is still compiling
+	for (uint32_t i = 0; !isPipelineReady(ScenePipeline) && i < 10000; i++)
+	{
+		SDL_Delay(1);
+	}
+
+	int retval = 0;
+	struct SceneResult results[_countof(kScenes)] = { 0 };
+	double* samples = malloc(eMetric_EnumMax * numFrames * sizeof(double));
+	if (!samples || !isPipelineReady(ScenePipeline))
+	{
+		fprintf(stderr, "benchmark setup failed\n");
+		retval = 2;
+	}
+	for (uint32_t i = 0; retval == 0 && i < _countof(kScenes); i++)
+	{
+		if (selected[i])
+		{
+			runScene(&kScenes[i], numWarmup, numFrames, samples, &results[i]);
+		}
+	}
+	deviceWaitIdle();
+
+	if (retval == 0)
+	{
+		FILE* file = (outputFile) ? fopen(outputFile, "w") : stdout;
+		if (file)
+		{
+			writeResults(file, device.deviceName, results, selected, numFrames);
+			if (file != stdout)
+			{
+				fclose(file);
+			}
+		}
+
+		char* baseline = (baselineFile) ? readTextFile(baselineFile) : NULL;
+		if (baselineFile && !baseline)
+		{
+			fprintf(stderr, "cannot read baseline %s\n", baselineFile);
+			retval = 2;
+		}
+		else if (baseline && !isSameDevice(baseline, device.deviceName))
+		{
+			fprintf(stderr, "baseline %s was not recorded on %s\n", baselineFile, device.deviceName);
+			retval = 2;
+		}
+		else if (baseline && compareWithBaseline(baseline, results, selected, tolerance) > 0)
+		{
+			retval = 1;
+		}
+		free(baseline);
+	}
+
+	free(samples);
+	destroyRenderQueue(SceneQueue);
+	destroyBuffer(SphereData);
+	destroyPipeline(ScenePipeline);
+	destroyDevice();
+	SDL_Quit();
+
+	return retval;
+}
@@ -32,7 +32,7 @@ void Camera::applyResize(int width, int height)
 	m_aspectRatio = float(width) / float(height);
 }
 
-void Camera::writeUniforms(Buffer buffer)
+void Camera::writeUniforms(void* data)
 {
 	mat4 view, proj, viewProj;
 	const float sinA = sinf(m_azimuth);
@@ -43,5 +43,5 @@ void Camera::writeUniforms(Buffer buffer)
 	glm_perspective(glm_rad(60.f), m_aspectRatio, 0.001f, 1000.f, proj);
 	glm_lookat(eye, vec3{}, vec3{ 0.f, 1.f, 0.f }, view);
 	glm_mul(proj, view, viewProj);
-	memcpy(getBufferMappedPtr(buffer), &viewProj, sizeof(viewProj));
+	memcpy(data, &viewProj, sizeof(viewProj));
 }
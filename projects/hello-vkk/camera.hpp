@@ -1,7 +1,5 @@
 #pragma once
 
-typedef struct BufferT* Buffer;
-
 class Camera
 {
 
@@ -10,7 +8,7 @@ public:
 	void applyZoom(float amount);
 	void applyRotation(float horz, float vert);
 	void applyResize(int width, int height);
-	void writeUniforms(Buffer buffer);
+	void writeUniforms(void* data);
 
 private:
 	float m_radius;
@@ -52,6 +52,9 @@ int main(int argc, char** argv)
 	requestPresentMode(VK_PRESENT_MODE_FIFO_KHR);
 	requestSwapchainClear(VK_IMAGE_ASPECT_COLOR_BIT | VK_IMAGE_ASPECT_DEPTH_BIT);
 	requestSwapchainImageCount(3);
+	requestShaderCache("shader-cache");
+	requestPipelineCache("pipeline-cache.bin");
+	requestPipelineCompilerThreads(2);
 	createDevice();
 
 	const float clearColor[]{ 0.0f, 0.5f, 0.5f, 1.f };
@@ -62,19 +65,16 @@ int main(int argc, char** argv)
 	Pipeline pipeline = createGraphicsPipeline("hello.glsl", VK_SHADER_STAGE_ALL, swapchainPass);
 	setGraphicsPipelineDepthTest(pipeline, true, true, VK_COMPARE_OP_LESS);
 	setGraphicsPipelineFaceCulling(pipeline, VK_CULL_MODE_BACK_BIT);
+	compilePipelineAsync(pipeline);
 
 	int imageWidth, imageHeight, imageChannels;
 	unsigned char* imageData = stbi_load("../assets/globe-8k.png", &imageWidth, &imageHeight, &imageChannels, 4);
 	const size_t imageDataSize = imageHeight * imageWidth * 4;
-	Buffer imageBuffer = createUploadBuffer(imageDataSize, eDeviceQueue_Invalid);
-	memcpy(getBufferMappedPtr(imageBuffer), imageData, imageDataSize);
-	stbi_image_free(imageData);
 
 	SamplerState sampler = createSamplerState(VK_FILTER_LINEAR, VK_SAMPLER_MIPMAP_MODE_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
 
 	Camera camera(5.f, 1.f);
 	Mesh sphere = getSphereMesh();
-	Buffer cameraData = createUniformBuffer(sizeof(mat4), eDeviceQueue_Universal);
 	Image textureImage = nullptr;
 	Buffer vertexData = nullptr;
 
@@ -118,45 +118,38 @@ int main(int argc, char** argv)
 			break;
 		}
 
-		camera.writeUniforms(cameraData);
-
 		beginCommandBuffer(eDeviceQueue_Universal);
 		
 		if (!vertexData)
 		{
 			vertexData = createVertexArray(sphere->meshDataSize, eDeviceQueue_Invalid);
-			bufferMemoryBarrier(vertexData, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
-			pipelineBarrier(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+			useBuffer(vertexData, eResourceUsage_TransferDst);
 			updateBuffer(vertexData, sphere->meshData, 0, sphere->meshDataSize);
-			bufferMemoryBarrier(vertexData, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
-			pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+			useBuffer(vertexData, eResourceUsage_VertexBuffer);
+			useBuffer(vertexData, eResourceUsage_IndexBuffer);
 		}
 
 		if (!textureImage)
 		{
-			const ImageSubset subset = makeImageSubset(0, 1, 0, 1);
+			const ImageSubset allMips = makeImageSubset(0, 12, 0, 1);
 			const VkExtent3D imageExt{ uint32_t(imageWidth), uint32_t(imageHeight), 1 };
 			textureImage = createSampledImage(VK_FORMAT_R8G8B8A8_UNORM, &imageExt, 12);
-			imageMemoryBarrier(textureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_NONE, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, subset);
-			pipelineBarrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-			updateImageMipLevel(imageBuffer, textureImage, 0);
+			useImage(textureImage, eResourceUsage_TransferDst, allMips);
+			uploadImage(textureImage, 0, imageData, imageDataSize);
+			stbi_image_free(imageData);
+			imageData = nullptr;
 
-			imageMemoryBarrier(textureImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_ACCESS_NONE, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, makeImageSubset(1, 11, 0, 1));
 			for (uint32_t i = 1; i <= 11; i++)
 			{
-				imageMemoryBarrier(textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, makeImageSubset(i - 1, 1, 0, 1));
-				pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+				useImage(textureImage, eResourceUsage_TransferSrc, makeImageSubset(i - 1, 1, 0, 1));
 				blit(textureImage, textureImage, makeImageSubset(i - 1, 1, 0, 1), makeImageSubset(i, 1, 0, 1));
 			}
-
-			imageMemoryBarrier(textureImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, makeImageSubset(0, 11, 0, 1));
-			imageMemoryBarrier(textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, makeImageSubset(11, 1, 0, 1));
-			pipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+			useImage(textureImage, eResourceUsage_FragmentShaderRead, allMips);
 		}
 
 		beginRenderPass(swapchainPass, getSwapchainFramebuffer());
 		bindSamplerState(0, sampler);
-		bindUniformBuffer(0, cameraData);
+		camera.writeUniforms(bindUniformData(0, sizeof(mat4)));
 		bindSampledImage(0, textureImage);
 		bindVertexBufferRange(0, vertexData, 0);
 		bindIndexBufferRange(VK_INDEX_TYPE_UINT32, vertexData, sphere->indexDataOffset);
@@ -170,9 +163,8 @@ int main(int argc, char** argv)
 
 	deviceWaitIdle();
 	destroyImage(textureImage);
-	destroyBuffer(imageBuffer);
+	stbi_image_free(imageData);
 	destroyBuffer(vertexData);
-	destroyBuffer(cameraData);
 	destroyPipeline(pipeline);
 	destroySamplerState(sampler);
 	destroyDevice();
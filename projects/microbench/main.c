@@ -0,0 +1,259 @@
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+#include <vulkan-kit/vkk.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+usage: microbench [options]
+	--frames N        frames recorded per case (50)
+	--calls N         calls recorded per frame (10000)
+	--output file     write the results there instead of stdout
+
+Records through the null backend, so the timings are vulkan-kit's own CPU
+cost per call with no driver underneath. Reported as min and median ns/call
+over the recorded frames.
+*/
+
+#if !WITH_NULL_BACKEND
+#error microbench needs vulkan-kit built with WITH_NULL_BACKEND=1
+#endif
+
+struct BenchCase
+{
+	const char* name;
+	void (*call)(uint32_t index);
+	bool renderPass;
+};
+
+static const float kTriangle[] = {
+	-1.f, -1.f, 0.f,
+	 1.f, -1.f, 0.f,
+	 0.f,  1.f, 0.f
+};
+
+static const uint16_t kIndices[] = { 0, 1, 2, 0, 1, 2 };
+
+static Pipeline Pipelines[2] = { NULL };
+static Buffer Geometry = NULL;
+static Buffer Uniforms = NULL;
+static const float Transform[16] = {
+	1.f, 0.f, 0.f, 0.f,
+	0.f, 1.f, 0.f, 0.f,
+	0.f, 0.f, 1.f, 0.f,
+	0.f, 0.f, 0.f, 1.f
+};
+
+static void bindPipelineSame(uint32_t index)
+{
+	bindGraphicsPipeline(Pipelines[0]);
+}
+
+static void bindPipelineAlternate(uint32_t index)
+{
+	bindGraphicsPipeline(Pipelines[index & 1]);
+}
+
+static void bindVertexBufferSame(uint32_t index)
+{
+	bindVertexBufferRange(0, Geometry, 0);
+}
+
+static void bindVertexBufferAlternate(uint32_t index)
+{
+	bindVertexBufferRange(0, Geometry, (index & 1) * sizeof(float) * 3);
+}
+
+static void bindIndexBufferAlternate(uint32_t index)
+{
+	bindIndexBufferRange(VK_INDEX_TYPE_UINT16, Geometry, sizeof(kTriangle) + (index & 1) * 3 * sizeof(uint16_t));
+}
+
+static void bindUniformBufferCall(uint32_t index)
+{
+	bindUniformBuffer(0, Uniforms);
+}
+
+static void bindUniformDataCall(uint32_t index)
+{
+	memcpy(bindUniformData(0, sizeof(Transform)), Transform, sizeof(Transform));
+}
+
+static void drawIndexedCall(uint32_t index)
+{
+	drawIndexed(3, 1, 0, 0, 0);
+}
+
+static void drawIndexedWithUniformData(uint32_t index)
+{
+	memcpy(bindUniformData(0, sizeof(Transform)), Transform, sizeof(Transform));
+	drawIndexed(3, 1, 0, 0, 0);
+}
+
+static void pipelineBarrierCall(uint32_t index)
+{
+	bufferMemoryBarrier(Uniforms, VK_ACCESS_UNIFORM_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+	pipelineBarrier(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+}
+
+static void useBufferCall(uint32_t index)
+{
+	useBuffer(Uniforms, (index & 1) ? eResourceUsage_UniformBuffer : eResourceUsage_TransferDst);
+}
+
+static const struct BenchCase kCases[] = {
+	{ "bindGraphicsPipeline/same", bindPipelineSame, true },
+	{ "bindGraphicsPipeline/alternate", bindPipelineAlternate, true },
+	{ "bindVertexBufferRange/same", bindVertexBufferSame, true },
+	{ "bindVertexBufferRange/alternate", bindVertexBufferAlternate, true },
+	{ "bindIndexBufferRange/alternate", bindIndexBufferAlternate, true },
+	{ "bindUniformBuffer", bindUniformBufferCall, true },
+	{ "bindUniformData", bindUniformDataCall, true },
+	{ "drawIndexed", drawIndexedCall, true },
+	{ "drawIndexed+bindUniformData", drawIndexedWithUniformData, true },
+	{ "pipelineBarrier", pipelineBarrierCall, false },
+	{ "useBuffer", useBufferCall, false }
+};
+
+static int compareDoubles(const void* a, const void* b)
+{
+	const double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// state every in-pass case starts from, so draws are valid and binds measure their own cost
+static void bindDefaultState(void)
+{
+	bindGraphicsPipeline(Pipelines[0]);
+	bindVertexBufferRange(0, Geometry, 0);
+	bindIndexBufferRange(VK_INDEX_TYPE_UINT16, Geometry, sizeof(kTriangle));
+	bindUniformBuffer(0, Uniforms);
+}
+
+static void runCase(const struct BenchCase* bench, uint32_t numFrames, uint32_t numCalls, double* frameNs)
+{
+	const double nsPerTick = 1e9 / (double)SDL_GetPerformanceFrequency();
+	for (uint32_t frame = 0; frame < numFrames; frame++)
+	{
+		beginCommandBuffer(eDeviceQueue_Universal);
+		if (bench->renderPass)
+		{
+			beginRenderPass(getSwapchainRenderPass(), getSwapchainFramebuffer());
+			bindDefaultState();
+		}
+
+		const uint64_t start = SDL_GetPerformanceCounter();
+		for (uint32_t i = 0; i < numCalls; i++)
+		{
+			bench->call(i);
+		}
+		const uint64_t end = SDL_GetPerformanceCounter();
+
+		if (bench->renderPass)
+		{
+			endRenderPass();
+		}
+		submitCommandBuffer(eDeviceQueue_Universal, bench->renderPass);
+		if (bench->renderPass)
+		{
+			presentImageToWindow();
+		}
+		frameNs[frame] = (double)(end - start) * nsPerTick / (double)numCalls;
+	}
+	qsort(frameNs, numFrames, sizeof(double), compareDoubles);
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t numFrames = 50, numCalls = 10000;
+	const char* outputFile = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = (i + 1 < argc);
+		if (strcmp(argv[i], "--frames") == 0 && hasValue)
+		{
+			numFrames = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--calls") == 0 && hasValue)
+		{
+			numCalls = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--output") == 0 && hasValue)
+		{
+			outputFile = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+	numFrames = (numFrames > 0) ? numFrames : 1;
+	numCalls = (numCalls > 0) ? numCalls : 1;
+
+	SDL_Init(SDL_INIT_TIMER);
+	requestNullBackend(true);
+	requestHeadlessSwapchain(64, 64);
+	requestDefaultCommandQueue(3, true);
+	requestSwapchainColorTarget(VK_FORMAT_B8G8R8A8_UNORM);
+	requestSwapchainImageCount(3);
+	requestShaderCache("shader-cache");
+	requestTransientMemory((size_t)numCalls * 256);
+	createDevice();
+
+	for (uint32_t i = 0; i < _countof(Pipelines); i++)
+	{
+		Pipelines[i] = createGraphicsPipeline("microbench.glsl", VK_SHADER_STAGE_ALL, getSwapchainRenderPass());
+		setGraphicsPipelineFaceCulling(Pipelines[i], (i == 0) ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
+		compilePipelineAsync(Pipelines[i]);
+	}
+
+	Geometry = createVertexArray(sizeof(kTriangle) + sizeof(kIndices), eDeviceQueue_Invalid);
+	Uniforms = createUniformBuffer(sizeof(Transform), eDeviceQueue_Invalid);
+	beginCommandBuffer(eDeviceQueue_Universal);
+	updateBuffer(Geometry, kTriangle, 0, sizeof(kTriangle));
+	updateBuffer(Geometry, kIndices, sizeof(kTriangle), sizeof(kIndices));
+	updateBuffer(Uniforms, Transform, 0, sizeof(Transform));
+	submitCommandBuffer(eDeviceQueue_Universal, false);
+
+	for (uint32_t i = 0; (!isPipelineReady(Pipelines[0]) || !isPipelineReady(Pipelines[1])) && i < 10000; i++)
+	{
+		SDL_Delay(1);
+	}
+
+	int retval = 0;
+	double* frameNs = malloc(numFrames * sizeof(double));
+	FILE* file = (outputFile) ? fopen(outputFile, "w") : stdout;
+	if (!frameNs || !file || !isPipelineReady(Pipelines[0]) || !isPipelineReady(Pipelines[1]))
+	{
+		fprintf(stderr, "microbench setup failed\n");
+		retval = 2;
+	}
+	else
+	{
+		fprintf(file, "{\n\t\"frames\": %u,\n\t\"callsPerFrame\": %u,\n\t\"calls\": {", numFrames, numCalls);
+		for (uint32_t i = 0; i < _countof(kCases); i++)
+		{
+			runCase(&kCases[i], numFrames, numCalls, frameNs);
+			fprintf(file, "%s\n\t\t\"%s\": { \"minNs\": %.2f, \"medianNs\": %.2f }", i ? "," : "", kCases[i].name, frameNs[0], frameNs[numFrames / 2]);
+		}
+		fprintf(file, "\n\t}\n}\n");
+	}
+	if (file && file != stdout)
+	{
+		fclose(file);
+	}
+
+	deviceWaitIdle();
+	free(frameNs);
+	destroyBuffer(Uniforms);
+	destroyBuffer(Geometry);
+	destroyPipeline(Pipelines[0]);
+	destroyPipeline(Pipelines[1]);
+	destroyDevice();
+	SDL_Quit();
+
+	return retval;
+}
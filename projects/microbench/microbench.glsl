@@ -0,0 +1,28 @@
+#version 460
+
+#ifdef VERTEX
+
+layout(location=0) in vec3 aPosition;
+
+layout(binding=uniform_buffer_0) uniform Transform
+{
+	mat4 uTransform;
+};
+
+void main()
+{
+	gl_Position = uTransform * vec4(aPosition, 1.);
+}
+
+#endif
+
+#ifdef FRAGMENT
+
+layout(location=0) out vec4 oColor;
+
+void main()
+{
+	oColor = vec4(1.);
+}
+
+#endif
@@ -0,0 +1,183 @@
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+#include <vulkan-kit/vkk.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+usage: replay [options] trace-file
+	--frames N        replay at most N frames (all)
+	--shaders dir     where the shaders embedded in the trace are written (replay-shaders)
+	--output file     write the results there instead of stdout
+	--software        prefer the software device
+
+Traces are recorded by any app built with WITH_TRACE=1 that calls
+requestApiTrace(file) before createDevice. Frames replay headless and back to
+back, pipelines are compiled before the first draw that uses them.
+*/
+
+#if !WITH_TRACE
+#error replay needs vulkan-kit built with WITH_TRACE=1
+#endif
+
+enum MetricT
+{
+	eMetric_CpuMs,
+	eMetric_FenceWaitMs,
+	eMetric_EnumMax
+};
+
+static const char* kMetricNames[eMetric_EnumMax] = {
+	"cpuMs",
+	"fenceWaitMs"
+};
+
+static const double kPercentiles[] = { 0.5, 0.95, 0.99 };
+static const char* kPercentileNames[] = { "p50", "p95", "p99" };
+
+static int compareDoubles(const void* a, const void* b)
+{
+	const double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// cpu time excludes the fence wait, same as the benchmark
+static bool replayFrame(double* sample)
+{
+	struct CommandStats before, after;
+	getCommandStats(&before);
+	const uint64_t start = SDL_GetPerformanceCounter();
+	const bool retval = replayApiTraceFrame();
+	const uint64_t end = SDL_GetPerformanceCounter();
+	getCommandStats(&after);
+
+	const double fenceWaitMs = (double)(after.fenceWaitUs - before.fenceWaitUs) * 1e-3;
+	sample[eMetric_CpuMs] = (double)(end - start) * 1000.0 / (double)SDL_GetPerformanceFrequency() - fenceWaitMs;
+	sample[eMetric_FenceWaitMs] = fenceWaitMs;
+	return retval;
+}
+
+static void writeResults(FILE* file, const char* traceFile, const double* samples, uint32_t numFrames)
+{
+	double* values = malloc((numFrames + 1) * sizeof(double));
+	fprintf(file, "{\n\t\"trace\": \"%s\",\n\t\"frames\": %u,\n\t\"frameTimes\": {", traceFile, numFrames);
+	for (uint32_t j = 0; values && j < eMetric_EnumMax; j++)
+	{
+		// nearest rank
+		for (uint32_t i = 0; i < numFrames; i++)
+		{
+			values[i] = samples[i * eMetric_EnumMax + j];
+		}
+		qsort(values, numFrames, sizeof(double), compareDoubles);
+		fprintf(file, "%s\n\t\t\"%s\": { ", j ? "," : "", kMetricNames[j]);
+		for (uint32_t k = 0; k < _countof(kPercentiles); k++)
+		{
+			const uint32_t rank = (uint32_t)SDL_ceil(kPercentiles[k] * (double)numFrames);
+			const double value = (numFrames) ? values[(rank > 0) ? rank - 1 : 0] : 0.0;
+			fprintf(file, "%s\"%s\": %.4f", k ? ", " : "", kPercentileNames[k], value);
+		}
+		fprintf(file, " }");
+	}
+	fprintf(file, "\n\t}\n}\n");
+	free(values);
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t maxFrames = UINT32_MAX;
+	const char* traceFile = NULL;
+	const char* shaderDir = "replay-shaders";
+	const char* outputFile = NULL;
+	bool software = false;
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = (i + 1 < argc);
+		if (strcmp(argv[i], "--frames") == 0 && hasValue)
+		{
+			maxFrames = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--shaders") == 0 && hasValue)
+		{
+			shaderDir = argv[++i];
+		}
+		else if (strcmp(argv[i], "--output") == 0 && hasValue)
+		{
+			outputFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--software") == 0)
+		{
+			software = true;
+		}
+		else if (argv[i][0] != '-' && !traceFile)
+		{
+			traceFile = argv[i];
+		}
+		else
+		{
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 2;
+		}
+	}
+	if (!traceFile)
+	{
+		fprintf(stderr, "usage: replay [options] trace-file\n");
+		return 2;
+	}
+
+	SDL_Init(SDL_INIT_TIMER);
+	if (!loadApiTrace(traceFile, shaderDir))
+	{
+		fprintf(stderr, "%s is not a trace this build can replay\n", traceFile);
+		SDL_Quit();
+		return 2;
+	}
+	requestSoftwareDevice(software);
+	requestShaderCache("shader-cache");
+	createDevice();
+
+	// grown as frames come in, a trace doesn't say how many it holds
+	uint32_t numFrames = 0, capacity = 0;
+	double* samples = NULL;
+	double sample[eMetric_EnumMax];
+	while (numFrames < maxFrames && replayFrame(sample))
+	{
+		if (numFrames == capacity)
+		{
+			capacity = (capacity) ? capacity * 2 : 256;
+			double* grown = realloc(samples, (size_t)capacity * sizeof(sample));
+			if (!grown)
+			{
+				break;
+			}
+			samples = grown;
+		}
+		memcpy(samples + numFrames * eMetric_EnumMax, sample, sizeof(sample));
+		numFrames++;
+	}
+
+	FILE* file = (outputFile) ? fopen(outputFile, "w") : stdout;
+	int retval = 0;
+	if (file)
+	{
+		writeResults(file, traceFile, samples, numFrames);
+		if (file != stdout)
+		{
+			fclose(file);
+		}
+	}
+	else
+	{
+		fprintf(stderr, "can't write %s\n", outputFile);
+		retval = 2;
+	}
+
+	deviceWaitIdle();
+	free(samples);
+	unloadApiTrace();
+	destroyDevice();
+	SDL_Quit();
+
+	return retval;
+}
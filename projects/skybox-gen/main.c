@@ -53,6 +53,9 @@ int main(int argc, char** argv)
 	requestPresentMode(VK_PRESENT_MODE_FIFO_KHR);
 	requestSwapchainClear(VK_IMAGE_ASPECT_COLOR_BIT | VK_IMAGE_ASPECT_DEPTH_BIT);
 	requestSwapchainImageCount(3);
+	requestShaderCache("shader-cache");
+	requestPipelineCache("pipeline-cache.bin");
+	requestPipelineCompilerThreads(2);
 	createDevice();
 
 	RenderPass swapchainPass = getSwapchainRenderPass();
@@ -63,12 +66,13 @@ int main(int argc, char** argv)
 	Pipeline pipeline = createGraphicsPipeline("skybox.glsl", VK_SHADER_STAGE_ALL, swapchainPass);
 	setGraphicsPipelineDepthTest(pipeline, true, true, VK_COMPARE_OP_LESS);
 	setGraphicsPipelineFaceCulling(pipeline, VK_CULL_MODE_BACK_BIT);
+	compilePipelineAsync(pipeline);
 
 	mat4 cameraMatrix;
 	float aspectRatio = 1.f;
 	Mesh sphere = getSphereMesh();
 	vec3 sunPosition = { 0.f, 1.f, 0.f };
-	Buffer vertexData = NULL, cameraData = NULL, skyboxData = NULL;
+	Buffer vertexData = NULL;
 
 	SDL_MaximizeWindow(window);
 
@@ -116,23 +120,11 @@ int main(int argc, char** argv)
 
 		beginCommandBuffer(eDeviceQueue_Universal);
 
-		if (!cameraData)
-		{
-			mat4 view, proj;
-			glm_perspective(glm_rad(60.f), aspectRatio, 0.001f, 1000.f, proj);
-			glm_lookat((vec3) { 0.f, 0.f, 5.f }, (vec3){0.f, 0.f, 0.f}, (vec3){ 0.f, 1.f, 0.f }, view);
-			cameraData = createUniformBuffer(sizeof(cameraMatrix), eDeviceQueue_Universal);
-			glm_mul(proj, view, cameraMatrix);
-		}
-
-		if (!skyboxData)
-		{
-			skyboxData = createUniformBuffer(sizeof(Skybox), eDeviceQueue_Universal);
-		}
-
+		mat4 view, proj;
+		glm_perspective(glm_rad(60.f), aspectRatio, 0.001f, 1000.f, proj);
+		glm_lookat((vec3) { 0.f, 0.f, 5.f }, (vec3){0.f, 0.f, 0.f}, (vec3){ 0.f, 1.f, 0.f }, view);
+		glm_mul(proj, view, cameraMatrix);
 		glm_normalize_to(sunPosition, Skybox.sunDirection);
-		memcpy(getBufferMappedPtr(cameraData), cameraMatrix, sizeof(cameraMatrix));
-		memcpy(getBufferMappedPtr(skyboxData), &Skybox, sizeof(Skybox));
 
 		if (!vertexData)
 		{
@@ -145,8 +137,8 @@ int main(int argc, char** argv)
 		}
 
 		beginRenderPass(swapchainPass, getSwapchainFramebuffer());
-		bindUniformBuffer(0, cameraData);
-		bindUniformBuffer(1, skyboxData);
+		memcpy(bindUniformData(0, sizeof(cameraMatrix)), cameraMatrix, sizeof(cameraMatrix));
+		memcpy(bindUniformData(1, sizeof(Skybox)), &Skybox, sizeof(Skybox));
 		bindVertexBufferRange(0, vertexData, 0);
 		bindIndexBufferRange(VK_INDEX_TYPE_UINT32, vertexData, sphere->indexDataOffset);
 		bindGraphicsPipeline(pipeline);
@@ -159,8 +151,6 @@ int main(int argc, char** argv)
 
 	deviceWaitIdle();
 	destroyBuffer(vertexData);
-	destroyBuffer(cameraData);
-	destroyBuffer(skyboxData);
 	destroyPipeline(pipeline);
 	destroyDevice();
 